@@ -29,6 +29,7 @@ int main(void)
     }
 
     IS31FL3731_Graphics::Config gfx_cfg;
+    gfx_cfg.Defaults();
     gfx_cfg.driver = &ledmatrix;
     gfx_cfg.frame = 0;
 
@@ -1,7 +1,8 @@
 #include "daisy_seed.h"
 #include "../lib/is31fl3731/is31fl3731.h"
 #include "../lib/is31fl3731_graphics/IS31FL3731_Graphics.h"
-#include <math.h>
+#include "../lib/is31fl3731_graphics/IS31FL3731_FixedMath.h"
+#include <stdlib.h>
 
 using namespace daisy;
 
@@ -19,6 +20,7 @@ void setupMatrix(uint8_t idx, I2CHandle* i2c_handle)
     }
 
     IS31FL3731_Graphics::Config gfx_cfg;
+    gfx_cfg.Defaults();
     gfx_cfg.driver = &ledmatrix[idx];
     gfx_cfg.frame = 0;
     display[idx].Init(gfx_cfg);
@@ -117,10 +119,13 @@ int main(void)
 
                 for(int16_t x = 0; x < 16; x++)
                 {
-                    int16_t y = 4 + (int16_t)(2 * sin((x + wave_offset) * 3.14159 / 8));
+                    // pi / 8 per column is 1/16 of a turn of the 16-bit phase.
+                    q15_t s = sin16((x + wave_offset) * 4096);
+
+                    int16_t y = 4 + ((2 * s) >> 15);
                     y = ((y % 9) + 9) % 9;
 
-                    uint8_t brightness = 150 + (int16_t)(50 * sin((x + wave_offset) * 3.14159 / 8));
+                    uint8_t brightness = 150 + ((50 * s) >> 15);
                     display[i].setPixel(x, y, brightness);
                 }
 
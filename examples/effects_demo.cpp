@@ -0,0 +1,81 @@
+#include "daisy_seed.h"
+#include "../lib/is31fl3731/is31fl3731.h"
+#include "../lib/is31fl3731_graphics/IS31FL3731_Graphics.h"
+#include "../lib/is31fl3731_graphics/IS31FL3731_Effects.h"
+
+using namespace daisy;
+
+DaisySeed  hw;
+IS31FL3731 ledmatrix;
+IS31FL3731_Graphics display;
+
+IS31FL3731_PlasmaEffect  plasma;
+IS31FL3731_WaveEffect    wave;
+IS31FL3731_RippleEffect  ripple;
+IS31FL3731_FireEffect    fire;
+IS31FL3731_TwinkleEffect twinkle;
+IS31FL3731_CometEffect   comet;
+
+IS31FL3731_Effect* const EFFECTS[] = {&plasma, &wave, &ripple, &fire, &twinkle, &comet};
+const uint8_t            EFFECT_COUNT = sizeof(EFFECTS) / sizeof(EFFECTS[0]);
+
+const uint32_t FRAME_MS  = 20;
+const uint32_t EFFECT_MS = 5000;
+
+int main(void)
+{
+    hw.Init();
+
+    I2CHandle::Config i2c_conf;
+    i2c_conf.periph         = I2CHandle::Config::Peripheral::I2C_1;
+    i2c_conf.mode           = I2CHandle::Config::Mode::I2C_MASTER;
+    i2c_conf.speed          = I2CHandle::Config::Speed::I2C_400KHZ;
+    i2c_conf.pin_config.scl = {DSY_GPIOB, 8};
+    i2c_conf.pin_config.sda = {DSY_GPIOB, 9};
+
+    I2CHandle i2c_handle;
+    if(i2c_handle.Init(i2c_conf) != I2CHandle::Result::OK)
+    {
+        return -1;
+    }
+
+    if(!ledmatrix.begin(ISSI_ADDR_DEFAULT, &i2c_handle))
+    {
+        return -1;
+    }
+
+    IS31FL3731_Graphics::Config gfx_cfg;
+    gfx_cfg.Defaults();
+    gfx_cfg.driver = &ledmatrix;
+    gfx_cfg.frame = 0;
+
+    if(!display.Init(gfx_cfg))
+    {
+        return -1;
+    }
+
+    uint8_t  current     = 0;
+    uint32_t effect_time = System::GetNow();
+    uint32_t frame_time  = effect_time;
+
+    while(1)
+    {
+        uint32_t now = System::GetNow();
+
+        if(now - effect_time > EFFECT_MS)
+        {
+            effect_time = now;
+            current     = (current + 1) % EFFECT_COUNT;
+            display.clear();
+        }
+
+        // Effects are driven by time, so a slow I2C frame skips ahead
+        // instead of slowing the animation down.
+        if(now - frame_time >= FRAME_MS)
+        {
+            frame_time = now;
+            EFFECTS[current]->render(display.target(), now);
+            display.update();
+        }
+    }
+}
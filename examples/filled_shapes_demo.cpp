@@ -27,6 +27,7 @@ int main(void)
     ledmatrix.Init(matrix_cfg);
 
     IS31FL3731_Graphics::Config gfx_cfg;
+    gfx_cfg.Defaults();
     gfx_cfg.driver = &ledmatrix;
     gfx_cfg.frame = 0;
     display.Init(gfx_cfg);
@@ -0,0 +1,96 @@
+#include "daisy_seed.h"
+#include "../lib/is31fl3731/is31fl3731.h"
+#include "../lib/is31fl3731_graphics/IS31FL3731_AnimationStore.h"
+#include "../lib/is31fl3731_graphics/IS31FL3731_Effects.h"
+#include "../lib/is31fl3731_graphics/IS31FL3731_StorePlayer.h"
+
+using namespace daisy;
+
+DaisySeed  hw;
+IS31FL3731 ledmatrix;
+
+IS31FL3731_AnimationStore store;
+IS31FL3731_StorePlayer    player;
+
+// Keep clear of anything else living in QSPI (e.g. a bootloader app).
+const uint32_t QSPI_BASE    = 0x90000000;
+const uint32_t STORE_OFFSET = 0x40000;
+const uint16_t FRAME_COUNT  = 128;
+const uint16_t FRAME_MS     = 40;
+
+// Renders the plasma effect once and writes it to flash. Later boots find
+// a valid store and skip straight to playback.
+void bakeStore()
+{
+    IS31FL3731_PlasmaEffect        plasma;
+    IS31FL3731_StaticCanvas<16, 9> canvas;
+    uint8_t                        record[IS31FL3731_STORE_RECORD_SIZE];
+    uint32_t                       addr = QSPI_BASE + STORE_OFFSET;
+
+    hw.qspi.Erase(addr, addr + IS31FL3731_AnimationStore::imageSize(FRAME_COUNT));
+
+    IS31FL3731_AnimationStore::formatHeader(record, FRAME_COUNT, 16, 9);
+    hw.qspi.Write(addr, IS31FL3731_STORE_HEADER_SIZE, record);
+    addr += IS31FL3731_STORE_HEADER_SIZE;
+
+    for(uint16_t i = 0; i < FRAME_COUNT; i++)
+    {
+        plasma.render(&canvas, i * FRAME_MS);
+        IS31FL3731_AnimationStore::formatRecord(record, canvas.pixels(), 16 * 9, FRAME_MS);
+        hw.qspi.Write(addr, IS31FL3731_STORE_RECORD_SIZE, record);
+        addr += IS31FL3731_STORE_RECORD_SIZE;
+    }
+}
+
+int main(void)
+{
+    hw.Init();
+
+    I2CHandle::Config i2c_conf;
+    i2c_conf.periph         = I2CHandle::Config::Peripheral::I2C_1;
+    i2c_conf.mode           = I2CHandle::Config::Mode::I2C_MASTER;
+    i2c_conf.speed          = I2CHandle::Config::Speed::I2C_400KHZ;
+    i2c_conf.pin_config.scl = {DSY_GPIOB, 8};
+    i2c_conf.pin_config.sda = {DSY_GPIOB, 9};
+
+    I2CHandle i2c_handle;
+    if(i2c_handle.Init(i2c_conf) != I2CHandle::Result::OK)
+    {
+        return -1;
+    }
+
+    if(!ledmatrix.begin(ISSI_ADDR_DEFAULT, &i2c_handle))
+    {
+        return -1;
+    }
+
+    const uint8_t* flash  = (const uint8_t*)hw.qspi.GetData(STORE_OFFSET);
+    uint32_t       length = IS31FL3731_AnimationStore::imageSize(FRAME_COUNT);
+    if(!store.Init(flash, length))
+    {
+        bakeStore();
+        if(!store.Init(flash, length))
+        {
+            return -1;
+        }
+    }
+
+    IS31FL3731_StorePlayer::Config play_cfg;
+    play_cfg.Defaults();
+    play_cfg.store         = &store;
+    play_cfg.driver        = &ledmatrix;
+    play_cfg.bank          = 0;
+    play_cfg.double_buffer = true;
+
+    if(!player.Init(play_cfg))
+    {
+        return -1;
+    }
+
+    while(1)
+    {
+        // Each frame goes from memory-mapped flash to the bus, no copy.
+        player.tick(System::GetNow());
+        System::Delay(1);
+    }
+}
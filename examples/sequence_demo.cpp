@@ -0,0 +1,107 @@
+#include "daisy_seed.h"
+#include "../lib/is31fl3731/is31fl3731.h"
+#include "../lib/is31fl3731_graphics/IS31FL3731_Graphics.h"
+#include "../lib/is31fl3731_graphics/IS31FL3731_Sequence.h"
+
+using namespace daisy;
+
+DaisySeed  hw;
+IS31FL3731 ledmatrix;
+IS31FL3731_Graphics display;
+
+// Generated with:
+//   sequence_encode -d 80 -c RIPPLE_SEQUENCE ripple0.pgm ... ripple7.pgm
+// 8 frames, 16x9
+static const uint8_t RIPPLE_SEQUENCE[546] = {
+    0x49, 0x53, 0x51, 0x01, 0x10, 0x09, 0x08, 0x00, 0x50, 0x00, 0x0C, 0x00, 0x36, 0x81, 0x16, 0x16,
+    0x0D, 0x81, 0x78, 0x78, 0x0D, 0x81, 0x16, 0x16, 0x50, 0x00, 0x1A, 0x00, 0x26, 0x81, 0x3F, 0x3F,
+    0x0C, 0x83, 0x68, 0xBB, 0xBB, 0x68, 0x0B, 0x83, 0x98, 0x58, 0x58, 0x98, 0x0B, 0x83, 0x68, 0xBB,
+    0xBB, 0x68, 0x0C, 0x81, 0x3F, 0x3F, 0x50, 0x00, 0x3A, 0x00, 0x15, 0x83, 0x30, 0x62, 0x62, 0x30,
+    0x0A, 0x85, 0x48, 0xB8, 0x92, 0x92, 0xB8, 0x48, 0x08, 0x87, 0x02, 0x9A, 0x69, 0x00, 0x00, 0x69,
+    0x9A, 0x02, 0x07, 0x87, 0x18, 0xB8, 0x38, 0x00, 0x00, 0x38, 0xB8, 0x18, 0x07, 0x87, 0x02, 0x9A,
+    0x69, 0x00, 0x00, 0x69, 0x9A, 0x02, 0x08, 0x85, 0x48, 0xB8, 0x92, 0x92, 0xB8, 0x48, 0x0A, 0x83,
+    0x30, 0x62, 0x62, 0x30, 0x50, 0x00, 0x59, 0x00, 0x04, 0x85, 0x16, 0x5D, 0x84, 0x84, 0x5D, 0x16,
+    0x08, 0x87, 0x27, 0x98, 0xA1, 0x6F, 0x6F, 0xA1, 0x98, 0x27, 0x07, 0x87, 0x84, 0x89, 0x19, 0x00,
+    0x00, 0x19, 0x89, 0x84, 0x06, 0x82, 0x27, 0xC2, 0x37, 0x43, 0x00, 0x82, 0x37, 0xC2, 0x27, 0x05,
+    0x82, 0x38, 0xB9, 0x19, 0x43, 0x00, 0x82, 0x19, 0xB9, 0x38, 0x05, 0x82, 0x27, 0xC2, 0x37, 0x43,
+    0x00, 0x82, 0x37, 0xC2, 0x27, 0x06, 0x87, 0x84, 0x89, 0x19, 0x00, 0x00, 0x19, 0x89, 0x84, 0x07,
+    0x87, 0x27, 0x98, 0xA1, 0x6F, 0x6F, 0xA1, 0x98, 0x27, 0x08, 0x85, 0x16, 0x5D, 0x84, 0x84, 0x5D,
+    0x16, 0x50, 0x00, 0x63, 0x00, 0x02, 0x89, 0x05, 0x76, 0xBB, 0x74, 0x4D, 0x4D, 0x74, 0xBB, 0x76,
+    0x05, 0x05, 0x82, 0x67, 0xAA, 0x39, 0x43, 0x00, 0x82, 0x39, 0xAA, 0x67, 0x04, 0x82, 0x20, 0xB5,
+    0x4D, 0x45, 0x00, 0x82, 0x4D, 0xB5, 0x20, 0x03, 0x82, 0x4A, 0xAA, 0x0F, 0x45, 0x00, 0x82, 0x0F,
+    0xAA, 0x4A, 0x03, 0x81, 0x58, 0x99, 0x47, 0x00, 0x81, 0x99, 0x58, 0x03, 0x82, 0x4A, 0xAA, 0x0F,
+    0x45, 0x00, 0x82, 0x0F, 0xAA, 0x4A, 0x03, 0x82, 0x20, 0xB5, 0x4D, 0x45, 0x00, 0x82, 0x4D, 0xB5,
+    0x20, 0x04, 0x82, 0x67, 0xAA, 0x39, 0x43, 0x00, 0x82, 0x39, 0xAA, 0x67, 0x05, 0x89, 0x05, 0x76,
+    0xBB, 0x74, 0x4D, 0x4D, 0x74, 0xBB, 0x76, 0x05, 0x50, 0x00, 0x5D, 0x00, 0x01, 0x82, 0x48, 0xC5,
+    0x5B, 0x45, 0x00, 0x82, 0x5B, 0xC5, 0x48, 0x02, 0x82, 0x0F, 0x9E, 0x6A, 0x47, 0x00, 0x82, 0x6A,
+    0x9E, 0x0F, 0x01, 0x82, 0x48, 0xB1, 0x1C, 0x47, 0x00, 0x82, 0x1C, 0xB1, 0x48, 0x01, 0x81, 0x6C,
+    0x87, 0x49, 0x00, 0x81, 0x87, 0x6C, 0x01, 0x81, 0x78, 0x78, 0x49, 0x00, 0x81, 0x78, 0x78, 0x01,
+    0x81, 0x6C, 0x87, 0x49, 0x00, 0x81, 0x87, 0x6C, 0x01, 0x82, 0x48, 0xB1, 0x1C, 0x47, 0x00, 0x82,
+    0x1C, 0xB1, 0x48, 0x01, 0x82, 0x0F, 0x9E, 0x6A, 0x47, 0x00, 0x82, 0x6A, 0x9E, 0x0F, 0x02, 0x82,
+    0x48, 0xC5, 0x5B, 0x45, 0x00, 0x82, 0x5B, 0xC5, 0x48, 0x50, 0x00, 0x4B, 0x00, 0x83, 0x00, 0x83,
+    0x89, 0x0C, 0x47, 0x00, 0x86, 0x0C, 0x89, 0x83, 0x00, 0x3C, 0xC2, 0x33, 0x49, 0x00, 0x84, 0x33,
+    0xC2, 0x3C, 0x6F, 0x89, 0x4B, 0x00, 0x83, 0x89, 0x6F, 0x8E, 0x65, 0x4B, 0x00, 0x83, 0x65, 0x8E,
+    0x98, 0x59, 0x4B, 0x00, 0x83, 0x59, 0x98, 0x8E, 0x65, 0x4B, 0x00, 0x83, 0x65, 0x8E, 0x6F, 0x89,
+    0x4B, 0x00, 0x84, 0x89, 0x6F, 0x3C, 0xC2, 0x33, 0x49, 0x00, 0x86, 0x33, 0xC2, 0x3C, 0x00, 0x83,
+    0x89, 0x0C, 0x47, 0x00, 0x82, 0x0C, 0x89, 0x83, 0x50, 0x00, 0x36, 0x00, 0x81, 0xB9, 0x4E, 0x4B,
+    0x00, 0x83, 0x4E, 0xB9, 0x95, 0x02, 0x4B, 0x00, 0x82, 0x02, 0x95, 0x62, 0x4D, 0x00, 0x81, 0x62,
+    0x43, 0x4D, 0x00, 0x81, 0x43, 0x38, 0x4D, 0x00, 0x81, 0x38, 0x43, 0x4D, 0x00, 0x81, 0x43, 0x62,
+    0x4D, 0x00, 0x82, 0x62, 0x95, 0x02, 0x4B, 0x00, 0x83, 0x02, 0x95, 0xB9, 0x4E, 0x4B, 0x00, 0x81,
+    0x4E, 0xB9,
+};
+
+IS31FL3731_MemorySource   source(RIPPLE_SEQUENCE, sizeof(RIPPLE_SEQUENCE));
+IS31FL3731_SequencePlayer player;
+
+int main(void)
+{
+    hw.Init();
+
+    I2CHandle::Config i2c_conf;
+    i2c_conf.periph         = I2CHandle::Config::Peripheral::I2C_1;
+    i2c_conf.mode           = I2CHandle::Config::Mode::I2C_MASTER;
+    i2c_conf.speed          = I2CHandle::Config::Speed::I2C_400KHZ;
+    i2c_conf.pin_config.scl = {DSY_GPIOB, 8};
+    i2c_conf.pin_config.sda = {DSY_GPIOB, 9};
+
+    I2CHandle i2c_handle;
+    if(i2c_handle.Init(i2c_conf) != I2CHandle::Result::OK)
+    {
+        return -1;
+    }
+
+    if(!ledmatrix.begin(ISSI_ADDR_DEFAULT, &i2c_handle))
+    {
+        return -1;
+    }
+
+    IS31FL3731_Graphics::Config gfx_cfg;
+    gfx_cfg.Defaults();
+    gfx_cfg.driver = &ledmatrix;
+    gfx_cfg.frame = 0;
+
+    if(!display.Init(gfx_cfg))
+    {
+        return -1;
+    }
+
+    IS31FL3731_SequencePlayer::Config seq_cfg;
+    seq_cfg.Defaults();
+    seq_cfg.source = &source;
+    seq_cfg.canvas = display.target();
+
+    if(!player.Init(seq_cfg))
+    {
+        return -1;
+    }
+
+    while(1)
+    {
+        // Only the pixels a frame changed are written to the chip.
+        if(player.tick(System::GetNow()))
+        {
+            display.update();
+        }
+        System::Delay(1);
+    }
+}
@@ -0,0 +1,86 @@
+#include "daisy_seed.h"
+#include "../lib/is31fl3731/is31fl3731.h"
+#include "../lib/is31fl3731_graphics/IS31FL3731_Graphics.h"
+#include "../lib/is31fl3731_graphics/IS31FL3731_Spectrum.h"
+
+using namespace daisy;
+
+DaisySeed  hw;
+IS31FL3731 ledmatrix;
+IS31FL3731_Graphics display;
+IS31FL3731_Spectrum spectrum;
+
+const uint32_t FRAME_MS = 20;
+
+void AudioCallback(AudioHandle::InputBuffer  in,
+                   AudioHandle::OutputBuffer out,
+                   size_t                    size)
+{
+    for(size_t i = 0; i < size; i++)
+    {
+        out[0][i] = in[0][i];
+        out[1][i] = in[1][i];
+    }
+
+    // Only a copy into the lock-free ring; the FFT runs in the main loop.
+    spectrum.pushAudio(in[0], size);
+}
+
+int main(void)
+{
+    hw.Init();
+
+    I2CHandle::Config i2c_conf;
+    i2c_conf.periph         = I2CHandle::Config::Peripheral::I2C_1;
+    i2c_conf.mode           = I2CHandle::Config::Mode::I2C_MASTER;
+    i2c_conf.speed          = I2CHandle::Config::Speed::I2C_400KHZ;
+    i2c_conf.pin_config.scl = {DSY_GPIOB, 8};
+    i2c_conf.pin_config.sda = {DSY_GPIOB, 9};
+
+    I2CHandle i2c_handle;
+    if(i2c_handle.Init(i2c_conf) != I2CHandle::Result::OK)
+    {
+        return -1;
+    }
+
+    if(!ledmatrix.begin(ISSI_ADDR_DEFAULT, &i2c_handle))
+    {
+        return -1;
+    }
+
+    IS31FL3731_Graphics::Config gfx_cfg;
+    gfx_cfg.Defaults();
+    gfx_cfg.driver = &ledmatrix;
+    gfx_cfg.frame = 0;
+
+    if(!display.Init(gfx_cfg))
+    {
+        return -1;
+    }
+
+    IS31FL3731_Spectrum::Config spectrum_cfg;
+    spectrum_cfg.Defaults();
+    spectrum_cfg.sample_rate = (uint32_t)hw.AudioSampleRate();
+    spectrum_cfg.bands       = display.width();
+    if(!spectrum.Init(spectrum_cfg))
+    {
+        return -1;
+    }
+
+    hw.StartAudio(AudioCallback);
+
+    uint32_t frame_time = System::GetNow();
+
+    while(1)
+    {
+        spectrum.process();
+
+        uint32_t now = System::GetNow();
+        if(now - frame_time >= FRAME_MS)
+        {
+            frame_time = now;
+            spectrum.render(display.target(), now);
+            display.update();
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#include "daisy_seed.h"
+#include "../lib/is31fl3731/is31fl3731.h"
+#include "../lib/is31fl3731_graphics/IS31FL3731_Graphics.h"
+#include "../lib/is31fl3731_graphics/IS31FL3731_TextScroller.h"
+#include <stdio.h>
+
+using namespace daisy;
+
+DaisySeed  hw;
+IS31FL3731 ledmatrix;
+IS31FL3731_Graphics display;
+
+IS31FL3731_StaticCanvas<192, 7> text_strip;
+IS31FL3731_TextScroller         marquee;
+
+int main(void)
+{
+    hw.Init();
+
+    I2CHandle::Config i2c_conf;
+    i2c_conf.periph         = I2CHandle::Config::Peripheral::I2C_1;
+    i2c_conf.mode           = I2CHandle::Config::Mode::I2C_MASTER;
+    i2c_conf.speed          = I2CHandle::Config::Speed::I2C_400KHZ;
+    i2c_conf.pin_config.scl = {DSY_GPIOB, 8};
+    i2c_conf.pin_config.sda = {DSY_GPIOB, 9};
+
+    I2CHandle i2c_handle;
+    if(i2c_handle.Init(i2c_conf) != I2CHandle::Result::OK)
+    {
+        return -1;
+    }
+
+    if(!ledmatrix.begin(ISSI_ADDR_DEFAULT, &i2c_handle))
+    {
+        return -1;
+    }
+
+    IS31FL3731_Graphics::Config gfx_cfg;
+    gfx_cfg.Defaults();
+    gfx_cfg.driver = &ledmatrix;
+    gfx_cfg.frame = 0;
+
+    if(!display.Init(gfx_cfg))
+    {
+        return -1;
+    }
+
+    IS31FL3731_TextScroller::Config scroll_cfg;
+    scroll_cfg.Defaults();
+    scroll_cfg.gfx        = &display;
+    scroll_cfg.strip      = &text_strip;
+    scroll_cfg.font       = &IS31FL3731_FONT_5X7;
+    scroll_cfg.y          = 1;
+    scroll_cfg.brightness = 180;
+    scroll_cfg.step_ms    = 70;
+    marquee.Init(scroll_cfg);
+    marquee.setText("Hello from Daisy!");
+
+    uint32_t count      = 0;
+    uint32_t last_count = 0;
+    char     counter[12];
+
+    while(1)
+    {
+        uint32_t now = System::GetNow();
+
+        // Only the window copy runs per frame; the glyphs were rasterized
+        // once by setText().
+        if(marquee.tick(now))
+        {
+            display.update();
+        }
+
+        if(now - last_count > 5000)
+        {
+            last_count = now;
+            count++;
+            snprintf(counter, sizeof(counter), "%lu", (unsigned long)count);
+            marquee.setText(counter);
+        }
+    }
+}
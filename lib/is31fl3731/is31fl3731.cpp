@@ -11,8 +11,18 @@
     } while(0)
 
 IS31FL3731::IS31FL3731(uint8_t x, uint8_t y)
-: width_(x), height_(y), i2c_handle_(nullptr)
+: width_(x),
+  height_(y),
+  i2c_handle_(nullptr),
+  bank_(BANK_UNKNOWN),
+  trace_(nullptr)
 {
+    memset(shadow_, 0, sizeof(shadow_));
+    memset(function_shadow_, 0, sizeof(function_shadow_));
+    memset(dirty_, 0, sizeof(dirty_));
+    transfer_.Defaults();
+    resetBusStats();
+    stats_.reset();
 }
 
 IS31FL3731::~IS31FL3731() {}
@@ -42,52 +52,223 @@ bool IS31FL3731::begin(uint8_t addr, I2CHandle* i2c_handle)
     }
 
     _frame = 0;
+    bank_  = BANK_UNKNOWN;
+    IS31FL3731_Timer::start();
 
-    writeRegister8(ISSI_BANK_FUNCTIONREG, ISSI_REG_SHUTDOWN, 0x00);
+    if(!writeRegister8(ISSI_BANK_FUNCTIONREG, ISSI_REG_SHUTDOWN, 0x00))
+    {
+        return false;
+    }
     System::Delay(10);
-    writeRegister8(ISSI_BANK_FUNCTIONREG, ISSI_REG_SHUTDOWN, 0x01);
 
-    writeRegister8(
-        ISSI_BANK_FUNCTIONREG, ISSI_REG_CONFIG, ISSI_REG_CONFIG_PICTUREMODE);
+    // Whatever the chip held before is unknown, so every register goes out
+    // from the shadow: all LEDs on, no blinking, every frame black, picture
+    // mode showing frame 0 without audio sync or breathing. The function
+    // bank comes last, so the chip leaves shutdown with the frames clear.
+    for(uint8_t f = 0; f < 8; f++)
+    {
+        memset(shadow_[f], 0xff, 0x12);
+        memset(&shadow_[f][0x12], 0x00, ISSI_FRAME_REGS - 0x12);
+    }
+    memset(function_shadow_, 0, sizeof(function_shadow_));
+    function_shadow_[ISSI_REG_CONFIG]   = ISSI_REG_CONFIG_PICTUREMODE;
+    function_shadow_[ISSI_REG_SHUTDOWN] = 0x01;
+    invalidateShadow();
 
-    displayFrame(_frame);
+    return sync();
+}
 
-    clear();
+bool IS31FL3731::clear(void)
+{
+    uint8_t erasebuf[25];
+    bool    ok = true;
 
-    for(uint8_t f = 0; f < 8; f++)
+    memset(erasebuf, 0, 25);
+
+    for(uint8_t i = 0; i < 6; i++)
+    {
+        erasebuf[0] = 0x24 + i * 24;
+        ok &= transmit(_frame, erasebuf, 25);
+    }
+    return ok;
+}
+
+bool IS31FL3731::setLEDPWM(uint8_t lednum, uint8_t pwm, uint8_t bank)
+{
+    if(lednum >= 144 || bank > 7)
+    {
+        return false;
+    }
+    return writeRegister8(bank, 0x24 + lednum, pwm);
+}
+
+bool IS31FL3731::setLEDPWMBurst(uint8_t        lednum,
+                                const uint8_t* pwm,
+                                uint8_t        count,
+                                uint8_t        bank)
+{
+    if(lednum >= 144 || count == 0 || bank > 7)
+    {
+        return false;
+    }
+    if(count > 144 - lednum)
+    {
+        count = 144 - lednum;
+    }
+
+    return transmitBurst(bank, lednum, pwm, count);
+}
+
+// The chip auto-increments the register address, so a run of LEDs goes
+// out as a single transaction. The bank is only selected when it is not
+// already.
+bool IS31FL3731::transmitBurst(uint8_t        bank,
+                               uint8_t        lednum,
+                               const uint8_t* pwm,
+                               uint8_t        count)
+{
+    uint8_t cmd[145];
+    cmd[0] = 0x24 + lednum;
+    memcpy(&cmd[1], pwm, count);
+
+    return transmit(bank, cmd, count + 1);
+}
+
+uint8_t IS31FL3731::writePixels(const Update*  updates,
+                                uint16_t       count,
+                                uint8_t        bank,
+                                const uint8_t* frame)
+{
+    // Sorting by register is a counting sort: drop every update into its
+    // slot and note which slots were touched.
+    if(bank > 7)
     {
-        for(uint8_t i = 0; i <= 0x11; i++)
+        return 0;
+    }
+
+    uint8_t values[144];
+    uint8_t touched[144 / 8];
+    memset(touched, 0, sizeof(touched));
+    if(frame != nullptr)
+    {
+        memcpy(values, frame, sizeof(values));
+    }
+
+    uint8_t first = 144;
+    uint8_t last  = 0;
+    for(uint16_t i = 0; i < count; i++)
+    {
+        uint8_t led = updates[i].led;
+        if(led >= 144)
         {
-            writeRegister8(f, i, 0xff);
+            continue;
         }
+        values[led] = updates[i].pwm;
+        touched[led >> 3] |= 1 << (led & 7);
+        if(led < first)
+            first = led;
+        if(led > last)
+            last = led;
+    }
+    if(first == 144)
+    {
+        return 0;
     }
 
-    audioSync(false);
+    // Runs of touched LEDs. Without the frame only exact neighbours can
+    // share a burst; with it a gap is resent when that costs less than
+    // starting another transaction. The first pass only adds up the cost.
+    uint8_t max_gap = frame != nullptr ? ISSI_BURST_OVERHEAD : 0;
+    uint8_t runs    = 0;
+    bool    ok      = true;
+    for(uint8_t pass = 0; pass < 2; pass++)
+    {
+        uint16_t cost  = 0;
+        uint16_t start = first;
+        uint16_t end   = first;
+        runs           = 0;
+        for(uint16_t led = first + 1; led <= last + 1; led++)
+        {
+            bool hit = led <= last && (touched[led >> 3] & (1 << (led & 7)));
+            if(hit && led - end - 1 <= max_gap)
+            {
+                end = led;
+                continue;
+            }
+            if(!hit && led <= last)
+            {
+                continue;
+            }
 
-    return true;
+            // led starts a new run (or is one past the end): close the last.
+            cost += ISSI_BURST_OVERHEAD + end - start + 1;
+            runs++;
+            if(pass == 1)
+            {
+                ok &= transmitBurst(bank, start, &values[start], end - start + 1);
+            }
+            start = led;
+            end   = led;
+        }
+
+        if(pass == 0)
+        {
+            if(!selectBank(bank))
+            {
+                return 0;
+            }
+            if(frame != nullptr && cost > ISSI_BURST_OVERHEAD + 144)
+            {
+                return transmitBurst(bank, 0, values, 144) ? 1 : 0;
+            }
+        }
+    }
+    return ok ? runs : 0;
 }
 
-void IS31FL3731::clear(void)
+bool IS31FL3731::writePWMBurst(const uint8_t* burst, uint8_t count, uint8_t bank)
 {
-    selectBank(_frame);
-    uint8_t erasebuf[25];
+    if(count == 0 || bank > 7 || burst[0] < 0x24 || burst[0] - 0x24 + count > 144)
+    {
+        return false;
+    }
 
-    memset(erasebuf, 0, 25);
+    return transmit(bank, burst, count + 1);
+}
 
-    for(uint8_t i = 0; i < 6; i++)
+bool IS31FL3731::readPWM(uint8_t lednum, uint8_t* pwm, uint8_t count, uint8_t bank)
+{
+    if(lednum >= 144 || count == 0 || count > 144 - lednum || bank > 7)
     {
-        erasebuf[0] = 0x24 + i * 24;
-        i2c_handle_->TransmitBlocking(i2c_addr_, erasebuf, 25, 1000);
+        return false;
     }
+    return receive(bank, 0x24 + lednum, pwm, count);
 }
 
-void IS31FL3731::setLEDPWM(uint8_t lednum, uint8_t pwm, uint8_t bank)
+bool IS31FL3731::verifyPWM(uint8_t        lednum,
+                           const uint8_t* expected,
+                           uint8_t        count,
+                           uint8_t        bank)
 {
-    if(lednum >= 144)
+    uint8_t actual[144];
+    if(!readPWM(lednum, actual, count, bank))
     {
-        return;
+        return false;
     }
-    writeRegister8(bank, 0x24 + lednum, pwm);
+    // A register the chip lost is resent by the next sync().
+    for(uint8_t i = 0; i < count; i++)
+    {
+        if(actual[i] != shadow_[bank][0x24 + lednum + i])
+        {
+            setDirty(bank, 0x24 + lednum + i, true);
+        }
+    }
+    if(memcmp(actual, expected, count) != 0)
+    {
+        bus_stats_.verify_failures++;
+        return false;
+    }
+    return true;
 }
 
 void IS31FL3731::drawPixel(int16_t x, int16_t y, uint16_t color)
@@ -142,49 +323,554 @@ void IS31FL3731_Wing::drawPixel(int16_t x, int16_t y, uint16_t color)
 
 void IS31FL3731::setFrame(uint8_t frame)
 {
+    if(frame > 7)
+    {
+        frame = 0;
+    }
     _frame = frame;
 }
 
-void IS31FL3731::displayFrame(uint8_t frame)
+bool IS31FL3731::displayFrame(uint8_t frame)
 {
     if(frame > 7)
     {
         frame = 0;
     }
-    writeRegister8(ISSI_BANK_FUNCTIONREG, ISSI_REG_PICTUREFRAME, frame);
+    return setRegister(ISSI_BANK_FUNCTIONREG, ISSI_REG_PICTUREFRAME, frame);
 }
 
 bool IS31FL3731::selectBank(uint8_t bank)
 {
+    uint32_t start = IS31FL3731_Timer::now();
+    bool     ok;
+    for(uint8_t attempt = 0;; attempt++)
+    {
+        ok = sendBankSelect(bank);
+        if(ok || !attemptFailed(attempt))
+        {
+            break;
+        }
+    }
+    recordBlocking(start);
+    return ok;
+}
+
+bool IS31FL3731::sendBankSelect(uint8_t bank)
+{
+    if(bank == bank_)
+    {
+        return true;
+    }
+
     uint8_t cmd[2] = {ISSI_COMMANDREGISTER, bank};
-    return i2c_handle_->TransmitBlocking(i2c_addr_, cmd, 2, 1000)
-           == I2CHandle::Result::OK;
+    countTransaction(2);
+#ifndef IS31FL3731_NO_STATS
+    stats_.bank_switches++;
+#endif
+    bool ok = i2c_handle_->TransmitBlocking(i2c_addr_, cmd, 2, transfer_.timeout_ms)
+              == I2CHandle::Result::OK;
+    traceTransfer(bank, ISSI_COMMANDREGISTER, &cmd[1], 1, ok ? 0 : IS31FL3731_TRACE_FAILED);
+    if(!ok)
+    {
+        return false;
+    }
+    bank_ = bank;
+    return true;
+}
+
+bool IS31FL3731::audioSync(bool sync)
+{
+    return setRegister(ISSI_BANK_FUNCTIONREG, ISSI_REG_AUDIOSYNC, sync ? 0x1 : 0x0);
+}
+
+// Steps are base * 2^n for n 0-7, so the nearest one is found on a log
+// scale: step n is picked up to sqrt(2) times its own length.
+static uint8_t breathStep(uint32_t time, uint32_t base)
+{
+    uint8_t n = 0;
+    while(n < 7 && time * 128 > (base << n) * 181)
+    {
+        n++;
+    }
+    return n;
+}
+
+bool IS31FL3731::setBreath(const BreathConfig& config, bool enable)
+{
+    // Fades are counted in ms, the dark time in half ms.
+    uint8_t fade_in  = breathStep(config.fade_in_ms, 26);
+    uint8_t fade_out = breathStep(config.fade_out_ms, 26);
+    uint8_t dark     = breathStep(config.extinguish_ms * 2u, 7);
+
+    uint8_t regs[2] = {(uint8_t)((fade_out << 4) | fade_in),
+                       (uint8_t)((enable ? ISSI_BREATH_ENABLE : 0) | dark)};
+    return setRegisters(ISSI_BANK_FUNCTIONREG, ISSI_REG_BREATHCTRL1, regs, 2);
+}
+
+bool IS31FL3731::enableBreath(bool enable)
+{
+    uint8_t ctrl2 = function_shadow_[ISSI_REG_BREATHCTRL2] & ~ISSI_BREATH_ENABLE;
+    return setRegister(ISSI_BANK_FUNCTIONREG,
+                       ISSI_REG_BREATHCTRL2,
+                       ctrl2 | (enable ? ISSI_BREATH_ENABLE : 0));
+}
+
+IS31FL3731::BreathConfig IS31FL3731::breath() const
+{
+    uint8_t      ctrl1 = function_shadow_[ISSI_REG_BREATHCTRL1];
+    uint8_t      ctrl2 = function_shadow_[ISSI_REG_BREATHCTRL2];
+    BreathConfig config;
+    config.fade_in_ms    = 26 << (ctrl1 & 0x07);
+    config.fade_out_ms   = 26 << ((ctrl1 >> 4) & 0x07);
+    config.extinguish_ms = (7 << (ctrl2 & 0x07)) / 2;
+    return config;
+}
+
+bool IS31FL3731::sleep()
+{
+    return setRegister(ISSI_BANK_FUNCTIONREG, ISSI_REG_SHUTDOWN, 0x00);
+}
+
+// Written straight through rather than with setRegister(), which would
+// sync() every other dirty register first. Those go out with the next
+// sync(); the transfer keeps the shadow of this one up to date.
+bool IS31FL3731::wake()
+{
+    uint32_t start = IS31FL3731_Timer::now();
+    bool     ok    = writeRegister8(ISSI_BANK_FUNCTIONREG, ISSI_REG_SHUTDOWN, 0x01);
+    recordWake(start);
+    return ok;
+}
+
+bool IS31FL3731::restore(const uint8_t* pwm, uint8_t bank)
+{
+    uint32_t start = IS31FL3731_Timer::now();
+
+    // The command register is back at its reset value, whatever was
+    // selected before.
+    bank_ = BANK_UNKNOWN;
+
+    if(pwm != nullptr && bank <= 7)
+    {
+        memcpy(&shadow_[bank][0x24], pwm, 144);
+    }
+    for(uint8_t b = 0; b < 9; b++)
+    {
+        uint8_t        id = b < 8 ? b : ISSI_BANK_FUNCTIONREG;
+        uint8_t        index = 0;
+        uint8_t        size  = 0;
+        const uint8_t* regs = shadowRegs(id, index, size);
+        if(regs == nullptr)
+        {
+            continue;
+        }
+        for(uint8_t r = 0; r < size; r++)
+        {
+            setDirty(index, r, regs[r] != 0 && writable(id, r));
+        }
+    }
+
+    bool ok = sync();
+    recordWake(start);
+    return ok;
 }
 
-void IS31FL3731::audioSync(bool sync)
+void IS31FL3731::recordWake(uint32_t start)
 {
-    if(sync)
+#ifndef IS31FL3731_NO_STATS
+    uint32_t us    = IS31FL3731_Timer::toMicros(IS31FL3731_Timer::now() - start);
+    stats_.wake_us = us;
+    if(us > stats_.max_wake_us)
+    {
+        stats_.max_wake_us = us;
+    }
+#endif
+}
+
+uint8_t* IS31FL3731::shadowRegs(uint8_t bank, uint8_t& index, uint8_t& size)
+{
+    index = 0;
+    size  = 0;
+    if(bank <= 7)
+    {
+        index = bank;
+        size  = ISSI_FRAME_REGS;
+        return shadow_[bank];
+    }
+    if(bank == ISSI_BANK_FUNCTIONREG)
     {
-        writeRegister8(ISSI_BANK_FUNCTIONREG, ISSI_REG_AUDIOSYNC, 0x1);
+        index = 8;
+        size  = ISSI_FUNCTION_REGS;
+        return function_shadow_;
+    }
+    return nullptr;
+}
+
+// Reserved 0x04 and the read-only frame state 0x07 are never written.
+bool IS31FL3731::writable(uint8_t bank, uint8_t reg)
+{
+    if(bank == ISSI_BANK_FUNCTIONREG)
+    {
+        return reg < ISSI_FUNCTION_REGS && reg != 0x04 && reg != 0x07;
+    }
+    return bank <= 7 && reg < ISSI_FRAME_REGS;
+}
+
+void IS31FL3731::setDirty(uint8_t index, uint8_t reg, bool dirty)
+{
+    uint8_t bit = 1 << (reg & 7);
+    if(dirty)
+    {
+        dirty_[index][reg >> 3] |= bit;
     }
     else
     {
-        writeRegister8(ISSI_BANK_FUNCTIONREG, ISSI_REG_AUDIOSYNC, 0x0);
+        dirty_[index][reg >> 3] &= ~bit;
+    }
+}
+
+// Every transfer passes through here: what went out is now what the
+// register should hold, and it is on the chip unless the transfer failed.
+void IS31FL3731::storeShadow(uint8_t        bank,
+                             uint8_t        reg,
+                             const uint8_t* values,
+                             uint16_t       count,
+                             bool           dirty)
+{
+    uint8_t  index = 0;
+    uint8_t  size  = 0;
+    uint8_t* regs = shadowRegs(bank, index, size);
+    if(regs == nullptr)
+    {
+        return;
+    }
+    for(uint16_t i = 0; i < count && reg + i < size; i++)
+    {
+        regs[reg + i] = values[i];
+        setDirty(index, reg + i, dirty && writable(bank, reg + i));
+    }
+}
+
+bool IS31FL3731::setRegisters(uint8_t bank, uint8_t reg, const uint8_t* values, uint8_t count)
+{
+    uint8_t  index = 0;
+    uint8_t  size  = 0;
+    uint8_t* regs = shadowRegs(bank, index, size);
+    if(regs == nullptr || count == 0 || reg + count > size)
+    {
+        return false;
+    }
+    for(uint8_t i = 0; i < count; i++)
+    {
+        if(!writable(bank, reg + i))
+        {
+            return false;
+        }
+    }
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        if(regs[reg + i] != values[i])
+        {
+            regs[reg + i] = values[i];
+            setDirty(index, reg + i, true);
+        }
+    }
+    return sync();
+}
+
+uint8_t IS31FL3731::shadowRegister(uint8_t bank, uint8_t reg) const
+{
+    if(bank <= 7 && reg < ISSI_FRAME_REGS)
+    {
+        return shadow_[bank][reg];
+    }
+    if(bank == ISSI_BANK_FUNCTIONREG && reg < ISSI_FUNCTION_REGS)
+    {
+        return function_shadow_[reg];
+    }
+    return 0;
+}
+
+// LED n has bit n % 8 of control register n / 8, in the same order as the
+// PWM registers; blink control follows 0x12 on.
+bool IS31FL3731::setLEDEnabled(uint8_t lednum, bool enabled, uint8_t bank)
+{
+    if(lednum >= 144 || bank > 7)
+    {
+        return false;
+    }
+    uint8_t reg = lednum >> 3;
+    uint8_t bit = 1 << (lednum & 7);
+    return setRegister(bank, reg, enabled ? shadow_[bank][reg] | bit : shadow_[bank][reg] & ~bit);
+}
+
+bool IS31FL3731::setLEDBlink(uint8_t lednum, bool blink, uint8_t bank)
+{
+    if(lednum >= 144 || bank > 7)
+    {
+        return false;
+    }
+    uint8_t reg = 0x12 + (lednum >> 3);
+    uint8_t bit = 1 << (lednum & 7);
+    return setRegister(bank, reg, blink ? shadow_[bank][reg] | bit : shadow_[bank][reg] & ~bit);
+}
+
+bool IS31FL3731::sync()
+{
+    bool ok = true;
+    for(uint8_t f = 0; f < 8; f++)
+    {
+        ok &= syncBank(f);
+    }
+    return syncBank(ISSI_BANK_FUNCTIONREG) && ok;
+}
+
+bool IS31FL3731::shadowDirty() const
+{
+    for(uint8_t b = 0; b < 9; b++)
+    {
+        for(uint8_t i = 0; i < sizeof(dirty_[b]); i++)
+        {
+            if(dirty_[b][i] != 0)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void IS31FL3731::invalidateShadow()
+{
+    for(uint8_t r = 0; r < ISSI_FRAME_REGS; r++)
+    {
+        for(uint8_t f = 0; f < 8; f++)
+        {
+            setDirty(f, r, true);
+        }
+        if(r < ISSI_FUNCTION_REGS)
+        {
+            setDirty(8, r, writable(ISSI_BANK_FUNCTIONREG, r));
+        }
+    }
+}
+
+// Same trade as in writePixels(): a gap of clean registers is cheaper to
+// resend than a new transaction, up to ISSI_BURST_OVERHEAD of them. The
+// function bank's unwritable registers always split a run.
+bool IS31FL3731::syncBank(uint8_t bank)
+{
+    uint8_t  index = 0;
+    uint8_t  size  = 0;
+    uint8_t* regs = shadowRegs(bank, index, size);
+    if(regs == nullptr)
+    {
+        return false;
     }
+
+    bool any = false;
+    for(uint8_t i = 0; i < sizeof(dirty_[index]); i++)
+    {
+        any |= dirty_[index][i] != 0;
+    }
+    if(!any)
+    {
+        return true;
+    }
+
+    uint8_t cmd[1 + ISSI_FRAME_REGS];
+    bool    ok = true;
+    uint8_t r  = 0;
+    while(r < size)
+    {
+        if(!isDirty(index, r))
+        {
+            r++;
+            continue;
+        }
+
+        uint8_t last = r;
+        for(uint8_t next = r + 1; next < size && next - last - 1 <= ISSI_BURST_OVERHEAD; next++)
+        {
+            if(!writable(bank, next))
+            {
+                break;
+            }
+            if(isDirty(index, next))
+            {
+                last = next;
+            }
+        }
+
+        cmd[0] = r;
+        memcpy(&cmd[1], &regs[r], last - r + 1);
+        ok &= transmit(bank, cmd, last - r + 2);
+        r = last + 1;
+    }
+    return ok;
 }
 
 bool IS31FL3731::writeRegister8(uint8_t bank, uint8_t reg, uint8_t data)
 {
-    selectBank(bank);
     uint8_t cmd[2] = {reg, data};
-    return i2c_handle_->TransmitBlocking(i2c_addr_, cmd, 2, 1000)
-           == I2CHandle::Result::OK;
+    return transmit(bank, cmd, 2);
 }
 
 uint8_t IS31FL3731::readRegister8(uint8_t bank, uint8_t reg)
 {
     uint8_t val = 0xFF;
-    selectBank(bank);
-    i2c_handle_->ReadDataAtAddress(i2c_addr_, reg, 1, &val, 1, 1000);
+    if(!receive(bank, reg, &val, 1))
+    {
+        return 0xFF;
+    }
     return val;
 }
+
+void IS31FL3731::resetBusStats()
+{
+    memset(&bus_stats_, 0, sizeof(bus_stats_));
+}
+
+// A failed transaction may or may not have reached the chip, so the bank
+// selection is forgotten and the next attempt starts by selecting it.
+bool IS31FL3731::transmit(uint8_t bank, const uint8_t* data, uint16_t size)
+{
+    uint32_t start = IS31FL3731_Timer::now();
+    bool     ok    = false;
+    for(uint8_t attempt = 0;; attempt++)
+    {
+        if(sendBankSelect(bank))
+        {
+            countTransaction(size);
+            ok = i2c_handle_->TransmitBlocking(i2c_addr_,
+                                               const_cast<uint8_t*>(data),
+                                               size,
+                                               transfer_.timeout_ms)
+                 == I2CHandle::Result::OK;
+            traceTransfer(
+                bank, data[0], &data[1], size - 1, ok ? 0 : IS31FL3731_TRACE_FAILED);
+        }
+        if(ok || !attemptFailed(attempt))
+        {
+            break;
+        }
+    }
+    recordBlocking(start);
+    storeShadow(bank, data[0], &data[1], size - 1, !ok);
+    return ok;
+}
+
+bool IS31FL3731::receive(uint8_t bank, uint8_t reg, uint8_t* data, uint16_t size)
+{
+    uint32_t start = IS31FL3731_Timer::now();
+    bool     ok    = false;
+    for(uint8_t attempt = 0;; attempt++)
+    {
+        if(sendBankSelect(bank))
+        {
+            countTransaction(size + 1);
+            ok = i2c_handle_->ReadDataAtAddress(
+                     i2c_addr_, reg, 1, data, size, transfer_.timeout_ms)
+                 == I2CHandle::Result::OK;
+            traceTransfer(bank,
+                          reg,
+                          data,
+                          size,
+                          IS31FL3731_TRACE_READ | (ok ? 0 : IS31FL3731_TRACE_FAILED));
+        }
+        if(ok || !attemptFailed(attempt))
+        {
+            break;
+        }
+    }
+    recordBlocking(start);
+    return ok;
+}
+
+void IS31FL3731::countTransaction(uint16_t bytes)
+{
+#ifndef IS31FL3731_NO_STATS
+    stats_.transactions++;
+    stats_.bytes += bytes;
+#endif
+}
+
+void IS31FL3731::traceTransfer(uint8_t        bank,
+                               uint8_t        reg,
+                               const uint8_t* payload,
+                               uint16_t       length,
+                               uint8_t        flags)
+{
+    if(trace_ != nullptr)
+    {
+        trace_->record(System::GetUs(), i2c_addr_, bank, reg, payload, length, flags);
+    }
+}
+
+void IS31FL3731::recordBlocking(uint32_t start)
+{
+#ifndef IS31FL3731_NO_STATS
+    uint32_t us = IS31FL3731_Timer::toMicros(IS31FL3731_Timer::now() - start);
+    stats_.busy_us += us;
+    if(us > stats_.max_blocking_us)
+    {
+        stats_.max_blocking_us = us;
+    }
+#endif
+}
+
+// Books a failed attempt and gets the bus ready for the next one. Returns
+// false once the retries are used up.
+bool IS31FL3731::attemptFailed(uint8_t attempt)
+{
+    bus_stats_.errors++;
+    bank_ = BANK_UNKNOWN;
+    if(attempt >= transfer_.retries)
+    {
+        bus_stats_.failures++;
+        return false;
+    }
+    bus_stats_.retries++;
+    if(transfer_.recover_bus)
+    {
+        recoverBus();
+    }
+    return true;
+}
+
+// A slave that lost a clock edge mid-byte holds SDA low until it has
+// shifted out the rest of the byte. Up to nine clocks on SCL let it finish,
+// a STOP resets its state machine, and the peripheral is reinitialized
+// because the pins were taken away from it.
+void IS31FL3731::recoverBus()
+{
+    I2CHandle::Config cfg = i2c_handle_->GetConfig();
+
+    GPIO scl, sda;
+    sda.Init(cfg.pin_config.sda, GPIO::Mode::INPUT, GPIO::Pull::PULLUP);
+    scl.Init(cfg.pin_config.scl, GPIO::Mode::OPEN_DRAIN, GPIO::Pull::PULLUP);
+    scl.Write(true);
+    System::DelayUs(5);
+
+    for(uint8_t i = 0; i < 9 && !sda.Read(); i++)
+    {
+        scl.Write(false);
+        System::DelayUs(5);
+        scl.Write(true);
+        System::DelayUs(5);
+    }
+
+    // STOP: SDA rises while SCL is high.
+    scl.Write(false);
+    sda.Init(cfg.pin_config.sda, GPIO::Mode::OPEN_DRAIN, GPIO::Pull::PULLUP);
+    sda.Write(false);
+    System::DelayUs(5);
+    scl.Write(true);
+    System::DelayUs(5);
+    sda.Write(true);
+    System::DelayUs(5);
+
+    i2c_handle_->Init(cfg);
+    bus_stats_.recoveries++;
+}
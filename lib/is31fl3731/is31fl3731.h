@@ -2,6 +2,8 @@
 #define IS31FL3731_H
 
 #include "daisy_seed.h"
+#include "is31fl3731_stats.h"
+#include "is31fl3731_trace.h"
 #include <stdint.h>
 
 using namespace daisy;
@@ -21,25 +23,194 @@ using namespace daisy;
 
 #define ISSI_REG_SHUTDOWN 0x0A
 #define ISSI_REG_AUDIOSYNC 0x06
+#define ISSI_REG_BREATHCTRL1 0x08
+#define ISSI_REG_BREATHCTRL2 0x09
+
+#define ISSI_BREATH_ENABLE 0x10
+
+// A frame bank holds LED control (0x00-0x11), blink control (0x12-0x23)
+// and PWM (0x24-0xB3); the function bank 0x00-0x0C.
+#define ISSI_FRAME_REGS 0xB4
+#define ISSI_FUNCTION_REGS 0x0D
 
 #define ISSI_COMMANDREGISTER 0xFD
 #define ISSI_BANK_FUNCTIONREG 0x0B
 
+// Cost of starting another transaction in byte times on the bus: address
+// and register bytes, start/stop and the HAL call. writePixels() resends a
+// gap of unchanged LEDs instead of splitting a burst when that is cheaper.
+#ifndef ISSI_BURST_OVERHEAD
+#define ISSI_BURST_OVERHEAD 3
+#endif
+
 class IS31FL3731
 {
   public:
+    struct Update
+    {
+        uint8_t led;
+        uint8_t pwm;
+    };
+
+    // Every transaction gets timeout_ms and is retried up to retries times.
+    // Before a retry the bus can be recovered by clocking out a slave that
+    // holds SDA low. A 144-LED burst takes ~3.5 ms at 400 kHz and ~14 ms
+    // at 100 kHz, so raise the timeout on slow buses.
+    struct TransferConfig
+    {
+        uint32_t timeout_ms;
+        uint8_t  retries;
+        bool     recover_bus;
+
+        void Defaults()
+        {
+            timeout_ms  = 10;
+            retries     = 2;
+            recover_bus = true;
+        }
+    };
+
+    struct BusStats
+    {
+        uint32_t errors;          // failed attempts, retried or not
+        uint32_t retries;         // attempts after the first
+        uint32_t failures;        // transfers that failed every attempt
+        uint32_t recoveries;      // bus recovery sequences run
+        uint32_t verify_failures; // readbacks that did not match
+    };
+
+    // The chip fades the displayed frame in and out by itself, over and
+    // over, with no bus traffic: fade in, fade out, stay dark for
+    // extinguish_ms. Fades take 26 ms * 2^n (26 to 3328 ms), the dark time
+    // 3.5 ms * 2^n (3.5 to 448 ms); other times round to the nearest step.
+    struct BreathConfig
+    {
+        uint16_t fade_in_ms;
+        uint16_t fade_out_ms;
+        uint16_t extinguish_ms;
+
+        void Defaults()
+        {
+            fade_in_ms    = 832;
+            fade_out_ms   = 832;
+            extinguish_ms = 112;
+        }
+    };
+
     IS31FL3731(uint8_t x = 16, uint8_t y = 9);
     ~IS31FL3731();
 
+    // Returns false if the chip does not acknowledge.
     bool begin(uint8_t    addr       = ISSI_ADDR_DEFAULT,
                I2CHandle* i2c_handle = nullptr);
     void drawPixel(int16_t x, int16_t y, uint16_t color);
-    void clear(void);
+    bool clear(void);
 
-    void setLEDPWM(uint8_t lednum, uint8_t pwm, uint8_t bank = 0);
-    void audioSync(bool sync);
+    void setTransferConfig(const TransferConfig& config) { transfer_ = config; }
+    const BusStats& busStats() const { return bus_stats_; }
+    void            resetBusStats();
+
+    // Bus traffic and time spent blocking; all zero with IS31FL3731_NO_STATS.
+    const IS31FL3731_DriverStats& stats() const { return stats_; }
+    void                          resetStats() { stats_.reset(); }
+
+    // Records every transaction, failed attempts included; nullptr stops.
+    void attachTrace(IS31FL3731_Trace* trace) { trace_ = trace; }
+
+    // PWM writes and reads take a frame bank 0-7 and return false for any
+    // other bank or an LED past 143, so nothing reaches the chip outside
+    // its PWM registers.
+    bool setLEDPWM(uint8_t lednum, uint8_t pwm, uint8_t bank = 0);
+    bool setLEDPWMBurst(uint8_t        lednum,
+                        const uint8_t* pwm,
+                        uint8_t        count,
+                        uint8_t        bank = 0);
+    // Sends a ready-made burst as is: burst[0] is the first PWM register
+    // (0x24 + lednum) and count PWM values follow. No copy is made, so the
+    // data can sit in memory-mapped flash.
+    bool writePWMBurst(const uint8_t* burst, uint8_t count, uint8_t bank = 0);
+    // Writes (led, pwm) updates given in any order; a later entry for the
+    // same LED wins. Neighbouring LEDs are coalesced into bursts. If frame
+    // holds the bank's current 144 values, short gaps are bridged with
+    // them and one full-frame burst is used when that is cheaper. Returns
+    // the number of bursts sent, or 0 if nothing was sent or any burst
+    // failed.
+    uint8_t writePixels(const Update*   updates,
+                        uint16_t        count,
+                        uint8_t         bank  = 0,
+                        const uint8_t*  frame = nullptr);
+    bool audioSync(bool sync);
+    // Programs the breath times and turns breathing on or off.
+    bool setBreath(const BreathConfig& config, bool enable = true);
+    // Keeps the programmed times.
+    bool enableBreath(bool enable);
+    bool breathEnabled() const
+    {
+        return (function_shadow_[ISSI_REG_BREATHCTRL2] & ISSI_BREATH_ENABLE) != 0;
+    }
+    // The times the chip runs, after rounding to its steps.
+    BreathConfig breath() const;
+
+    // Software shutdown: the LEDs go dark and the chip draws a few uA, but
+    // every register is kept. wake() writes only the shutdown register, so
+    // it costs one transaction plus at most one bank select per attempt of
+    // the TransferConfig; other dirty registers wait for the next sync().
+    // The time wake() takes is in stats().wake_us.
+    bool sleep();
+    bool wake();
+    bool asleep() const { return (function_shadow_[ISSI_REG_SHUTDOWN] & 0x01) == 0; }
+    // For a chip that lost power, so every register is back at 0: sends
+    // each shadow register that is not, with no shutdown pulse, no delay
+    // and no clear. If pwm is given, those 144 values replace the shadow
+    // of bank first. The chip is lit last, unless it was asleep.
+    bool restore(const uint8_t* pwm = nullptr, uint8_t bank = 0);
+
+    // The driver keeps a shadow of every frame and function register, with
+    // a dirty bit for each one not known to be on the chip. PWM calls
+    // still write through at once and only keep the shadow current.
+    // Configuration calls change the shadow and then sync(), so repeating
+    // one costs nothing on the bus.
+    //
+    // Changes count registers from reg in a frame bank 0-7 or the function
+    // bank, then syncs. Returns false for registers past the end of the
+    // bank and for the function bank's reserved 0x04 and read-only 0x07.
+    bool setRegisters(uint8_t bank, uint8_t reg, const uint8_t* values, uint8_t count);
+    bool setRegister(uint8_t bank, uint8_t reg, uint8_t value)
+    {
+        return setRegisters(bank, reg, &value, 1);
+    }
+    // What the register should hold; 0 outside the register map.
+    uint8_t shadowRegister(uint8_t bank, uint8_t reg) const;
+    // The 144 PWM values a frame bank should hold, for code that diffs
+    // against them before writing; nullptr past bank 7.
+    const uint8_t* shadowPWM(uint8_t bank) const
+    {
+        return bank <= 7 ? &shadow_[bank][0x24] : nullptr;
+    }
+    // The LED's bits in a frame's LED control and blink control registers.
+    bool setLEDEnabled(uint8_t lednum, bool enabled, uint8_t bank = 0);
+    bool setLEDBlink(uint8_t lednum, bool blink, uint8_t bank = 0);
+    // Sends every dirty register, the frames first and the function bank
+    // last, so leaving shutdown comes after the frame contents. Each run
+    // of dirty registers is one burst; up to ISSI_BURST_OVERHEAD clean ones
+    // between two runs are resent rather than splitting it. Returns false
+    // if a burst failed; its registers stay dirty for the next sync().
+    bool sync();
+    bool shadowDirty() const;
+    // For a chip changed behind the driver's back: the next sync() sends
+    // every register.
+    void invalidateShadow();
+    // Frames past 7 fall back to 0, as in displayFrame().
     void setFrame(uint8_t b);
-    void displayFrame(uint8_t frame);
+    bool displayFrame(uint8_t frame);
+
+    // Burst-reads count PWM registers starting at lednum. verifyPWM()
+    // compares them with what should be there and counts mismatches.
+    bool readPWM(uint8_t lednum, uint8_t* pwm, uint8_t count, uint8_t bank = 0);
+    bool verifyPWM(uint8_t        lednum,
+                   const uint8_t* expected,
+                   uint8_t        count,
+                   uint8_t        bank = 0);
 
     uint8_t getWidth() const { return width_; }
     uint8_t getHeight() const { return height_; }
@@ -48,14 +219,56 @@ class IS31FL3731
     bool    selectBank(uint8_t bank);
     bool    writeRegister8(uint8_t bank, uint8_t reg, uint8_t data);
     uint8_t readRegister8(uint8_t bank, uint8_t reg);
+    bool    transmitBurst(uint8_t        bank,
+                          uint8_t        lednum,
+                          const uint8_t* pwm,
+                          uint8_t        count);
     uint8_t _frame;
 
   private:
-    uint8_t    width_;
-    uint8_t    height_;
-    uint8_t    i2c_addr_;
-    I2CHandle* i2c_handle_;
-    I2CHandle  internal_i2c_handle_;
+    static const uint8_t BANK_UNKNOWN = 0xFF;
+
+    // Select bank (skipped when it is already selected) and send or read,
+    // retrying and recovering the bus as configured.
+    bool transmit(uint8_t bank, const uint8_t* data, uint16_t size);
+    bool receive(uint8_t bank, uint8_t reg, uint8_t* data, uint16_t size);
+    bool sendBankSelect(uint8_t bank);
+    bool attemptFailed(uint8_t attempt);
+    void recoverBus();
+    void countTransaction(uint16_t bytes);
+    void recordBlocking(uint32_t start);
+    void recordWake(uint32_t start);
+
+    // Shadow registers of a frame bank or the function bank, with the
+    // index of their dirty bits; nullptr for any other bank.
+    uint8_t*    shadowRegs(uint8_t bank, uint8_t& index, uint8_t& size);
+    static bool writable(uint8_t bank, uint8_t reg);
+    void        storeShadow(uint8_t bank, uint8_t reg, const uint8_t* values, uint16_t count, bool dirty);
+    void        setDirty(uint8_t index, uint8_t reg, bool dirty);
+    bool        isDirty(uint8_t index, uint8_t reg) const
+    {
+        return (dirty_[index][reg >> 3] >> (reg & 7)) & 1;
+    }
+    bool syncBank(uint8_t bank);
+    void traceTransfer(uint8_t        bank,
+                       uint8_t        reg,
+                       const uint8_t* payload,
+                       uint16_t       length,
+                       uint8_t        flags);
+
+    uint8_t                width_;
+    uint8_t                height_;
+    uint8_t                i2c_addr_;
+    I2CHandle*             i2c_handle_;
+    I2CHandle              internal_i2c_handle_;
+    uint8_t                bank_; // last bank selected, BANK_UNKNOWN after errors
+    uint8_t                shadow_[8][ISSI_FRAME_REGS];
+    uint8_t                function_shadow_[ISSI_FUNCTION_REGS];
+    uint8_t                dirty_[9][(ISSI_FRAME_REGS + 7) / 8]; // [8] is the function bank
+    TransferConfig         transfer_;
+    BusStats               bus_stats_;
+    IS31FL3731_DriverStats stats_;
+    IS31FL3731_Trace*      trace_;
 };
 
 class IS31FL3731_Wing : public IS31FL3731
@@ -0,0 +1,49 @@
+#include "is31fl3731_stats.h"
+
+#ifndef IS31FL3731_NO_STATS
+
+#if defined(__arm__)
+#include "stm32h7xx.h"
+
+void IS31FL3731_Timer::start()
+{
+    if(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)
+    {
+        return;
+    }
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->LAR = 0xC5ACCE55; // the M7 keeps the DWT write-locked
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t IS31FL3731_Timer::now()
+{
+    return DWT->CYCCNT;
+}
+
+uint32_t IS31FL3731_Timer::toMicros(uint32_t ticks)
+{
+    return ticks / (SystemCoreClock / 1000000);
+}
+
+#else
+#include <chrono>
+
+void IS31FL3731_Timer::start() {}
+
+uint32_t IS31FL3731_Timer::now()
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+uint32_t IS31FL3731_Timer::toMicros(uint32_t ticks)
+{
+    return ticks / 1000;
+}
+
+#endif
+
+#endif
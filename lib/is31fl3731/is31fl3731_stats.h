@@ -0,0 +1,73 @@
+#ifndef IS31FL3731_STATS_H
+#define IS31FL3731_STATS_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Instrumentation for the driver and the graphics layer. Define
+// IS31FL3731_NO_STATS to compile it out: the stats structs stay so code
+// reading them still builds, but nothing is counted or timed.
+
+// Log2 latency bins: bin 0 counts everything under 2 us, bin i counts
+// [2^i, 2^(i+1)) us and the last bin everything above.
+#ifndef IS31FL3731_STATS_HISTOGRAM_BINS
+#define IS31FL3731_STATS_HISTOGRAM_BINS 16
+#endif
+
+// Free-running tick counter: the DWT cycle counter on target and
+// std::chrono::steady_clock on a host. Ticks wrap, so only differences
+// between two now() readings shortly apart are meaningful.
+struct IS31FL3731_Timer
+{
+#ifdef IS31FL3731_NO_STATS
+    static void     start() {}
+    static uint32_t now() { return 0; }
+    static uint32_t toMicros(uint32_t) { return 0; }
+#else
+    static void     start();
+    static uint32_t now();
+    static uint32_t toMicros(uint32_t ticks);
+#endif
+};
+
+struct IS31FL3731_Histogram
+{
+    uint32_t bins[IS31FL3731_STATS_HISTOGRAM_BINS];
+
+    void add(uint32_t us)
+    {
+        uint8_t bin = 0;
+        while(us > 1 && bin < IS31FL3731_STATS_HISTOGRAM_BINS - 1)
+        {
+            us >>= 1;
+            bin++;
+        }
+        bins[bin]++;
+    }
+};
+
+struct IS31FL3731_DriverStats
+{
+    uint32_t transactions;    // I2C HAL calls, failed ones included
+    uint32_t bytes;           // payload bytes handed to the HAL, reads included
+    uint32_t bank_switches;   // command register writes
+    uint32_t busy_us;         // total time spent blocking on the bus
+    uint32_t max_blocking_us; // longest single transfer, retries included
+    uint32_t wake_us;         // last wake() or restore(), until the chip was lit
+    uint32_t max_wake_us;
+
+    void reset() { memset(this, 0, sizeof(*this)); }
+};
+
+struct IS31FL3731_GraphicsStats
+{
+    uint32_t             updates;
+    uint32_t             flushes;        // updates that sent anything
+    uint32_t             frames_dropped; // frame queue frames never shown
+    uint32_t             max_flush_us;
+    IS31FL3731_Histogram flush_us;       // flush latency, per flush that sent anything
+
+    void reset() { memset(this, 0, sizeof(*this)); }
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include "is31fl3731_trace.h"
+#include <string.h>
+
+static uint8_t* putLE(uint8_t* p, uint32_t value, uint8_t bytes)
+{
+    for(uint8_t i = 0; i < bytes; i++)
+    {
+        *p++ = (uint8_t)(value >> (8 * i));
+    }
+    return p;
+}
+
+IS31FL3731_Trace::IS31FL3731_Trace()
+: recorded_(0), data_head_(0), enabled_(false)
+{
+    config_.Defaults();
+}
+
+bool IS31FL3731_Trace::Init(const Config& config)
+{
+    if(config.entries == nullptr || config.entry_count == 0
+       || (config.data == nullptr && config.data_size > 0))
+    {
+        return false;
+    }
+
+    config_ = config;
+    clear();
+    enabled_ = true;
+    return true;
+}
+
+void IS31FL3731_Trace::clear()
+{
+    recorded_  = 0;
+    data_head_ = 0;
+}
+
+void IS31FL3731_Trace::record(uint32_t       time_us,
+                              uint8_t        addr,
+                              uint8_t        bank,
+                              uint8_t        reg,
+                              const uint8_t* payload,
+                              uint16_t       length,
+                              uint8_t        flags)
+{
+    if(!enabled_ || config_.entries == nullptr)
+    {
+        return;
+    }
+
+    Entry& e   = config_.entries[recorded_ % config_.entry_count];
+    e.time_us  = time_us;
+    e.data_pos = data_head_;
+    e.length   = length;
+    e.checksum = checksum(payload, length);
+    e.addr     = addr;
+    e.bank     = bank;
+    e.reg      = reg;
+    e.flags    = flags;
+    recorded_++;
+
+    // A payload longer than the whole ring is only checksummed.
+    if(length == 0 || length > config_.data_size)
+    {
+        return;
+    }
+    uint32_t start = data_head_ % config_.data_size;
+    uint32_t first = config_.data_size - start;
+    if(first > length)
+    {
+        first = length;
+    }
+    memcpy(&config_.data[start], payload, first);
+    memcpy(config_.data, payload + first, length - first);
+    data_head_ += length;
+}
+
+uint16_t IS31FL3731_Trace::size() const
+{
+    return recorded_ < config_.entry_count ? recorded_ : config_.entry_count;
+}
+
+const IS31FL3731_Trace::Entry& IS31FL3731_Trace::entry(uint16_t i) const
+{
+    uint32_t first = recorded_ - size();
+    return config_.entries[(first + i) % config_.entry_count];
+}
+
+uint16_t IS31FL3731_Trace::storedLength(const Entry& e) const
+{
+    if(e.length > config_.data_size || data_head_ - e.data_pos > config_.data_size)
+    {
+        return 0;
+    }
+    return e.length;
+}
+
+uint32_t IS31FL3731_Trace::serializedSize() const
+{
+    uint32_t total = IS31FL3731_TRACE_HEADER_SIZE;
+    for(uint16_t i = 0; i < size(); i++)
+    {
+        total += IS31FL3731_TRACE_ENTRY_HEADER_SIZE + storedLength(entry(i));
+    }
+    return total;
+}
+
+uint32_t IS31FL3731_Trace::serialize(uint8_t* out, uint32_t size) const
+{
+    uint32_t total = serializedSize();
+    if(size < total)
+    {
+        return 0;
+    }
+
+    uint8_t* p = out;
+    *p++       = 'I';
+    *p++       = 'S';
+    *p++       = 'T';
+    *p++       = IS31FL3731_TRACE_VERSION;
+    p          = putLE(p, this->size(), 4);
+    p          = putLE(p, recorded_ - this->size(), 4);
+
+    for(uint16_t i = 0; i < this->size(); i++)
+    {
+        const Entry& e      = entry(i);
+        uint16_t     stored = storedLength(e);
+
+        p    = putLE(p, e.time_us, 4);
+        *p++ = e.addr;
+        *p++ = e.bank;
+        *p++ = e.reg;
+        *p++ = e.flags;
+        p    = putLE(p, e.length, 2);
+        p    = putLE(p, e.checksum, 2);
+        p    = putLE(p, stored, 2);
+        for(uint16_t j = 0; j < stored; j++)
+        {
+            *p++ = config_.data[(e.data_pos + j) % config_.data_size];
+        }
+    }
+    return total;
+}
+
+uint16_t IS31FL3731_Trace::checksum(const uint8_t* data, uint16_t length)
+{
+    uint16_t a = 0;
+    uint16_t b = 0;
+    for(uint16_t i = 0; i < length; i++)
+    {
+        a = (a + data[i]) % 255;
+        b = (b + a) % 255;
+    }
+    return (b << 8) | a;
+}
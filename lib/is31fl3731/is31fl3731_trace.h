@@ -0,0 +1,116 @@
+#ifndef IS31FL3731_TRACE_H
+#define IS31FL3731_TRACE_H
+
+#include <stdint.h>
+
+// Serialized trace, little-endian, oldest entry first:
+//
+//   header  "IST" version(1) entry_count(4) overwritten(4)
+//   entry   time_us(4) addr(1) bank(1) reg(1) flags(1)
+//           length(2) checksum(2) stored(2) payload[stored]
+//
+// reg is the register the transaction starts at (0xFD for a bank select)
+// and the payload is what followed it on the wire, or what came back for
+// a read. stored is less than length when the payload was overwritten
+// before the trace was serialized; the checksum is always there.
+// tools/trace_replay.cpp replays a trace into a chip model.
+#define IS31FL3731_TRACE_VERSION 1
+#define IS31FL3731_TRACE_HEADER_SIZE 12
+#define IS31FL3731_TRACE_ENTRY_HEADER_SIZE 14
+
+#define IS31FL3731_TRACE_READ 0x01
+#define IS31FL3731_TRACE_FAILED 0x02
+
+// Records every I2C transaction of a driver into two rings: fixed-size
+// entries, and the payload bytes they point into. Attach it with
+// IS31FL3731::attachTrace(). Recording costs a copy and a checksum of the
+// payload per transaction.
+class IS31FL3731_Trace
+{
+  public:
+    struct Entry
+    {
+        uint32_t time_us;
+        uint32_t data_pos; // start of the payload in the data ring, unwrapped
+        uint16_t length;
+        uint16_t checksum;
+        uint8_t  addr;
+        uint8_t  bank;
+        uint8_t  reg;
+        uint8_t  flags;
+    };
+
+    struct Config
+    {
+        Entry*   entries;
+        uint16_t entry_count;
+        uint8_t* data; // payload ring; 0 records checksums only
+        uint32_t data_size;
+
+        void Defaults()
+        {
+            entries     = nullptr;
+            entry_count = 0;
+            data        = nullptr;
+            data_size   = 0;
+        }
+    };
+
+    IS31FL3731_Trace();
+
+    bool Init(const Config& config);
+    void clear();
+
+    // Stop recording to keep what led up to a fault.
+    void setEnabled(bool enabled) { enabled_ = enabled; }
+    bool enabled() const { return enabled_; }
+
+    void record(uint32_t       time_us,
+                uint8_t        addr,
+                uint8_t        bank,
+                uint8_t        reg,
+                const uint8_t* payload,
+                uint16_t       length,
+                uint8_t        flags);
+
+    uint32_t recorded() const { return recorded_; }
+    uint16_t size() const;
+    // The i-th oldest entry still held.
+    const Entry& entry(uint16_t i) const;
+    // Number of payload bytes of e still in the data ring: length or 0.
+    uint16_t storedLength(const Entry& e) const;
+
+    uint32_t serializedSize() const;
+    // Returns the number of bytes written, or 0 if out is too small.
+    uint32_t serialize(uint8_t* out, uint32_t size) const;
+
+    // Fletcher-16.
+    static uint16_t checksum(const uint8_t* data, uint16_t length);
+
+  private:
+    Config   config_;
+    uint32_t recorded_;  // entries since clear()
+    uint32_t data_head_; // payload bytes since clear()
+    bool     enabled_;
+};
+
+template <uint16_t ENTRIES, uint32_t DATA_SIZE>
+class IS31FL3731_StaticTrace : public IS31FL3731_Trace
+{
+  public:
+    IS31FL3731_StaticTrace()
+    {
+        Config cfg;
+        cfg.entries     = entries_;
+        cfg.entry_count = ENTRIES;
+        cfg.data        = data_;
+        cfg.data_size   = DATA_SIZE;
+        Init(cfg);
+    }
+
+  private:
+    Entry   entries_[ENTRIES];
+    uint8_t data_[DATA_SIZE];
+};
+
+#endif
@@ -0,0 +1,82 @@
+#include "IS31FL3731_AnimationStore.h"
+
+IS31FL3731_AnimationStore::IS31FL3731_AnimationStore()
+: base_(nullptr), frame_count_(0), width_(0), height_(0)
+{
+}
+
+bool IS31FL3731_AnimationStore::Init(const uint8_t* base, uint32_t size)
+{
+    base_        = nullptr;
+    frame_count_ = 0;
+
+    if(base == nullptr || size < IS31FL3731_STORE_HEADER_SIZE)
+    {
+        return false;
+    }
+
+    if(base[0] != 'I' || base[1] != 'S' || base[2] != 'A'
+       || base[3] != IS31FL3731_STORE_VERSION
+       || (base[6] | (base[7] << 8)) != IS31FL3731_STORE_RECORD_SIZE)
+    {
+        return false;
+    }
+
+    uint16_t count = base[4] | (base[5] << 8);
+    if(count == 0 || size < imageSize(count))
+    {
+        return false;
+    }
+
+    // A bad prefix would send a frame to the wrong registers, and erased
+    // flash reads back as 0xFF, so refuse anything half written.
+    base_ = base;
+    for(uint16_t i = 0; i < count; i++)
+    {
+        if(burst(i)[0] != 0x24)
+        {
+            base_ = nullptr;
+            return false;
+        }
+    }
+
+    frame_count_ = count;
+    width_       = base[8];
+    height_      = base[9];
+    return true;
+}
+
+void IS31FL3731_AnimationStore::formatHeader(uint8_t* header,
+                                             uint16_t frame_count,
+                                             uint8_t  width,
+                                             uint8_t  height)
+{
+    memset(header, 0, IS31FL3731_STORE_HEADER_SIZE);
+    header[0] = 'I';
+    header[1] = 'S';
+    header[2] = 'A';
+    header[3] = IS31FL3731_STORE_VERSION;
+    header[4] = frame_count & 0xFF;
+    header[5] = frame_count >> 8;
+    header[6] = IS31FL3731_STORE_RECORD_SIZE & 0xFF;
+    header[7] = IS31FL3731_STORE_RECORD_SIZE >> 8;
+    header[8] = width;
+    header[9] = height;
+}
+
+void IS31FL3731_AnimationStore::formatRecord(uint8_t*       record,
+                                             const uint8_t* pixels,
+                                             uint16_t       count,
+                                             uint16_t       duration_ms)
+{
+    if(count > IS31FL3731_STORE_FRAME_PIXELS)
+    {
+        count = IS31FL3731_STORE_FRAME_PIXELS;
+    }
+
+    memset(record, 0, IS31FL3731_STORE_RECORD_SIZE);
+    record[0]                             = duration_ms & 0xFF;
+    record[1]                             = duration_ms >> 8;
+    record[IS31FL3731_STORE_BURST_OFFSET] = 0x24;
+    memcpy(&record[IS31FL3731_STORE_BURST_OFFSET + 1], pixels, count);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#ifndef IS31FL3731_ANIMATIONSTORE_H
+#define IS31FL3731_ANIMATIONSTORE_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Uncompressed animation image laid out for memory-mapped flash (Daisy
+// QSPI at 0x90000000), little-endian:
+//
+//   header  "ISA" version(1) frame_count(2) record_size(2) width(1)
+//           height(1) reserved(6)
+//   record  duration_ms(2) reserved(1) 0x24 pwm[144]
+//
+// The 0x24 in front of each frame is the first PWM register, so
+// burst(i) is exactly what goes on the bus and playback hands a flash
+// pointer to the I2C driver without copying. Records are 148 bytes and
+// start 4-byte aligned.
+#define IS31FL3731_STORE_VERSION 1
+#define IS31FL3731_STORE_HEADER_SIZE 16
+#define IS31FL3731_STORE_FRAME_PIXELS 144
+#define IS31FL3731_STORE_RECORD_SIZE 148
+#define IS31FL3731_STORE_BURST_OFFSET 3
+
+class IS31FL3731_AnimationStore
+{
+  public:
+    IS31FL3731_AnimationStore();
+
+    // Checks the header and every record's register prefix.
+    bool Init(const uint8_t* base, uint32_t size);
+
+    uint16_t frameCount() const { return frame_count_; }
+    uint8_t  width() const { return width_; }
+    uint8_t  height() const { return height_; }
+
+    // 0x24 followed by the frame's 144 PWM values.
+    const uint8_t* burst(uint16_t frame) const
+    {
+        return record(frame) + IS31FL3731_STORE_BURST_OFFSET;
+    }
+    const uint8_t* pixels(uint16_t frame) const { return burst(frame) + 1; }
+    uint16_t       duration(uint16_t frame) const
+    {
+        const uint8_t* r = record(frame);
+        return r[0] | (r[1] << 8);
+    }
+
+    // Image building, for a RAM buffer that is then written to flash or a
+    // host tool writing a file.
+    static uint32_t imageSize(uint16_t frame_count)
+    {
+        return IS31FL3731_STORE_HEADER_SIZE
+               + (uint32_t)frame_count * IS31FL3731_STORE_RECORD_SIZE;
+    }
+    static void formatHeader(uint8_t* header,
+                             uint16_t frame_count,
+                             uint8_t  width,
+                             uint8_t  height);
+    // Frames smaller than 144 pixels are padded with zeros.
+    static void formatRecord(uint8_t*       record,
+                             const uint8_t* pixels,
+                             uint16_t       count,
+                             uint16_t       duration_ms);
+
+  private:
+    const uint8_t* record(uint16_t frame) const
+    {
+        return base_ + IS31FL3731_STORE_HEADER_SIZE
+               + (uint32_t)frame * IS31FL3731_STORE_RECORD_SIZE;
+    }
+
+    const uint8_t* base_;
+    uint16_t       frame_count_;
+    uint8_t        width_;
+    uint8_t        height_;
+};
+
+#endif
@@ -0,0 +1,300 @@
+#include "IS31FL3731_BankScroller.h"
+#include <string.h>
+
+IS31FL3731_BankScroller::IS31FL3731_BankScroller()
+: content_width_(0),
+  position_(0),
+  last_step_ms_(0),
+  started_(false),
+  displayed_slot_(0)
+{
+    config_.Defaults();
+    for(uint8_t i = 0; i < IS31FL3731_BANKSCROLLER_MAX_BANKS; i++)
+    {
+        slot_position_[i] = NO_POSITION;
+    }
+}
+
+bool IS31FL3731_BankScroller::Init(const Config& config)
+{
+    if(config.driver == nullptr || config.strip == nullptr
+       || config.strip->format() != IS31FL3731_Canvas::Format::GRAY8)
+    {
+        return false;
+    }
+    if(config.bank_count < 2 || config.first_bank + config.bank_count > 8)
+    {
+        return false;
+    }
+    if(config.driver->getWidth() * config.driver->getHeight() > 144)
+    {
+        return false;
+    }
+
+    config_ = config;
+    if(config_.step_ms == 0)
+    {
+        config_.step_ms = 1;
+    }
+    if(config_.uploads_per_service == 0)
+    {
+        config_.uploads_per_service = 1;
+    }
+
+    for(uint8_t i = 0; i < IS31FL3731_BANKSCROLLER_MAX_BANKS; i++)
+    {
+        slot_position_[i] = NO_POSITION;
+    }
+
+    setContentWidth(config_.content_width);
+    return true;
+}
+
+void IS31FL3731_BankScroller::setContentWidth(int16_t width)
+{
+    if(width <= 0 || width > config_.strip->width())
+    {
+        width = config_.strip->width();
+    }
+    content_width_ = width;
+
+    for(uint8_t i = 0; i < config_.bank_count; i++)
+    {
+        slot_position_[i] = NO_POSITION;
+    }
+    reset();
+}
+
+void IS31FL3731_BankScroller::reset()
+{
+    position_ = -config_.driver->getWidth();
+    started_  = false;
+}
+
+int16_t IS31FL3731_BankScroller::advance(int16_t position, int16_t steps) const
+{
+    int16_t width = config_.driver->getWidth();
+    int32_t next  = (int32_t)position + steps;
+
+    if(!config_.loop)
+    {
+        return next > content_width_ ? content_width_ : next;
+    }
+
+    int32_t period = content_width_ + width;
+    return (int16_t)((next + width) % period - width);
+}
+
+int8_t IS31FL3731_BankScroller::findSlot(int16_t position) const
+{
+    for(uint8_t i = 0; i < config_.bank_count; i++)
+    {
+        if(slot_position_[i] == position)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool IS31FL3731_BankScroller::isUpcoming(int16_t position) const
+{
+    for(uint8_t k = 0; k < config_.bank_count; k++)
+    {
+        if(advance(position_, k) == position)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int8_t IS31FL3731_BankScroller::findFreeSlot() const
+{
+    for(uint8_t i = 0; i < config_.bank_count; i++)
+    {
+        if(started_ && i == displayed_slot_)
+        {
+            continue;
+        }
+        if(slot_position_[i] == NO_POSITION || !isUpcoming(slot_position_[i]))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void IS31FL3731_BankScroller::invalidateStrip()
+{
+    IS31FL3731_Canvas* strip = config_.strip;
+    if(!strip->isDirty())
+    {
+        return;
+    }
+
+    // A bank at position p shows strip columns [p, p + width).
+    const IS31FL3731_Rect& dirty = strip->dirty();
+    int16_t                width = config_.driver->getWidth();
+    for(uint8_t i = 0; i < config_.bank_count; i++)
+    {
+        int16_t p = slot_position_[i];
+        if(p != NO_POSITION && p < dirty.x1 && p + width > dirty.x0)
+        {
+            slot_position_[i] = NO_POSITION;
+        }
+    }
+
+    strip->clearDirty();
+}
+
+void IS31FL3731_BankScroller::render(int16_t position)
+{
+    IS31FL3731_Canvas* strip  = config_.strip;
+    int16_t            width  = config_.driver->getWidth();
+    int16_t            height = config_.driver->getHeight();
+
+    memset(frame_, 0, width * height);
+
+    int16_t x0 = position < 0 ? -position : 0;
+    int16_t x1 = content_width_ - position;
+    if(x1 > width)
+        x1 = width;
+
+    for(int16_t row = 0; row < strip->height(); row++)
+    {
+        int16_t y = config_.y + row;
+        if(y < 0 || y >= height || x1 <= x0)
+            continue;
+
+        memcpy(&frame_[x0 + y * width],
+               &strip->pixels()[position + x0 + row * strip->width()],
+               x1 - x0);
+    }
+}
+
+// The driver's shadow holds what each bank should show, so only the bytes
+// that differ from it are sent. A failed burst leaves its registers dirty
+// in the driver and the slot forgotten here; the next upload of the slot
+// syncs them before it can be shown.
+bool IS31FL3731_BankScroller::upload(uint8_t slot, int16_t position)
+{
+    IS31FL3731* driver = config_.driver;
+    int16_t     width  = driver->getWidth();
+    int16_t     height = driver->getHeight();
+    uint8_t     bank   = config_.first_bank + slot;
+
+    render(position);
+
+    // Neighbouring scroll positions share most of their pixels, so only
+    // the changed span of each row is sent.
+    const uint8_t* shadow = driver->shadowPWM(bank);
+    bool           ok     = true;
+    for(int16_t y = 0; y < height && ok; y++)
+    {
+        const uint8_t* next = &frame_[y * width];
+        const uint8_t* prev = &shadow[y * width];
+        int16_t        x0   = 0;
+        int16_t        x1   = width;
+
+        while(x0 < x1 && next[x0] == prev[x0])
+            x0++;
+        while(x1 > x0 && next[x1 - 1] == prev[x1 - 1])
+            x1--;
+        if(x0 == x1)
+            continue;
+
+        ok = driver->setLEDPWMBurst(x0 + y * width, &next[x0], x1 - x0, bank);
+    }
+    if(ok && driver->shadowDirty())
+    {
+        ok = driver->sync();
+    }
+
+    slot_position_[slot] = ok ? position : NO_POSITION;
+    return ok;
+}
+
+bool IS31FL3731_BankScroller::tick(uint32_t now_ms)
+{
+    invalidateStrip();
+
+    if(!started_)
+    {
+        last_step_ms_ = now_ms;
+    }
+    else if(!done() && now_ms - last_step_ms_ >= config_.step_ms)
+    {
+        uint32_t steps = (now_ms - last_step_ms_) / config_.step_ms;
+        last_step_ms_ += steps * config_.step_ms;
+        position_ = advance(position_, steps);
+    }
+
+    int8_t slot = findSlot(position_);
+    if(slot < 0)
+    {
+        slot = findFreeSlot();
+        if(slot < 0)
+        {
+            slot = (displayed_slot_ + 1) % config_.bank_count;
+        }
+        if(!upload(slot, position_))
+        {
+            return false;
+        }
+    }
+
+    // A failed switch is retried on the next tick.
+    if(!started_ || slot != displayed_slot_)
+    {
+        if(!config_.driver->displayFrame(config_.first_bank + slot))
+        {
+            return false;
+        }
+        displayed_slot_ = slot;
+        started_        = true;
+        return true;
+    }
+
+    return false;
+}
+
+void IS31FL3731_BankScroller::service()
+{
+    invalidateStrip();
+
+    uint8_t uploads = 0;
+    for(uint8_t k = 0; k < config_.bank_count && uploads < config_.uploads_per_service; k++)
+    {
+        int16_t p = advance(position_, k);
+        if(findSlot(p) >= 0)
+        {
+            continue;
+        }
+
+        int8_t slot = findFreeSlot();
+        if(slot < 0)
+        {
+            return;
+        }
+        if(!upload(slot, p))
+        {
+            return;
+        }
+        uploads++;
+    }
+}
+
+uint8_t IS31FL3731_BankScroller::readyCount() const
+{
+    uint8_t ready = 0;
+    for(uint8_t k = 0; k < config_.bank_count; k++)
+    {
+        if(findSlot(advance(position_, k)) < 0)
+        {
+            break;
+        }
+        ready++;
+    }
+    return ready;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#ifndef IS31FL3731_BANKSCROLLER_H
+#define IS31FL3731_BANKSCROLLER_H
+
+#include "../is31fl3731/is31fl3731.h"
+#include "IS31FL3731_Canvas.h"
+#include <stdint.h>
+
+#define IS31FL3731_BANKSCROLLER_MAX_BANKS 8
+
+// Scrolls a wide canvas across the display using the chip's frame banks.
+// Upcoming scroll positions are uploaded into spare banks from service(),
+// so each step on tick() is normally only a picture-frame register write.
+// When the strip is drawn into, only banks whose window overlaps the dirty
+// columns are refreshed, and only the bytes that changed are sent.
+class IS31FL3731_BankScroller
+{
+  public:
+    struct Config
+    {
+        IS31FL3731*        driver;
+        IS31FL3731_Canvas* strip; // 8-bit
+        uint8_t            first_bank;
+        uint8_t            bank_count;
+        int16_t            y;             // display row of the strip's top
+        int16_t            content_width; // 0 for the strip width
+        uint16_t           step_ms;
+        bool               loop;
+        uint8_t            uploads_per_service;
+
+        void Defaults()
+        {
+            driver              = nullptr;
+            strip               = nullptr;
+            first_bank          = 1;
+            bank_count          = 7;
+            y                   = 0;
+            content_width       = 0;
+            step_ms             = 60;
+            loop                = true;
+            uploads_per_service = 1;
+        }
+    };
+
+    IS31FL3731_BankScroller();
+
+    bool Init(const Config& config);
+    void reset();
+    void setContentWidth(int16_t width);
+
+    // Advances one column per step_ms and shows the matching bank,
+    // uploading it on the spot if service() has not got to it yet.
+    // Returns true if the display changed.
+    bool tick(uint32_t now_ms);
+
+    // Pre-renders upcoming positions into spare banks, at most
+    // uploads_per_service banks per call. Call when the bus is idle.
+    void service();
+
+    int16_t position() const { return position_; }
+    bool    done() const { return !config_.loop && position_ >= content_width_; }
+    uint8_t readyCount() const;
+
+  private:
+    static const int16_t NO_POSITION = -32768;
+
+    Config   config_;
+    int16_t  content_width_;
+    int16_t  position_;
+    uint32_t last_step_ms_;
+    bool     started_;
+    uint8_t  displayed_slot_;
+
+    int16_t slot_position_[IS31FL3731_BANKSCROLLER_MAX_BANKS];
+    uint8_t frame_[144];
+
+    int16_t advance(int16_t position, int16_t steps) const;
+    int8_t  findSlot(int16_t position) const;
+    int8_t  findFreeSlot() const;
+    bool    isUpcoming(int16_t position) const;
+    void    invalidateStrip();
+    void    render(int16_t position);
+    bool    upload(uint8_t slot, int16_t position);
+};
+
+#endif
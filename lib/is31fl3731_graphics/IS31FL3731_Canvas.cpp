@@ -0,0 +1,324 @@
+#include "IS31FL3731_Canvas.h"
+
+void IS31FL3731_Rect::include(int16_t ax0, int16_t ay0, int16_t ax1, int16_t ay1)
+{
+    if(ax1 <= ax0 || ay1 <= ay0)
+        return;
+
+    if(empty())
+    {
+        x0 = ax0;
+        y0 = ay0;
+        x1 = ax1;
+        y1 = ay1;
+        return;
+    }
+
+    if(ax0 < x0)
+        x0 = ax0;
+    if(ay0 < y0)
+        y0 = ay0;
+    if(ax1 > x1)
+        x1 = ax1;
+    if(ay1 > y1)
+        y1 = ay1;
+}
+
+void IS31FL3731_Rect::clip(int16_t w, int16_t h)
+{
+    if(x0 < 0)
+        x0 = 0;
+    if(y0 < 0)
+        y0 = 0;
+    if(x1 > w)
+        x1 = w;
+    if(y1 > h)
+        y1 = h;
+    if(empty())
+        clear();
+}
+
+namespace
+{
+const uint8_t GRAY4_PALETTE[16]
+    = {0, 17, 34, 51, 68, 85, 102, 119, 136, 153, 170, 187, 204, 221, 238, 255};
+const uint8_t MONO1_PALETTE[2] = {0, 255};
+
+typedef IS31FL3731_PixelOps<IS31FL3731_PixelFormat::GRAY8> Gray8Ops;
+typedef IS31FL3731_PixelOps<IS31FL3731_PixelFormat::GRAY4> Gray4Ops;
+typedef IS31FL3731_PixelOps<IS31FL3731_PixelFormat::MONO1> Mono1Ops;
+} // namespace
+
+IS31FL3731_Canvas::IS31FL3731_Canvas(uint8_t* pixels, uint16_t width, uint16_t height, Format format)
+: pixels_(pixels),
+  width_(width),
+  height_(height),
+  format_(format),
+  palette_(nullptr),
+  opacity_(255),
+  blend_(Blend::REPLACE),
+  offset_x_(0),
+  offset_y_(0),
+  visible_(true),
+  rows_(nullptr),
+  row_storage_(nullptr),
+  row_count_(0)
+{
+    if(format_ != Format::GRAY8 && width_ > IS31FL3731_CANVAS_MAX_ROW)
+    {
+        reject();
+    }
+    setPalette(nullptr);
+    dirty_.clear();
+    damage_.clear();
+}
+
+void IS31FL3731_Canvas::attach(uint8_t* pixels, uint16_t width, uint16_t height)
+{
+    pixels_ = pixels;
+    width_  = width;
+    height_ = height;
+    if(format_ != Format::GRAY8 && width_ > IS31FL3731_CANVAS_MAX_ROW)
+    {
+        reject();
+    }
+    updateRows();
+    clearDirty();
+    markAllDirty();
+}
+
+void IS31FL3731_Canvas::trackRows(IS31FL3731_Span* rows, uint16_t count)
+{
+    row_storage_ = rows;
+    row_count_   = count;
+    updateRows();
+    clearDirty();
+    markAllDirty();
+}
+
+// Rows are only used while the storage covers every row and a span fits
+// in a byte.
+void IS31FL3731_Canvas::updateRows()
+{
+    bool fits = row_storage_ != nullptr && height_ <= row_count_ && width_ <= 255;
+    rows_     = fits ? row_storage_ : nullptr;
+}
+
+// A packed row wider than the unpack buffer cannot be drawn. Rather than
+// clamp it to a canvas the caller did not ask for, leave an empty one that
+// valid() reports and addLayer() refuses.
+void IS31FL3731_Canvas::reject()
+{
+    pixels_ = nullptr;
+    width_  = 0;
+    height_ = 0;
+}
+
+uint32_t IS31FL3731_Canvas::bufferSize(uint16_t width, uint16_t height, Format format)
+{
+    switch(format)
+    {
+        case Format::GRAY4: return (uint32_t)Gray4Ops::stride(width) * height;
+        case Format::MONO1: return (uint32_t)Mono1Ops::stride(width) * height;
+        default: return (uint32_t)Gray8Ops::stride(width) * height;
+    }
+}
+
+uint16_t IS31FL3731_Canvas::stride() const
+{
+    switch(format_)
+    {
+        case Format::GRAY4: return Gray4Ops::stride(width_);
+        case Format::MONO1: return Mono1Ops::stride(width_);
+        default: return Gray8Ops::stride(width_);
+    }
+}
+
+void IS31FL3731_Canvas::setPalette(const uint8_t* palette)
+{
+    if(palette == nullptr)
+    {
+        palette = format_ == Format::MONO1 ? MONO1_PALETTE : GRAY4_PALETTE;
+    }
+    if(palette == palette_)
+        return;
+    palette_ = palette;
+    damage_.include(footprint());
+}
+
+uint8_t IS31FL3731_Canvas::getPacked(int16_t x, int16_t y) const
+{
+    const uint8_t* row = &pixels_[y * stride()];
+    return format_ == Format::GRAY4 ? Gray4Ops::get(row, x) : Mono1Ops::get(row, x);
+}
+
+void IS31FL3731_Canvas::setPacked(int16_t x, int16_t y, uint8_t v)
+{
+    uint8_t* row = &pixels_[y * stride()];
+    if(format_ == Format::GRAY4)
+        Gray4Ops::set(row, x, v);
+    else
+        Mono1Ops::set(row, x, v);
+}
+
+void IS31FL3731_Canvas::fillSpan(int16_t x0, int16_t x1, int16_t y, uint8_t v)
+{
+    uint8_t* row = &pixels_[y * stride()];
+    switch(format_)
+    {
+        case Format::GRAY4: Gray4Ops::fill(row, x0, x1, v); break;
+        case Format::MONO1: Mono1Ops::fill(row, x0, x1, v); break;
+        default: Gray8Ops::fill(row, x0, x1, v); break;
+    }
+}
+
+void IS31FL3731_Canvas::fill(uint8_t v)
+{
+    if(format_ == Format::GRAY8)
+    {
+        memset(pixels_, v, (uint32_t)width_ * height_);
+        return;
+    }
+    for(int16_t y = 0; y < height_; y++)
+    {
+        fillSpan(0, width_, y, v);
+    }
+}
+
+uint8_t* IS31FL3731_Canvas::loadRow(int16_t x0, int16_t y, int16_t n, uint8_t* scratch)
+{
+    if(format_ == Format::GRAY8)
+    {
+        return &pixels_[x0 + y * width_];
+    }
+
+    const uint8_t* row = &pixels_[y * stride()];
+    for(int16_t i = 0; i < n; i++)
+    {
+        scratch[i] = format_ == Format::GRAY4 ? Gray4Ops::get(row, x0 + i)
+                                              : Mono1Ops::get(row, x0 + i);
+    }
+    return scratch;
+}
+
+void IS31FL3731_Canvas::storeRow(int16_t x0, int16_t y, int16_t n, const uint8_t* src)
+{
+    if(format_ == Format::GRAY8)
+    {
+        // src may be another row of this canvas, overlapping dst.
+        uint8_t* dst = &pixels_[x0 + y * width_];
+        if(dst != src)
+            memmove(dst, src, n);
+        return;
+    }
+
+    uint8_t* row = &pixels_[y * stride()];
+    for(int16_t i = 0; i < n; i++)
+    {
+        if(format_ == Format::GRAY4)
+            Gray4Ops::set(row, x0 + i, src[i]);
+        else
+            Mono1Ops::set(row, x0 + i, src[i]);
+    }
+}
+
+const uint8_t* IS31FL3731_Canvas::expandRow(int16_t x0, int16_t y, int16_t n, uint8_t* scratch) const
+{
+    const uint8_t* row = &pixels_[y * stride()];
+    switch(format_)
+    {
+        case Format::GRAY4: Gray4Ops::expand(row, x0, n, palette_, scratch); return scratch;
+        case Format::MONO1: Mono1Ops::expand(row, x0, n, palette_, scratch); return scratch;
+        default: return &row[x0];
+    }
+}
+
+void IS31FL3731_Canvas::setOpacity(uint8_t opacity)
+{
+    if(opacity == opacity_)
+        return;
+    opacity_ = opacity;
+    damage_.include(footprint());
+}
+
+void IS31FL3731_Canvas::setBlend(Blend blend)
+{
+    if(blend == blend_)
+        return;
+    blend_ = blend;
+    damage_.include(footprint());
+}
+
+void IS31FL3731_Canvas::setOffset(int16_t x, int16_t y)
+{
+    if(x == offset_x_ && y == offset_y_)
+        return;
+    damage_.include(footprint());
+    offset_x_ = x;
+    offset_y_ = y;
+    damage_.include(footprint());
+}
+
+void IS31FL3731_Canvas::setVisible(bool visible)
+{
+    if(visible == visible_)
+        return;
+    visible_ = visible;
+    damage_.include(footprint());
+}
+
+void IS31FL3731_Canvas::markDirty(int16_t x0, int16_t y0, int16_t x1, int16_t y1)
+{
+    dirty_.include(x0, y0, x1, y1);
+    if(rows_ == nullptr)
+        return;
+
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 > (int16_t)width_ ? width_ : x1;
+    y1 = y1 > (int16_t)height_ ? height_ : y1;
+    if(x1 <= x0)
+        return;
+    for(int16_t y = y0; y < y1; y++)
+    {
+        IS31FL3731_Span& row = rows_[y];
+        if(row.x1 <= row.x0)
+        {
+            row.x0 = x0;
+            row.x1 = x1;
+            continue;
+        }
+        if(x0 < row.x0)
+            row.x0 = x0;
+        if(x1 > row.x1)
+            row.x1 = x1;
+    }
+}
+
+IS31FL3731_Rect IS31FL3731_Canvas::footprint() const
+{
+    IS31FL3731_Rect r;
+    r.x0 = offset_x_;
+    r.y0 = offset_y_;
+    r.x1 = offset_x_ + width_;
+    r.y1 = offset_y_ + height_;
+    return r;
+}
+
+IS31FL3731_Rect IS31FL3731_Canvas::screenDirty() const
+{
+    IS31FL3731_Rect r = damage_;
+    r.include(dirty_.x0 + offset_x_,
+              dirty_.y0 + offset_y_,
+              dirty_.x1 + offset_x_,
+              dirty_.y1 + offset_y_);
+    return r;
+}
+
+void IS31FL3731_Canvas::clearDirty()
+{
+    dirty_.clear();
+    damage_.clear();
+    if(rows_ != nullptr)
+        memset(rows_, 0, height_ * sizeof(IS31FL3731_Span));
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#ifndef IS31FL3731_CANVAS_H
+#define IS31FL3731_CANVAS_H
+
+#include "IS31FL3731_PixelFormat.h"
+#include <stdint.h>
+#include <string.h>
+
+// Widest row a packed canvas can have; rows are unpacked into a buffer of
+// this size on the stack while drawing.
+#ifndef IS31FL3731_CANVAS_MAX_ROW
+#define IS31FL3731_CANVAS_MAX_ROW 256
+#endif
+
+// Half-open rectangle [x0, x1) x [y0, y1) used for dirty tracking.
+struct IS31FL3731_Rect
+{
+    int16_t x0;
+    int16_t y0;
+    int16_t x1;
+    int16_t y1;
+
+    void clear()
+    {
+        x0 = 0;
+        y0 = 0;
+        x1 = 0;
+        y1 = 0;
+    }
+
+    bool empty() const { return x1 <= x0 || y1 <= y0; }
+
+    void include(int16_t ax0, int16_t ay0, int16_t ax1, int16_t ay1);
+    void include(const IS31FL3731_Rect& r) { include(r.x0, r.y0, r.x1, r.y1); }
+    void include(int16_t x, int16_t y) { include(x, y, x + 1, y + 1); }
+    void clip(int16_t w, int16_t h);
+};
+
+// Dirty columns [x0, x1) of one canvas row; empty when x1 <= x0.
+struct IS31FL3731_Span
+{
+    uint8_t x0;
+    uint8_t x1;
+};
+
+// Off-screen pixel buffer, 8-bit by default or packed to 4 or 1 bit per
+// pixel. The graphics layer can draw into a canvas with all of its
+// primitives and composite attached canvases as layers into the output
+// buffer on update().
+class IS31FL3731_Canvas
+{
+  public:
+    typedef IS31FL3731_PixelFormat Format;
+
+    enum class Blend
+    {
+        REPLACE,  // layer pixel replaces what is below
+        OVER,     // like REPLACE, but 0 is transparent
+        ADD,      // saturating add
+        MAX,      // lighten
+        MULTIPLY, // darken, 255 leaves the layer below unchanged
+    };
+
+    IS31FL3731_Canvas(uint8_t* pixels = nullptr,
+                      uint16_t width  = 0,
+                      uint16_t height = 0,
+                      Format   format = Format::GRAY8);
+
+    // Keeps the canvas format; pixels must hold bufferSize() bytes.
+    void attach(uint8_t* pixels, uint16_t width, uint16_t height);
+
+    // False without pixels, and for a packed canvas wider than
+    // IS31FL3731_CANVAS_MAX_ROW, which is left empty instead.
+    bool valid() const { return pixels_ != nullptr && width_ > 0 && height_ > 0; }
+
+    static uint32_t bufferSize(uint16_t width, uint16_t height, Format format);
+
+    uint8_t*       pixels() { return pixels_; }
+    const uint8_t* pixels() const { return pixels_; }
+    uint16_t       width() const { return width_; }
+    uint16_t       height() const { return height_; }
+    Format         format() const { return format_; }
+    uint16_t       stride() const; // bytes per row
+
+    // Level to PWM table for packed formats (16 entries for GRAY4, 2 for
+    // MONO1); nullptr restores the linear default. Ignored for GRAY8.
+    void           setPalette(const uint8_t* palette);
+    const uint8_t* palette() const { return palette_; }
+
+    // Unchecked pixel access in drawing values (see IS31FL3731_PixelOps).
+    uint8_t getPixel(int16_t x, int16_t y) const
+    {
+        return format_ == Format::GRAY8 ? pixels_[x + y * width_] : getPacked(x, y);
+    }
+    void setPixel(int16_t x, int16_t y, uint8_t v)
+    {
+        if(format_ == Format::GRAY8)
+            pixels_[x + y * width_] = v;
+        else
+            setPacked(x, y, v);
+    }
+    void fillSpan(int16_t x0, int16_t x1, int16_t y, uint8_t v);
+    void fill(uint8_t v);
+
+    // 8-bit view of n pixels of a row for code written against GRAY8 rows.
+    // For GRAY8 this is the canvas memory itself and storeRow() does
+    // nothing; packed rows are unpacked into scratch (at least n bytes)
+    // and written back by storeRow().
+    uint8_t* loadRow(int16_t x0, int16_t y, int16_t n, uint8_t* scratch);
+    void     storeRow(int16_t x0, int16_t y, int16_t n, const uint8_t* row);
+
+    // n PWM values of a row, through the palette for packed formats.
+    // Returns the canvas memory itself for GRAY8, otherwise scratch.
+    const uint8_t* expandRow(int16_t x0, int16_t y, int16_t n, uint8_t* scratch) const;
+
+    void    setOpacity(uint8_t opacity);
+    uint8_t opacity() const { return opacity_; }
+    void    setBlend(Blend blend);
+    Blend   blend() const { return blend_; }
+    void    setOffset(int16_t x, int16_t y);
+    int16_t offsetX() const { return offset_x_; }
+    int16_t offsetY() const { return offset_y_; }
+    void    setVisible(bool visible);
+    bool    visible() const { return visible_; }
+
+    void markDirty(int16_t x0, int16_t y0, int16_t x1, int16_t y1);
+    void markAllDirty() { markDirty(0, 0, width_, height_); }
+    bool isDirty() const { return !dirty_.empty() || !damage_.empty(); }
+    const IS31FL3731_Rect& dirty() const { return dirty_; }
+
+    // Also track the dirty span of each row in rows, which must hold one
+    // entry per row, alongside the bounding rectangle. Only for canvases
+    // up to 255 pixels wide; wider ones keep just the rectangle.
+    void                   trackRows(IS31FL3731_Span* rows, uint16_t count);
+    const IS31FL3731_Span* dirtyRows() const { return rows_; }
+
+    // Region that needs recompositing, in output (offset applied) space.
+    IS31FL3731_Rect screenDirty() const;
+    IS31FL3731_Rect footprint() const;
+    void            clearDirty();
+
+  private:
+    void    reject();
+    uint8_t getPacked(int16_t x, int16_t y) const;
+    void    setPacked(int16_t x, int16_t y, uint8_t v);
+
+    uint8_t*        pixels_;
+    uint16_t        width_;
+    uint16_t        height_;
+    Format          format_;
+    const uint8_t*  palette_;
+    uint8_t         opacity_;
+    Blend           blend_;
+    int16_t         offset_x_;
+    int16_t         offset_y_;
+    bool            visible_;
+    IS31FL3731_Rect  dirty_;
+    IS31FL3731_Rect  damage_;
+    IS31FL3731_Span* rows_;
+    IS31FL3731_Span* row_storage_;
+    uint16_t         row_count_;
+
+    void updateRows();
+};
+
+// Canvas with its storage as a member, sized at compile time.
+template <uint16_t W, uint16_t H>
+class IS31FL3731_StaticCanvas : public IS31FL3731_Canvas
+{
+  public:
+    IS31FL3731_StaticCanvas() : IS31FL3731_Canvas(storage_, W, H)
+    {
+        memset(storage_, 0, sizeof(storage_));
+    }
+
+  private:
+    uint8_t storage_[W * H];
+};
+
+// Packed canvas with its storage as a member: 16x9 costs 72 bytes at GRAY4
+// and 18 bytes at MONO1 instead of 144.
+template <uint16_t W, uint16_t H, IS31FL3731_PixelFormat F>
+class IS31FL3731_PackedCanvas : public IS31FL3731_Canvas
+{
+    static_assert(W <= IS31FL3731_CANVAS_MAX_ROW, "row wider than IS31FL3731_CANVAS_MAX_ROW");
+
+  public:
+    IS31FL3731_PackedCanvas() : IS31FL3731_Canvas(storage_, W, H, F)
+    {
+        memset(storage_, 0, sizeof(storage_));
+    }
+
+  private:
+    uint8_t storage_[IS31FL3731_PixelOps<F>::stride(W) * H];
+};
+
+#endif
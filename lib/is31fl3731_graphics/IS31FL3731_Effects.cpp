@@ -0,0 +1,253 @@
+#include "IS31FL3731_Effects.h"
+
+static uint32_t nextRandom(uint32_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static uint8_t scaleBrightness(uint8_t brightness, q15_t level)
+{
+    return (uint8_t)(((int32_t)brightness * level) >> 15);
+}
+
+void IS31FL3731_PlasmaEffect::render(IS31FL3731_Canvas* canvas, uint32_t now_ms)
+{
+    if(canvas->format() != IS31FL3731_Canvas::Format::GRAY8)
+        return;
+
+    uint8_t* pixels = canvas->pixels();
+    int16_t  w      = canvas->width();
+    int16_t  h      = canvas->height();
+    uint16_t t      = (uint16_t)(now_ms * speed_);
+    uint16_t step   = scale_ << 8;
+
+    for(int16_t y = 0; y < h; y++)
+    {
+        // The row term is shared by the whole row.
+        q15_t    row = sin16(y * step - t);
+        uint8_t* out = &pixels[y * w];
+
+        for(int16_t x = 0; x < w; x++)
+        {
+            int32_t sum = row;
+            sum += sin16(x * step + t);
+            sum += sin16((x + y) * (step >> 1) + (t >> 1));
+            sum += sin16(sqrtQ4(x * x + y * y) * (step >> 4) - t);
+            out[x] = q15ToBrightness((q15_t)(sum >> 2));
+        }
+    }
+
+    canvas->markAllDirty();
+}
+
+void IS31FL3731_WaveEffect::render(IS31FL3731_Canvas* canvas, uint32_t now_ms)
+{
+    if(canvas->format() != IS31FL3731_Canvas::Format::GRAY8)
+        return;
+
+    uint8_t* pixels = canvas->pixels();
+    int16_t  w      = canvas->width();
+    int16_t  h      = canvas->height();
+    uint16_t t      = (uint16_t)(now_ms * speed_);
+    uint32_t step   = 65536u / wavelength_; // a full turn at wavelength 1
+    int32_t  center = (int32_t)(h - 1) << 7;
+
+    for(int16_t x = 0; x < w; x++)
+    {
+        // Row of the crest in Q8, drawn anti-aliased across two rows.
+        int32_t crest = center + ((amplitude_ * (int32_t)sin16((uint16_t)(x * step + t))) >> 7);
+
+        for(int16_t y = 0; y < h; y++)
+        {
+            int32_t d = ((int32_t)y << 8) - crest;
+            if(d < 0)
+                d = -d;
+            pixels[x + y * w] = d < 256 ? (brightness_ * (256 - d)) >> 8 : 0;
+        }
+    }
+
+    canvas->markAllDirty();
+}
+
+void IS31FL3731_RippleEffect::render(IS31FL3731_Canvas* canvas, uint32_t now_ms)
+{
+    if(canvas->format() != IS31FL3731_Canvas::Format::GRAY8)
+        return;
+
+    uint8_t* pixels = canvas->pixels();
+    int16_t  w      = canvas->width();
+    int16_t  h      = canvas->height();
+    uint16_t t      = (uint16_t)(now_ms * speed_);
+    uint16_t step   = 65536 / (wavelength_ * 16);
+
+    // Center in half pixels so even-sized canvases ripple symmetrically.
+    int16_t cx2 = cx_ < 0 ? w - 1 : cx_ * 2;
+    int16_t cy2 = cy_ < 0 ? h - 1 : cy_ * 2;
+
+    for(int16_t y = 0; y < h; y++)
+    {
+        int32_t dy = y * 2 - cy2;
+        for(int16_t x = 0; x < w; x++)
+        {
+            int32_t  dx   = x * 2 - cx2;
+            uint16_t dist = sqrtQ4(dx * dx + dy * dy) >> 1;
+            q15_t    wave = (sin16(dist * step - t) >> 1) + 16384;
+            uint32_t fade = ((uint32_t)dist * decay_) >> 4;
+            pixels[x + y * w]
+                = scaleBrightness(255, q15Mul(wave, expDecay(fade > 0xFFFF ? 0xFFFF : fade)));
+        }
+    }
+
+    canvas->markAllDirty();
+}
+
+void IS31FL3731_FireEffect::render(IS31FL3731_Canvas* canvas, uint32_t now_ms)
+{
+    if(canvas->format() != IS31FL3731_Canvas::Format::GRAY8)
+        return;
+
+    uint8_t* heat = canvas->pixels();
+    int16_t  w    = canvas->width();
+    int16_t  h    = canvas->height();
+
+    if(!started_)
+    {
+        started_ = true;
+        last_ms_ = now_ms - step_ms_;
+    }
+
+    uint32_t steps = (now_ms - last_ms_) / step_ms_;
+    if(steps == 0)
+        return;
+    last_ms_ += steps * step_ms_;
+    if(steps > 4)
+        steps = 4;
+
+    while(steps-- > 0)
+    {
+        // Heat rises: each row averages the rows below it, then cools.
+        for(int16_t y = 0; y < h - 1; y++)
+        {
+            const uint8_t* below  = &heat[(y + 1) * w];
+            const uint8_t* below2 = &heat[(y + 2 < h ? y + 2 : y + 1) * w];
+            uint8_t*       row    = &heat[y * w];
+
+            for(int16_t x = 0; x < w; x++)
+            {
+                uint16_t sum = below[x] * 2 + below2[x];
+                sum += below[x > 0 ? x - 1 : x];
+                sum += below[x < w - 1 ? x + 1 : x];
+                uint16_t v    = sum / 5;
+                uint8_t  cool = nextRandom(seed_) % (cooling_ + 1);
+                row[x]        = v > cool ? v - cool : 0;
+            }
+        }
+
+        uint8_t* bottom = &heat[(h - 1) * w];
+        for(int16_t x = 0; x < w; x++)
+        {
+            uint32_t r = nextRandom(seed_);
+            if((r & 0xFF) < sparking_)
+                bottom[x] = 160 + ((r >> 8) % 96);
+            else
+                bottom[x] = bottom[x] > 40 ? bottom[x] - 40 : 0;
+        }
+    }
+
+    canvas->markAllDirty();
+}
+
+namespace
+{
+const uint16_t TWINKLE_STEP_MS = 20;
+} // namespace
+
+void IS31FL3731_TwinkleEffect::render(IS31FL3731_Canvas* canvas, uint32_t now_ms)
+{
+    if(canvas->format() != IS31FL3731_Canvas::Format::GRAY8)
+        return;
+
+    uint8_t* pixels = canvas->pixels();
+    uint16_t count  = canvas->width() * canvas->height();
+
+    if(!started_)
+    {
+        started_ = true;
+        last_ms_ = now_ms;
+    }
+
+    uint32_t elapsed = now_ms - last_ms_;
+    if(elapsed == 0 || count == 0)
+        return;
+    last_ms_ = now_ms;
+    // After a stall or a clock jump, catch up by at most a quarter second,
+    // like the fire's step cap, so the carry cannot overflow.
+    if(elapsed > 250)
+        elapsed = 250;
+
+    // Decay goes in fixed steps with the remainder of each carried to the
+    // next, so neither the rounding nor the truncation in scaleBrightness()
+    // depend on how often render() is called.
+    fade_ms_ += elapsed;
+    while(fade_ms_ >= TWINKLE_STEP_MS)
+    {
+        fade_ms_ -= TWINKLE_STEP_MS;
+        fade_carry_ += fade_ * TWINKLE_STEP_MS;
+        uint16_t fade = fade_carry_ / 100;
+        fade_carry_ %= 100;
+        if(fade == 0)
+            continue;
+        q15_t factor = expDecay(fade);
+        for(uint16_t i = 0; i < count; i++)
+        {
+            pixels[i] = scaleBrightness(pixels[i], factor);
+        }
+    }
+
+    // More sparkles than LEDs would only land on top of each other.
+    carry_ += rate_ * elapsed;
+    uint32_t sparkles = carry_ / 1000;
+    carry_ %= 1000;
+    if(sparkles > count)
+        sparkles = count;
+    while(sparkles-- > 0)
+    {
+        pixels[nextRandom(seed_) % count] = brightness_;
+    }
+
+    canvas->markAllDirty();
+}
+
+void IS31FL3731_CometEffect::render(IS31FL3731_Canvas* canvas, uint32_t now_ms)
+{
+    if(canvas->format() != IS31FL3731_Canvas::Format::GRAY8)
+        return;
+
+    uint8_t* pixels = canvas->pixels();
+    int16_t  w      = canvas->width();
+    int16_t  h      = canvas->height();
+    uint32_t length = (uint32_t)w * h;
+
+    if(length == 0)
+        return;
+
+    uint32_t head = ((uint64_t)now_ms * speed_ / 1000) % length;
+
+    // The path snakes back and forth so the head never jumps across a row.
+    for(int16_t y = 0; y < h; y++)
+    {
+        for(int16_t x = 0; x < w; x++)
+        {
+            uint32_t i      = y * w + ((y & 1) ? w - 1 - x : x);
+            uint32_t behind = (head + length - i) % length;
+            uint32_t fade   = behind * tail_;
+            pixels[x + y * w]
+                = scaleBrightness(brightness_, expDecay(fade > 0xFFFF ? 0xFFFF : fade));
+        }
+    }
+
+    canvas->markAllDirty();
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#ifndef IS31FL3731_EFFECTS_H
+#define IS31FL3731_EFFECTS_H
+
+#include "IS31FL3731_Canvas.h"
+#include "IS31FL3731_FixedMath.h"
+#include <stdint.h>
+
+// Procedural effects. Each call to render() draws one frame for the given
+// time into a canvas and returns immediately; nothing blocks or delays.
+// Render into display.target() or into a layer canvas; effects work on
+// 8-bit canvases and leave packed ones untouched.
+class IS31FL3731_Effect
+{
+  public:
+    virtual ~IS31FL3731_Effect() {}
+    virtual void render(IS31FL3731_Canvas* canvas, uint32_t now_ms) = 0;
+};
+
+class IS31FL3731_PlasmaEffect : public IS31FL3731_Effect
+{
+  public:
+    IS31FL3731_PlasmaEffect() : speed_(64), scale_(12) {}
+
+    void setSpeed(uint16_t speed) { speed_ = speed; }
+    void setScale(uint8_t scale) { scale_ = scale; }
+    void render(IS31FL3731_Canvas* canvas, uint32_t now_ms) override;
+
+  private:
+    uint16_t speed_; // phase steps per ms
+    uint8_t  scale_; // spatial frequency, phase steps per pixel / 256
+};
+
+class IS31FL3731_WaveEffect : public IS31FL3731_Effect
+{
+  public:
+    IS31FL3731_WaveEffect()
+    : speed_(20), wavelength_(16), amplitude_(3), brightness_(200)
+    {
+    }
+
+    void setSpeed(uint16_t speed) { speed_ = speed; }
+    void setWavelength(uint8_t pixels) { wavelength_ = pixels > 0 ? pixels : 1; }
+    void setAmplitude(uint8_t rows) { amplitude_ = rows; }
+    void setBrightness(uint8_t brightness) { brightness_ = brightness; }
+    void render(IS31FL3731_Canvas* canvas, uint32_t now_ms) override;
+
+  private:
+    uint16_t speed_;
+    uint8_t  wavelength_;
+    uint8_t  amplitude_;
+    uint8_t  brightness_;
+};
+
+class IS31FL3731_RippleEffect : public IS31FL3731_Effect
+{
+  public:
+    IS31FL3731_RippleEffect()
+    : cx_(-1), cy_(-1), speed_(40), wavelength_(4), decay_(6)
+    {
+    }
+
+    // A negative center uses the middle of the canvas.
+    void setCenter(int16_t x, int16_t y)
+    {
+        cx_ = x;
+        cy_ = y;
+    }
+    void setSpeed(uint16_t speed) { speed_ = speed; }
+    void setWavelength(uint8_t pixels) { wavelength_ = pixels > 0 ? pixels : 1; }
+    void setDecay(uint8_t decay) { decay_ = decay; }
+    void render(IS31FL3731_Canvas* canvas, uint32_t now_ms) override;
+
+  private:
+    int16_t  cx_;
+    int16_t  cy_;
+    uint16_t speed_;
+    uint8_t  wavelength_;
+    uint8_t  decay_; // fade per pixel of distance, in 1/32 steps of exp()
+};
+
+// Keeps its heat field in the canvas itself, so the canvas must not be
+// drawn over by anything else.
+class IS31FL3731_FireEffect : public IS31FL3731_Effect
+{
+  public:
+    IS31FL3731_FireEffect()
+    : cooling_(24), sparking_(160), step_ms_(30), last_ms_(0), started_(false), seed_(0x1234567)
+    {
+    }
+
+    void setCooling(uint8_t cooling) { cooling_ = cooling; }
+    void setSparking(uint8_t sparking) { sparking_ = sparking; }
+    void setStepMs(uint16_t step_ms) { step_ms_ = step_ms > 0 ? step_ms : 1; }
+    void render(IS31FL3731_Canvas* canvas, uint32_t now_ms) override;
+
+  private:
+    uint8_t  cooling_;
+    uint8_t  sparking_;
+    uint16_t step_ms_;
+    uint32_t last_ms_;
+    bool     started_;
+    uint32_t seed_;
+};
+
+// Also keeps its state in the canvas.
+class IS31FL3731_TwinkleEffect : public IS31FL3731_Effect
+{
+  public:
+    IS31FL3731_TwinkleEffect()
+    : rate_(20),
+      fade_(16),
+      brightness_(255),
+      last_ms_(0),
+      carry_(0),
+      fade_ms_(0),
+      fade_carry_(0),
+      started_(false),
+      seed_(0x2468ace)
+    {
+    }
+
+    void setRate(uint16_t per_second) { rate_ = per_second; }
+    void setFade(uint8_t fade) { fade_ = fade; }
+    void setBrightness(uint8_t brightness) { brightness_ = brightness; }
+    void render(IS31FL3731_Canvas* canvas, uint32_t now_ms) override;
+
+  private:
+    uint16_t rate_;
+    uint8_t  fade_; // decay per 100 ms, in 1/32 steps of exp()
+    uint8_t  brightness_;
+    uint32_t last_ms_;
+    uint32_t carry_;
+    uint16_t fade_ms_;    // time not yet faded, under one step
+    uint16_t fade_carry_; // fade owed, in 1/100 of a 1/32 step
+    bool     started_;
+    uint32_t seed_;
+};
+
+// A bright head running along each row in turn with an exponential tail.
+class IS31FL3731_CometEffect : public IS31FL3731_Effect
+{
+  public:
+    IS31FL3731_CometEffect() : speed_(20), tail_(10), brightness_(255) {}
+
+    void setSpeed(uint16_t pixels_per_second) { speed_ = pixels_per_second; }
+    void setTail(uint8_t tail) { tail_ = tail; }
+    void setBrightness(uint8_t brightness) { brightness_ = brightness; }
+    void render(IS31FL3731_Canvas* canvas, uint32_t now_ms) override;
+
+  private:
+    uint16_t speed_;
+    uint8_t  tail_; // decay per pixel behind the head, in 1/32 steps of exp()
+    uint8_t  brightness_;
+};
+
+#endif
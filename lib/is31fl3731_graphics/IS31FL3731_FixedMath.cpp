@@ -0,0 +1,5 @@
+#include "IS31FL3731_FixedMath.h"
+
+constexpr IS31FL3731_Table<256, q15_t> IS31FL3731_SINE_TABLE{IS31FL3731_SineGen()};
+constexpr IS31FL3731_Table<256, q15_t> IS31FL3731_EXP_TABLE{IS31FL3731_ExpGen()};
+constexpr IS31FL3731_Table<1024, uint16_t> IS31FL3731_SQRT_TABLE{IS31FL3731_SqrtGen()};
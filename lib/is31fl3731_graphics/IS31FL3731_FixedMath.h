@@ -0,0 +1,184 @@
+#pragma once
+
+#ifndef IS31FL3731_FIXEDMATH_H
+#define IS31FL3731_FIXEDMATH_H
+
+#include <stdint.h>
+
+// Q15 fixed point: 32767 is 1.0. Phases are 16-bit, 65536 is one turn.
+typedef int16_t q15_t;
+
+#define IS31FL3731_Q15_ONE 32767
+
+// Lookup tables built by the compiler, so they land in flash with no
+// start-up cost and no floating point at run time.
+template <uint16_t N, typename T>
+struct IS31FL3731_Table
+{
+    T v[N];
+
+    template <typename F>
+    constexpr IS31FL3731_Table(F f) : v{}
+    {
+        for(uint16_t i = 0; i < N; i++)
+        {
+            v[i] = f(i);
+        }
+    }
+
+    constexpr T operator[](uint16_t i) const { return v[i]; }
+};
+
+struct IS31FL3731_SineGen
+{
+    constexpr q15_t operator()(uint16_t i) const;
+};
+
+struct IS31FL3731_ExpGen
+{
+    constexpr q15_t operator()(uint16_t i) const;
+};
+
+struct IS31FL3731_SqrtGen
+{
+    constexpr uint16_t operator()(uint16_t i) const;
+};
+
+namespace is31fl3731_math
+{
+constexpr double PI = 3.14159265358979323846;
+
+// Taylor series, accurate to well under one Q15 step on [-pi, pi].
+constexpr double sin(double x)
+{
+    while(x > PI)
+        x -= 2 * PI;
+    while(x < -PI)
+        x += 2 * PI;
+
+    double term = x;
+    double sum  = x;
+    for(int n = 1; n < 12; n++)
+    {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double exp(double x)
+{
+    // exp(x) = exp(x / 16)^16 keeps the series short for large |x|.
+    double y    = x / 16;
+    double term = 1;
+    double sum  = 1;
+    for(int n = 1; n < 16; n++)
+    {
+        term *= y / n;
+        sum += term;
+    }
+    for(int i = 0; i < 4; i++)
+        sum *= sum;
+    return sum;
+}
+
+constexpr double sqrt(double x)
+{
+    if(x <= 0)
+        return 0;
+    double r = x > 1 ? x : 1;
+    for(int i = 0; i < 32; i++)
+        r = 0.5 * (r + x / r);
+    return r;
+}
+
+constexpr q15_t toQ15(double x)
+{
+    double scaled = x * IS31FL3731_Q15_ONE;
+    return (q15_t)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+}
+} // namespace is31fl3731_math
+
+// One full period in 256 steps.
+constexpr q15_t IS31FL3731_SineGen::operator()(uint16_t i) const
+{
+    return is31fl3731_math::toQ15(is31fl3731_math::sin(2 * is31fl3731_math::PI * i / 256));
+}
+
+// exp(-i / 32): 256 entries cover exp(0) down to exp(-8).
+constexpr q15_t IS31FL3731_ExpGen::operator()(uint16_t i) const
+{
+    return is31fl3731_math::toQ15(is31fl3731_math::exp(-(double)i / 32));
+}
+
+// sqrt(i) in Q4 for i < 1024, i.e. distances up to 32 pixels.
+constexpr uint16_t IS31FL3731_SqrtGen::operator()(uint16_t i) const
+{
+    return (uint16_t)(is31fl3731_math::sqrt((double)i) * 16 + 0.5);
+}
+
+extern const IS31FL3731_Table<256, q15_t>     IS31FL3731_SINE_TABLE;
+extern const IS31FL3731_Table<256, q15_t>     IS31FL3731_EXP_TABLE;
+extern const IS31FL3731_Table<1024, uint16_t> IS31FL3731_SQRT_TABLE;
+
+inline q15_t q15Mul(q15_t a, q15_t b)
+{
+    return (q15_t)(((int32_t)a * b) >> 15);
+}
+
+// Sine of a 16-bit phase, linearly interpolated between table entries.
+inline q15_t sin16(uint16_t phase)
+{
+    uint8_t index = phase >> 8;
+    int32_t a     = IS31FL3731_SINE_TABLE[index];
+    int32_t b     = IS31FL3731_SINE_TABLE[(uint8_t)(index + 1)];
+    return (q15_t)(a + (((b - a) * (phase & 0xFF)) >> 8));
+}
+
+inline q15_t cos16(uint16_t phase)
+{
+    return sin16(phase + 16384);
+}
+
+// exp(-x / 32) for x in Q0, saturating to 0 past the end of the table.
+inline q15_t expDecay(uint16_t x)
+{
+    return x < 256 ? IS31FL3731_EXP_TABLE[x] : 0;
+}
+
+// Integer square root in Q4.
+inline uint16_t sqrtQ4(uint32_t x)
+{
+    if(x < 1024)
+    {
+        return IS31FL3731_SQRT_TABLE[x];
+    }
+
+    uint32_t r   = 0;
+    uint32_t bit = 1UL << 30;
+    uint32_t n   = x << 8;
+    while(bit > n)
+        bit >>= 2;
+    while(bit != 0)
+    {
+        if(n >= r + bit)
+        {
+            n -= r + bit;
+            r = (r >> 1) + bit;
+        }
+        else
+        {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint16_t)r;
+}
+
+// Maps a Q15 value in [-1, 1] to a brightness in [0, 255].
+inline uint8_t q15ToBrightness(q15_t v)
+{
+    return (uint8_t)(((int32_t)v + 32768) >> 8);
+}
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#ifndef IS31FL3731_FONT_H
+#define IS31FL3731_FONT_H
+
+#include <stdint.h>
+
+// Fixed-width bitmap font. Glyphs are packed column-major: each glyph is
+// `width` bytes, one per column, with bit 0 as the top row.
+struct IS31FL3731_Font
+{
+    uint8_t        width;
+    uint8_t        height;  // at most 8
+    uint8_t        spacing; // blank columns after each glyph
+    char           first;
+    char           last;
+    const uint8_t* glyphs;
+};
+
+extern const IS31FL3731_Font IS31FL3731_FONT_3X5;
+extern const IS31FL3731_Font IS31FL3731_FONT_5X7;
+
+#endif
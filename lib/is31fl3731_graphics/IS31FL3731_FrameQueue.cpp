@@ -0,0 +1,55 @@
+#include "IS31FL3731_FrameQueue.h"
+#include <string.h>
+
+IS31FL3731_FrameQueue::IS31FL3731_FrameQueue()
+: width_(0), height_(0), back_(0), front_(1), middle_(2), published_(0), dropped_(0)
+{
+    memset(buffers_, 0, sizeof(buffers_));
+}
+
+bool IS31FL3731_FrameQueue::Init(uint16_t width, uint16_t height)
+{
+    if(width == 0 || height == 0 || width * height > IS31FL3731_FRAMEQUEUE_FRAME_SIZE)
+    {
+        return false;
+    }
+
+    width_  = width;
+    height_ = height;
+    back_   = 0;
+    front_  = 1;
+    middle_.store(2, std::memory_order_relaxed);
+    published_.store(0, std::memory_order_relaxed);
+    dropped_.store(0, std::memory_order_relaxed);
+    memset(buffers_, 0, sizeof(buffers_));
+
+    back_canvas_.attach(buffers_[back_], width_, height_);
+    return true;
+}
+
+void IS31FL3731_FrameQueue::publish()
+{
+    // Release makes the finished pixels visible to whoever swaps the
+    // buffer out; acquire makes the buffer we get back safe to overwrite.
+    uint8_t prev = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel);
+    if(prev & FRESH)
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    back_ = prev & INDEX_MASK;
+    back_canvas_.attach(buffers_[back_], width_, height_);
+    published_.fetch_add(1, std::memory_order_relaxed);
+}
+
+const uint8_t* IS31FL3731_FrameQueue::acquire()
+{
+    if(!(middle_.load(std::memory_order_relaxed) & FRESH))
+    {
+        return nullptr;
+    }
+
+    uint8_t prev = middle_.exchange(front_, std::memory_order_acq_rel);
+    front_       = prev & INDEX_MASK;
+    return buffers_[front_];
+}
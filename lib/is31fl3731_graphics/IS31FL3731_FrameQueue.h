@@ -0,0 +1,54 @@
+#pragma once
+
+#ifndef IS31FL3731_FRAMEQUEUE_H
+#define IS31FL3731_FRAMEQUEUE_H
+
+#include "IS31FL3731_Canvas.h"
+#include <atomic>
+#include <stdint.h>
+
+#define IS31FL3731_FRAMEQUEUE_FRAME_SIZE 144
+
+// Lock-free triple buffer handing whole frames from one producer context
+// (timer ISR, audio block boundary) to one flush context. The producer
+// always has a buffer to draw into, the consumer always gets the newest
+// published frame, and frames published faster than they are consumed
+// are dropped rather than queued.
+class IS31FL3731_FrameQueue
+{
+  public:
+    IS31FL3731_FrameQueue();
+
+    bool Init(uint16_t width, uint16_t height);
+
+    // Producer side. The canvas is reassigned to a different buffer after
+    // every publish() and holds stale content, so redraw it completely.
+    IS31FL3731_Canvas* back() { return &back_canvas_; }
+    void               publish();
+
+    // Consumer side. Returns the newest published frame, or nullptr if
+    // nothing new was published since the last call. The pointer stays
+    // valid until the next acquire().
+    const uint8_t* acquire();
+
+    uint16_t width() const { return width_; }
+    uint16_t height() const { return height_; }
+    uint32_t published() const { return published_.load(std::memory_order_relaxed); }
+    uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  private:
+    static const uint8_t INDEX_MASK = 0x03;
+    static const uint8_t FRESH      = 0x04;
+
+    uint8_t              buffers_[3][IS31FL3731_FRAMEQUEUE_FRAME_SIZE];
+    uint16_t             width_;
+    uint16_t             height_;
+    uint8_t              back_;   // producer only
+    uint8_t              front_;  // consumer only
+    std::atomic<uint8_t> middle_; // index | FRESH, swapped by both
+    std::atomic<uint32_t> published_;
+    std::atomic<uint32_t> dropped_;
+    IS31FL3731_Canvas    back_canvas_;
+};
+
+#endif
@@ -6,17 +6,55 @@
 #define min(a, b) (((a) < (b)) ? (a) : (b))
 #define max(a, b) (((a) > (b)) ? (a) : (b))
 
+static int64_t floorDiv(int64_t a, int64_t b)
+{
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static int64_t ceilDiv(int64_t a, int64_t b)
+{
+    return -floorDiv(-a, b);
+}
+
 IS31FL3731_Graphics::IS31FL3731_Graphics()
-: driver_(nullptr), width_(0), height_(0), frame_(0)
+: IS31FL3731_Graphics(nullptr, 0)
+{
+}
+
+IS31FL3731_Graphics::IS31FL3731_Graphics(uint8_t* storage, uint16_t storage_size)
+: driver_(nullptr),
+  width_(0),
+  height_(0),
+  frame_(0),
+  brightness_cache_(nullptr),
+  cache_size_(0),
+  owns_cache_(false),
+  storage_(storage),
+  storage_size_(storage_size),
+  target_(&output_),
+  layer_count_(0),
+  font_(&IS31FL3731_FONT_5X7),
+  capturing_(false),
+  frame_queue_(nullptr),
+  verify_interval_(0),
+  updates_since_verify_(0),
+  dropped_base_(0),
+  breath_hardware_(false),
+  breath_software_(false),
+  breath_start_ms_(0),
+  breath_level_(255)
 {
+    breath_.Defaults();
+    output_.trackRows(output_rows_, sizeof(output_rows_) / sizeof(output_rows_[0]));
+    compose_damage_.clear();
+    capture_.clear();
+    stats_.reset();
+    resetClip();
 }
 
 IS31FL3731_Graphics::~IS31FL3731_Graphics()
 {
-    if(brightness_cache_ != nullptr)
-    {
-        delete[] brightness_cache_;
-    }
+    releaseCache();
 }
 
 bool IS31FL3731_Graphics::Init(const Config& config)
@@ -26,177 +64,813 @@ bool IS31FL3731_Graphics::Init(const Config& config)
         return false;
     }
 
+    uint16_t size = config.driver->getWidth() * config.driver->getHeight();
+    if(size == 0 || size > 144 || config.frame > 7)
+    {
+        return false;
+    }
+    if(config.buffer != nullptr ? config.buffer_size < size
+                                : storage_ != nullptr && storage_size_ < size)
+    {
+        return false;
+    }
+
+    releaseCache();
+    if(config.buffer != nullptr)
+    {
+        brightness_cache_ = config.buffer;
+    }
+    else if(storage_ != nullptr)
+    {
+        brightness_cache_ = storage_;
+    }
+    else
+    {
+#ifdef IS31FL3731_GRAPHICS_NO_HEAP
+        return false;
+#else
+        brightness_cache_ = new uint8_t[size];
+        owns_cache_       = true;
+#endif
+    }
+
     driver_     = config.driver;
     frame_      = config.frame;
     width_       = driver_->getWidth();
     height_      = driver_->getHeight();
-    cache_size_  = width_ * height_;
-
-    brightness_cache_ = new uint8_t[cache_size_];
+    cache_size_  = size;
     memset(brightness_cache_, 0, cache_size_);
 
+    output_.attach(brightness_cache_, width_, height_);
+    target_ = &output_;
+    updateView();
+
+    verify_interval_      = config.verify_interval;
+    updates_since_verify_ = 0;
+    breath_hardware_      = false;
+    breath_software_      = false;
+    breath_level_         = 255;
+
     driver_->setFrame(frame_);
-    clear();
+    output_.clearDirty();
+    if(!driver_->clear())
+    {
+        output_.markDirty(0, 0, width_, height_);
+    }
 
     return true;
 }
 
+void IS31FL3731_Graphics::releaseCache()
+{
+    if(owns_cache_)
+    {
+        delete[] brightness_cache_;
+    }
+    brightness_cache_ = nullptr;
+    owns_cache_       = false;
+}
+
 void IS31FL3731_Graphics::setPixel(int16_t x, int16_t y, uint8_t brightness)
 {
-    if(x < 0 || x >= width_ || y < 0 || y >= height_)
+    plot(x, y, brightness);
+}
+
+// The primitives work out their geometry in 32 bits, in drawing
+// coordinates, and clip against view_ before anything is written, so
+// coordinates near the ends of the int16_t range cannot wrap around onto
+// the display. Only these helpers add the origin.
+void IS31FL3731_Graphics::plot(int32_t x, int32_t y, uint8_t brightness)
+{
+    if(x < view_.x0 || x >= view_.x1 || y < view_.y0 || y >= view_.y1)
     {
         return;
     }
 
-    uint16_t led_num = x + y * width_;
-    brightness_cache_[led_num] = brightness;
-    
-    driver_->drawPixel(x, y, brightness);
+    x += origin_x_;
+    y += origin_y_;
+    target_->setPixel(x, y, brightness);
+    markDirty(x, y, x + 1, y + 1);
+}
+
+void IS31FL3731_Graphics::span(int32_t x0, int32_t x1, int32_t y, uint8_t brightness)
+{
+    fillArea(x0, y, x1, y + 1, brightness);
+}
+
+// [x0, x1) x [y0, y1), clipped once; the rows are then filled unchecked.
+void IS31FL3731_Graphics::fillArea(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint8_t brightness)
+{
+    x0 = max(x0, view_.x0);
+    y0 = max(y0, view_.y0);
+    x1 = min(x1, view_.x1);
+    y1 = min(y1, view_.y1);
+    if(x1 <= x0 || y1 <= y0)
+        return;
+
+    x0 += origin_x_;
+    x1 += origin_x_;
+    y0 += origin_y_;
+    y1 += origin_y_;
+    for(int32_t y = y0; y < y1; y++)
+    {
+        target_->fillSpan(x0, x1, y, brightness);
+    }
+    markDirty(x0, y0, x1, y1);
+}
+
+bool IS31FL3731_Graphics::overlaps(int32_t x0, int32_t y0, int32_t x1, int32_t y1) const
+{
+    return x1 > x0 && y1 > y0 && x1 > view_.x0 && y1 > view_.y0 && x0 < view_.x1
+           && y0 < view_.y1;
+}
+
+uint8_t IS31FL3731_Graphics::outcode(int32_t x, int32_t y) const
+{
+    return (x < view_.x0 ? 1 : 0) | (x >= view_.x1 ? 2 : 0) | (y < view_.y0 ? 4 : 0)
+           | (y >= view_.y1 ? 8 : 0);
+}
+
+bool IS31FL3731_Graphics::contains(int32_t x0, int32_t y0, int32_t x1, int32_t y1) const
+{
+    return x0 >= view_.x0 && y0 >= view_.y0 && x1 <= view_.x1 && y1 <= view_.y1;
+}
+
+void IS31FL3731_Graphics::setOutputPixel(int16_t x, int16_t y, uint8_t brightness)
+{
+    brightness_cache_[x + y * width_] = brightness;
+    output_.markDirty(x, y, x + 1, y + 1);
+}
+
+void IS31FL3731_Graphics::markDirty(int16_t x0, int16_t y0, int16_t x1, int16_t y1)
+{
+    target_->markDirty(x0, y0, x1, y1);
+    if(capturing_)
+    {
+        capture_.include(x0, y0, x1, y1);
+    }
+}
+
+void IS31FL3731_Graphics::beginCapture()
+{
+    capture_.clear();
+    capturing_ = true;
+}
+
+IS31FL3731_Rect IS31FL3731_Graphics::endCapture()
+{
+    capturing_ = false;
+    return capture_;
 }
 
 void IS31FL3731_Graphics::clear()
 {
-    driver_->clear();
+    fill(0);
 }
 
 void IS31FL3731_Graphics::fill(uint8_t brightness)
 {
-    driver_->clear();
-    
-    uint8_t buffer[144];
-    for(uint16_t i = 0; i < width_ * height_; i++)
+    if(view_.x0 + origin_x_ == 0 && view_.y0 + origin_y_ == 0
+       && view_.x1 + origin_x_ == target_->width() && view_.y1 + origin_y_ == target_->height())
     {
-        buffer[i] = brightness;
+        target_->fill(brightness);
+        markDirty(0, 0, target_->width(), target_->height());
+        return;
     }
-    
-    writeBuffer(buffer, width_ * height_);
+    fillArea(view_.x0, view_.y0, view_.x1, view_.y1, brightness);
 }
 
 void IS31FL3731_Graphics::update()
 {
+#ifndef IS31FL3731_NO_STATS
+    stats_.updates++;
+#endif
+    if(frame_queue_ != nullptr)
+    {
+        const uint8_t* frame = frame_queue_->acquire();
+        if(frame != nullptr)
+        {
+            takeFrame(frame);
+        }
+#ifndef IS31FL3731_NO_STATS
+        stats_.frames_dropped = frame_queue_->dropped() - dropped_base_;
+#endif
+    }
+
+    compose();
+    if(breath_software_)
+    {
+        breathTick();
+    }
+    flush();
     driver_->displayFrame(frame_);
+
+    if(verify_interval_ > 0 && ++updates_since_verify_ >= verify_interval_)
+    {
+        updates_since_verify_ = 0;
+        verify();
+    }
 }
 
-void IS31FL3731_Graphics::writeBuffer(uint8_t* buffer, uint16_t size)
+bool IS31FL3731_Graphics::verify()
 {
-    uint16_t led_count = width_ * height_;
-    if(size > led_count)
+    uint8_t scratch[144];
+    if(driver_->verifyPWM(0, chipFrame(scratch), width_ * height_, frame_))
     {
-        size = led_count;
+        return true;
     }
+    output_.markDirty(0, 0, width_, height_);
+    return false;
+}
 
-    uint8_t chunks = (size + 23) / 24;
-    
-    for(uint8_t chunk = 0; chunk < chunks; chunk++)
+bool IS31FL3731_Graphics::restore()
+{
+    compose();
+
+    uint8_t scratch[144];
+    uint8_t pwm[144];
+    memset(pwm, 0, sizeof(pwm));
+    memcpy(pwm, chipFrame(scratch), cache_size_);
+    if(!driver_->restore(pwm, frame_))
     {
-        uint8_t cmd[25];
-        cmd[0] = 0x24 + chunk * 24;
-        memcpy(&cmd[1], &buffer[chunk * 24], 24);
-        driver_->setLEDPWM(0, cmd[0], frame_);
+        output_.markDirty(0, 0, width_, height_);
+        return false;
     }
+    output_.clearDirty();
+    return true;
 }
 
-void IS31FL3731_Graphics::drawLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t brightness)
+bool IS31FL3731_Graphics::attachFrameQueue(IS31FL3731_FrameQueue* queue)
 {
-    int16_t dx = abs(x2 - x1);
-    int16_t dy = abs(y2 - y1);
-    int16_t sx = (x1 < x2) ? 1 : -1;
-    int16_t sy = (y1 < y2) ? 1 : -1;
-    int16_t err = dx - dy;
+    if(queue != nullptr && (queue->width() != width_ || queue->height() != height_))
+    {
+        return false;
+    }
+
+    frame_queue_  = queue;
+    dropped_base_ = queue != nullptr ? queue->dropped() : 0;
+    return true;
+}
+
+void IS31FL3731_Graphics::resetStats()
+{
+    stats_.reset();
+    dropped_base_ = frame_queue_ != nullptr ? frame_queue_->dropped() : 0;
+}
 
-    while(true)
+void IS31FL3731_Graphics::takeFrame(const uint8_t* frame)
+{
+    // Only rows that differ from what is already in the output get marked,
+    // so an unchanged frame costs no PWM writes.
+    for(int16_t y = 0; y < height_; y++)
     {
-        setPixel(x1, y1, brightness);
+        const uint8_t* src = &frame[y * width_];
+        uint8_t*       dst = &brightness_cache_[y * width_];
+        int16_t        x0  = 0;
+        int16_t        x1  = width_;
+
+        while(x0 < x1 && src[x0] == dst[x0])
+            x0++;
+        while(x1 > x0 && src[x1 - 1] == dst[x1 - 1])
+            x1--;
+        if(x0 == x1)
+            continue;
+
+        memcpy(&dst[x0], &src[x0], x1 - x0);
+        output_.markDirty(x0, y, x1, y + 1);
+    }
+}
 
-        if(x1 == x2 && y1 == y2)
-            break;
+void IS31FL3731_Graphics::setTarget(IS31FL3731_Canvas* canvas)
+{
+    target_ = (canvas != nullptr) ? canvas : &output_;
+    updateView();
+}
+
+void IS31FL3731_Graphics::setClip(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+    int32_t x1 = min((int32_t)x + w, (int32_t)INT16_MAX);
+    int32_t y1 = min((int32_t)y + h, (int32_t)INT16_MAX);
+    clip_.x0   = x;
+    clip_.y0   = y;
+    clip_.x1   = x1;
+    clip_.y1   = y1;
+    updateView();
+}
+
+void IS31FL3731_Graphics::setViewport(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+    origin_x_ = x;
+    origin_y_ = y;
+    setClip(x, y, w, h);
+}
+
+void IS31FL3731_Graphics::resetClip()
+{
+    origin_x_ = 0;
+    origin_y_ = 0;
+    setClip(0, 0, INT16_MAX, INT16_MAX);
+}
+
+IS31FL3731_Graphics::ClipState IS31FL3731_Graphics::saveClip() const
+{
+    ClipState state;
+    state.clip     = clip_;
+    state.origin_x = origin_x_;
+    state.origin_y = origin_y_;
+    return state;
+}
+
+void IS31FL3731_Graphics::restoreClip(const ClipState& state)
+{
+    clip_     = state.clip;
+    origin_x_ = state.origin_x;
+    origin_y_ = state.origin_y;
+    updateView();
+}
+
+IS31FL3731_Rect IS31FL3731_Graphics::clip() const
+{
+    IS31FL3731_Rect r;
+    r.x0 = view_.x0 + origin_x_;
+    r.y0 = view_.y0 + origin_y_;
+    r.x1 = view_.x1 + origin_x_;
+    r.y1 = view_.y1 + origin_y_;
+    if(r.empty())
+        r.clear();
+    return r;
+}
+
+void IS31FL3731_Graphics::updateView()
+{
+    view_.x0 = max((int32_t)clip_.x0, (int32_t)0) - origin_x_;
+    view_.y0 = max((int32_t)clip_.y0, (int32_t)0) - origin_y_;
+    view_.x1 = min((int32_t)clip_.x1, (int32_t)target_->width()) - origin_x_;
+    view_.y1 = min((int32_t)clip_.y1, (int32_t)target_->height()) - origin_y_;
+}
 
-        int16_t e2 = 2 * err;
+bool IS31FL3731_Graphics::addLayer(IS31FL3731_Canvas* layer)
+{
+    if(layer == nullptr || !layer->valid() || layer_count_ >= IS31FL3731_GRAPHICS_MAX_LAYERS)
+    {
+        return false;
+    }
 
-        if(e2 > dy)
+    for(uint8_t i = 0; i < layer_count_; i++)
+    {
+        if(layers_[i] == layer)
         {
-            err -= dy;
-            x1 += sx;
+            return true;
         }
+    }
 
-        if(e2 < dx)
+    layers_[layer_count_++] = layer;
+    compose_damage_.include(layer->footprint());
+    return true;
+}
+
+void IS31FL3731_Graphics::removeLayer(IS31FL3731_Canvas* layer)
+{
+    for(uint8_t i = 0; i < layer_count_; i++)
+    {
+        if(layers_[i] == layer)
         {
-            err += dx;
-            y1 += sy;
+            compose_damage_.include(layer->footprint());
+            compose_damage_.include(layer->screenDirty());
+            for(uint8_t j = i + 1; j < layer_count_; j++)
+            {
+                layers_[j - 1] = layers_[j];
+            }
+            layer_count_--;
+            return;
         }
     }
 }
 
-void IS31FL3731_Graphics::drawHLine(int16_t x, int16_t y, int16_t w, uint8_t brightness)
+void IS31FL3731_Graphics::compose()
 {
-    if(y < 0 || y >= height_)
+    IS31FL3731_Rect region = compose_damage_;
+    for(uint8_t i = 0; i < layer_count_; i++)
+    {
+        region.include(layers_[i]->screenDirty());
+    }
+    region.clip(width_, height_);
+
+    // Only the union of the dirty layer regions is recomposited; untouched
+    // layers cost nothing.
+    if(region.empty())
+    {
         return;
+    }
+
+    int16_t span = region.x1 - region.x0;
+    for(int16_t y = region.y0; y < region.y1; y++)
+    {
+        memset(&brightness_cache_[region.x0 + y * width_], 0, span);
+    }
+
+    for(uint8_t i = 0; i < layer_count_; i++)
+    {
+        IS31FL3731_Canvas* layer = layers_[i];
+        if(!layer->visible())
+        {
+            continue;
+        }
 
-    int16_t x_start = x;
-    int16_t x_end = x + w;
+        IS31FL3731_Rect r = layer->footprint();
+        if(r.x0 < region.x0)
+            r.x0 = region.x0;
+        if(r.y0 < region.y0)
+            r.y0 = region.y0;
+        if(r.x1 > region.x1)
+            r.x1 = region.x1;
+        if(r.y1 > region.y1)
+            r.y1 = region.y1;
+        if(r.empty())
+        {
+            continue;
+        }
 
-    if(x_start < 0)
-        x_start = 0;
-    if(x_end > width_)
-        x_end = width_;
+        // Packed layers are expanded to PWM through their palette here,
+        // one row at a time.
+        uint8_t scratch[IS31FL3731_CANVAS_MAX_ROW];
+        for(int16_t y = r.y0; y < r.y1; y++)
+        {
+            const uint8_t* src = layer->expandRow(
+                r.x0 - layer->offsetX(), y - layer->offsetY(), r.x1 - r.x0, scratch);
+            blendRow(&brightness_cache_[r.x0 + y * width_],
+                     src,
+                     r.x1 - r.x0,
+                     layer->blend(),
+                     layer->opacity());
+        }
+    }
 
-    for(int16_t ix = x_start; ix < x_end; ix++)
+    for(uint8_t i = 0; i < layer_count_; i++)
     {
-        setPixel(ix, y, brightness);
+        layers_[i]->clearDirty();
     }
+    compose_damage_.clear();
+    output_.markDirty(region.x0, region.y0, region.x1, region.y1);
 }
 
-void IS31FL3731_Graphics::drawVLine(int16_t x, int16_t y, int16_t h, uint8_t brightness)
+void IS31FL3731_Graphics::blendRow(uint8_t*                 dst,
+                                   const uint8_t*           src,
+                                   int16_t                  count,
+                                   IS31FL3731_Canvas::Blend blend,
+                                   uint8_t                  opacity)
+{
+    uint16_t weight = opacity + 1;
+
+    for(int16_t i = 0; i < count; i++)
+    {
+        int16_t d = dst[i];
+        int16_t s = src[i];
+        int16_t v;
+
+        switch(blend)
+        {
+            case IS31FL3731_Canvas::Blend::OVER:
+                if(s == 0)
+                    continue;
+                v = s;
+                break;
+            case IS31FL3731_Canvas::Blend::ADD: v = min(d + s, 255); break;
+            case IS31FL3731_Canvas::Blend::MAX: v = max(d, s); break;
+            case IS31FL3731_Canvas::Blend::MULTIPLY: v = (d * (s + 1)) >> 8; break;
+            default: v = s; break;
+        }
+
+        if(opacity != 255)
+        {
+            v = d + (((v - d) * weight) >> 8);
+        }
+        dst[i] = (uint8_t)v;
+    }
+}
+
+void IS31FL3731_Graphics::flush()
 {
-    if(x < 0 || x >= width_)
+    IS31FL3731_Rect r = output_.dirty();
+    r.clip(width_, height_);
+    if(r.empty())
+    {
         return;
+    }
 
-    int16_t y_start = y;
-    int16_t y_end = y + h;
+    uint32_t               start = IS31FL3731_Timer::now();
+    uint8_t                scratch[144];
+    const uint8_t*         frame = chipFrame(scratch);
+    const IS31FL3731_Span* rows  = output_.dirtyRows();
+
+    // Only the dirty span of each row goes out. Spans are runs of LEDs in
+    // register order, and one that starts within ISSI_BURST_OVERHEAD clean
+    // LEDs of the last joins its burst, since resending those costs less
+    // than a new transfer. A failed burst leaves everything dirty so the
+    // next update() retries.
+    bool     ok    = true;
+    bool     open  = false;
+    uint16_t first = 0;
+    uint16_t last  = 0;
+    for(int16_t y = r.y0; y < r.y1; y++)
+    {
+        int16_t x0 = rows != nullptr ? rows[y].x0 : r.x0;
+        int16_t x1 = rows != nullptr ? rows[y].x1 : r.x1;
+        if(x1 <= x0)
+        {
+            continue;
+        }
 
-    if(y_start < 0)
-        y_start = 0;
-    if(y_end > height_)
-        y_end = height_;
+        uint16_t a = x0 + y * width_;
+        uint16_t b = (x1 - 1) + y * width_;
+        if(open && a - last - 1 <= ISSI_BURST_OVERHEAD)
+        {
+            last = b;
+            continue;
+        }
+        if(open)
+        {
+            ok &= flushRun(first, last, frame);
+        }
+        first = a;
+        last  = b;
+        open  = true;
+    }
+    if(open)
+    {
+        ok &= flushRun(first, last, frame);
+    }
 
-    for(int16_t iy = y_start; iy < y_end; iy++)
+    if(ok)
     {
-        setPixel(x, iy, brightness);
+        output_.clearDirty();
     }
+    recordFlush(start);
 }
 
-void IS31FL3731_Graphics::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t brightness, bool fill)
+bool IS31FL3731_Graphics::flushRun(uint16_t first, uint16_t last, const uint8_t* frame)
 {
-    if(fill)
+    return driver_->setLEDPWMBurst(first, &frame[first], last - first + 1, frame_);
+}
+
+// The framebuffer as the chip should hold it: scaled while breathing in
+// software, otherwise the framebuffer itself.
+const uint8_t* IS31FL3731_Graphics::chipFrame(uint8_t* scratch) const
+{
+    if(breath_level_ == 255)
+    {
+        return brightness_cache_;
+    }
+    uint16_t scale = breath_level_ + 1;
+    for(uint16_t i = 0; i < cache_size_; i++)
+    {
+        scratch[i] = (brightness_cache_[i] * scale) >> 8;
+    }
+    return scratch;
+}
+
+bool IS31FL3731_Graphics::breathe(const BreathConfig& config)
+{
+    stopBreathing();
+    breath_ = config;
+
+    if(config.allow_hardware && config.floor == 0 && config.fade_in_ms <= 3328
+       && config.fade_out_ms <= 3328 && config.off_ms <= 448)
     {
-        for(int16_t iy = y; iy < y + h && iy < height_; iy++)
+        IS31FL3731::BreathConfig chip;
+        chip.fade_in_ms    = config.fade_in_ms;
+        chip.fade_out_ms   = config.fade_out_ms;
+        chip.extinguish_ms = config.off_ms;
+        breath_hardware_   = driver_->setBreath(chip, true);
+        return breath_hardware_;
+    }
+
+    breath_software_ = true;
+    breath_start_ms_ = System::GetNow();
+    return true;
+}
+
+void IS31FL3731_Graphics::stopBreathing()
+{
+    if(breath_hardware_)
+    {
+        driver_->enableBreath(false);
+        breath_hardware_ = false;
+    }
+    if(breath_software_)
+    {
+        breath_software_ = false;
+        if(breath_level_ != 255)
         {
-            drawHLine(x, iy, w, brightness);
+            breath_level_ = 255;
+            output_.markDirty(0, 0, width_, height_);
         }
     }
+}
+
+// Linear ramps, squared so the fade looks even to the eye. A new level
+// means every LED changes, so the whole frame is marked.
+void IS31FL3731_Graphics::breathTick()
+{
+    uint32_t fade_in  = breath_.fade_in_ms;
+    uint32_t fade_out = breath_.fade_out_ms;
+    uint32_t period   = fade_in + fade_out + breath_.off_ms;
+    uint32_t ramp     = 255;
+    if(period > 0)
+    {
+        uint32_t t = (System::GetNow() - breath_start_ms_) % period;
+        if(t < fade_in)
+            ramp = t * 255 / fade_in;
+        else if(t < fade_in + fade_out)
+            ramp = 255 - (t - fade_in) * 255 / fade_out;
+        else
+            ramp = 0;
+        ramp = ramp * ramp / 255;
+    }
+
+    uint8_t level = breath_.floor + (255 - breath_.floor) * ramp / 255;
+    if(level != breath_level_)
+    {
+        breath_level_ = level;
+        output_.markDirty(0, 0, width_, height_);
+    }
+}
+
+void IS31FL3731_Graphics::recordFlush(uint32_t start)
+{
+#ifndef IS31FL3731_NO_STATS
+    uint32_t us = IS31FL3731_Timer::toMicros(IS31FL3731_Timer::now() - start);
+    stats_.flushes++;
+    stats_.flush_us.add(us);
+    if(us > stats_.max_flush_us)
+    {
+        stats_.max_flush_us = us;
+    }
+#endif
+}
+
+void IS31FL3731_Graphics::drawLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t brightness)
+{
+    line(x1, y1, x2, y2, brightness);
+}
+
+// Outcodes reject a line that lies wholly on one side of the clip. For the
+// rest, the steps along the major axis that land inside the clip are worked
+// out directly: the major axis moves every step, and after k steps the
+// minor axis has moved (2 * k * minor + major - 1) / (2 * major) pixels.
+// The walk starts at the first visible pixel and draws the visible run
+// without checks, pixel for pixel the same as walking the whole line.
+void IS31FL3731_Graphics::line(int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint8_t brightness)
+{
+    if(outcode(x1, y1) & outcode(x2, y2))
+        return;
+
+    int32_t dx    = abs(x2 - x1);
+    int32_t dy    = abs(y2 - y1);
+    int32_t sx    = (x1 < x2) ? 1 : -1;
+    int32_t sy    = (y1 < y2) ? 1 : -1;
+    bool    steep = dy > dx;
+    int64_t major = steep ? dy : dx;
+    int64_t minor = steep ? dx : dy;
+
+    // Visible steps along the major axis, then pixels moved along the minor.
+    int32_t a  = steep ? y1 : x1;
+    int32_t sa = steep ? sy : sx;
+    int32_t a0 = steep ? view_.y0 : view_.x0;
+    int32_t a1 = (steep ? view_.y1 : view_.x1) - 1;
+    int64_t k0 = sa > 0 ? a0 - a : a - a1;
+    int64_t k1 = sa > 0 ? a1 - a : a - a0;
+
+    int32_t b  = steep ? x1 : y1;
+    int32_t sb = steep ? sx : sy;
+    int32_t b0 = steep ? view_.x0 : view_.y0;
+    int32_t b1 = (steep ? view_.x1 : view_.y1) - 1;
+    int64_t m0 = sb > 0 ? b0 - b : b - b1;
+    int64_t m1 = sb > 0 ? b1 - b : b - b0;
+
+    if(minor == 0)
+    {
+        if(m0 > 0 || m1 < 0)
+            return;
+    }
     else
     {
-        drawLine(x, y, x + w - 1, y, brightness);
-        drawLine(x + w - 1, y, x + w - 1, y + h - 1, brightness);
-        drawLine(x + w - 1, y + h - 1, x, y + h - 1, brightness);
-        drawLine(x, y + h - 1, x, y, brightness);
+        k0 = max(k0, ceilDiv(2 * major * m0 - major + 1, 2 * minor));
+        k1 = min(k1, floorDiv(2 * major * (m1 + 1) - major, 2 * minor));
+    }
+    k0 = max(k0, (int64_t)0);
+    k1 = min(k1, major);
+    if(k0 > k1)
+        return;
+
+    int64_t m   = major > 0 ? floorDiv(2 * k0 * minor + major - 1, 2 * major) : 0;
+    int64_t xs  = steep ? m : k0;
+    int64_t ys  = steep ? k0 : m;
+    int32_t x   = x1 + sx * xs + origin_x_;
+    int32_t y   = y1 + sy * ys + origin_y_;
+    int32_t err = dx - dy - xs * dy + ys * dx;
+    int32_t xa  = x;
+    int32_t ya  = y;
+
+    for(int64_t k = k0;; k++)
+    {
+        target_->setPixel(x, y, brightness);
+
+        if(k == k1)
+            break;
+
+        int32_t e2 = 2 * err;
+
+        if(e2 > -dy)
+        {
+            err -= dy;
+            x += sx;
+        }
+
+        if(e2 < dx)
+        {
+            err += dx;
+            y += sy;
+        }
+    }
+
+    markDirty(min(xa, x), min(ya, y), max(xa, x) + 1, max(ya, y) + 1);
+}
+
+void IS31FL3731_Graphics::drawHLine(int16_t x, int16_t y, int16_t w, uint8_t brightness)
+{
+    span(x, (int32_t)x + w, y, brightness);
+}
+
+void IS31FL3731_Graphics::drawVLine(int16_t x, int16_t y, int16_t h, uint8_t brightness)
+{
+    vspan(x, y, (int32_t)y + h, brightness);
+}
+
+void IS31FL3731_Graphics::vspan(int32_t x, int32_t y0, int32_t y1, uint8_t brightness)
+{
+    if(x < view_.x0 || x >= view_.x1)
+        return;
+
+    y0 = max(y0, view_.y0);
+    y1 = min(y1, view_.y1);
+    if(y1 <= y0)
+        return;
+
+    x += origin_x_;
+    y0 += origin_y_;
+    y1 += origin_y_;
+    for(int32_t y = y0; y < y1; y++)
+    {
+        target_->setPixel(x, y, brightness);
     }
+    markDirty(x, y0, x + 1, y1);
+}
+
+void IS31FL3731_Graphics::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t brightness, bool fill)
+{
+    int32_t x2 = (int32_t)x + w - 1;
+    int32_t y2 = (int32_t)y + h - 1;
+
+    if(fill)
+    {
+        fillArea(x, y, x2 + 1, y2 + 1, brightness);
+    }
+    else
+    {
+        line(x, y, x2, y, brightness);
+        line(x2, y, x2, y2, brightness);
+        line(x2, y2, x, y2, brightness);
+        line(x, y2, x, y, brightness);
+    }
+}
+
+void IS31FL3731_Graphics::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t brightness)
+{
+    drawRect(x, y, w, h, brightness, true);
 }
 
 void IS31FL3731_Graphics::drawCircle(int16_t cx, int16_t cy, int16_t radius, uint8_t brightness, bool fill)
 {
-    int16_t x = 0;
-    int16_t y = radius;
-    int16_t err = 1 - radius;
+    int32_t x0 = (int32_t)cx - radius;
+    int32_t y0 = (int32_t)cy - radius;
+    int32_t x1 = (int32_t)cx + radius + 1;
+    int32_t y1 = (int32_t)cy + radius + 1;
+    if(!overlaps(x0, y0, x1, y1))
+        return;
+
+    int32_t x = 0;
+    int32_t y = radius;
+    int32_t err = 1 - y;
 
     if(fill)
     {
         while(y >= x)
         {
-            drawHLine(cx - x, cy - y, 2 * x + 1, brightness);
-            drawHLine(cx - x, cy + y, 2 * x + 1, brightness);
-            drawHLine(cx - y, cy - x, 2 * y + 1, brightness);
-            drawHLine(cx - y, cy + x, 2 * y + 1, brightness);
+            span(cx - x, cx + x + 1, cy - y, brightness);
+            span(cx - x, cx + x + 1, cy + y, brightness);
+            span(cx - y, cx + y + 1, cy - x, brightness);
+            span(cx - y, cx + y + 1, cy + x, brightness);
 
             if(err < 0)
             {
@@ -212,16 +886,21 @@ void IS31FL3731_Graphics::drawCircle(int16_t cx, int16_t cy, int16_t radius, uin
     }
     else
     {
+        // A circle wholly inside the clip is drawn without checks.
+        bool inside = contains(x0, y0, x1, y1);
+        if(inside)
+            markDirty(x0 + origin_x_, y0 + origin_y_, x1 + origin_x_, y1 + origin_y_);
+
         while(y >= x)
         {
-            setPixel(cx + x, cy - y, brightness);
-            setPixel(cx - x, cy - y, brightness);
-            setPixel(cx + x, cy + y, brightness);
-            setPixel(cx - x, cy + y, brightness);
-            setPixel(cx + y, cy - x, brightness);
-            setPixel(cx - y, cy - x, brightness);
-            setPixel(cx + y, cy + x, brightness);
-            setPixel(cx - y, cy + x, brightness);
+            point(inside, cx + x, cy - y, brightness);
+            point(inside, cx - x, cy - y, brightness);
+            point(inside, cx + x, cy + y, brightness);
+            point(inside, cx - x, cy + y, brightness);
+            point(inside, cx + y, cy - x, brightness);
+            point(inside, cx - y, cy - x, brightness);
+            point(inside, cx + y, cy + x, brightness);
+            point(inside, cx - y, cy + x, brightness);
 
             if(err < 0)
             {
@@ -241,33 +920,31 @@ void IS31FL3731_Graphics::drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16
 {
     if(fill)
     {
-        int16_t coords[] = {x0, y0, x1, y1, x2, y2};
+        int32_t coords[] = {x0, y0, x1, y1, x2, y2};
 
-        int16_t minY = min(min(y0, y1), y2);
-        int16_t maxY = max(max(y0, y1), y2);
+        // Only rows inside the clip are scanned.
+        int32_t minY = max((int32_t)min(min(y0, y1), y2), view_.y0);
+        int32_t maxY = min((int32_t)max(max(y0, y1), y2), view_.y1 - 1);
 
-        for(int16_t y = minY; y <= maxY; y++)
+        for(int32_t y = minY; y <= maxY; y++)
         {
-            if(y < 0 || y >= height_)
-                continue;
-
-            int16_t xMin = width_ - 1;
-            int16_t xMax = 0;
+            int32_t xMin = INT32_MAX;
+            int32_t xMax = INT32_MIN;
 
             bool foundEdge = false;
 
             for(int16_t i = 0; i < 3; i++)
             {
                 int16_t j = (i + 1) % 3;
-                int16_t y1_i = coords[2 * i + 1];
-                int16_t y2_j = coords[2 * j + 1];
-                int16_t x1_i = coords[2 * i];
-                int16_t x2_j = coords[2 * j];
+                int32_t y1_i = coords[2 * i + 1];
+                int32_t y2_j = coords[2 * j + 1];
+                int32_t x1_i = coords[2 * i];
+                int32_t x2_j = coords[2 * j];
 
                 if((y >= y1_i && y < y2_j) || (y >= y2_j && y < y1_i))
                 {
                     float t = (float)(y - y1_i) / (y2_j - y1_i);
-                    int16_t x = x1_i + (int16_t)(t * (x2_j - x1_i));
+                    int32_t x = x1_i + (int32_t)(t * (x2_j - x1_i));
 
                     if(x < xMin)
                         xMin = x;
@@ -279,20 +956,15 @@ void IS31FL3731_Graphics::drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16
 
             if(foundEdge)
             {
-                if(xMin < 0)
-                    xMin = 0;
-                if(xMax >= width_)
-                    xMax = width_ - 1;
-
-                drawHLine(xMin, y, xMax - xMin + 1, brightness);
+                span(xMin, xMax + 1, y, brightness);
             }
         }
     }
     else
     {
-        drawLine(x0, y0, x1, y1, brightness);
-        drawLine(x1, y1, x2, y2, brightness);
-        drawLine(x2, y2, x0, y0, brightness);
+        line(x0, y0, x1, y1, brightness);
+        line(x1, y1, x2, y2, brightness);
+        line(x2, y2, x0, y0, brightness);
     }
 }
 
@@ -300,26 +972,30 @@ void IS31FL3731_Graphics::drawEllipse(int16_t cx, int16_t cy, int16_t rx, int16_
 {
     if(rx < 1 || ry < 1)
         return;
+    if(!overlaps((int32_t)cx - rx, (int32_t)cy - ry, (int32_t)cx + rx + 1, (int32_t)cy + ry + 1))
+        return;
 
-    int16_t x = 0;
-    int16_t y = ry;
-    int32_t rx2 = rx * rx;
-    int32_t ry2 = ry * ry;
-    int32_t p = ry2 - (rx2 * ry) + (rx2 / 4);
+    // The decision terms reach rx^2 * ry^2, past 32 bits for radii in the
+    // thousands.
+    int32_t x = 0;
+    int32_t y = ry;
+    int64_t rx2 = (int64_t)rx * rx;
+    int64_t ry2 = (int64_t)ry * ry;
+    int64_t p = ry2 - (rx2 * ry) + (rx2 / 4);
 
     while(x * ry2 < y * rx2)
     {
         if(fill)
         {
-            drawHLine(cx - x, cy - y, 2 * x + 1, brightness);
-            drawHLine(cx - x, cy + y, 2 * x + 1, brightness);
+            span(cx - x, cx + x + 1, cy - y, brightness);
+            span(cx - x, cx + x + 1, cy + y, brightness);
         }
         else
         {
-            setPixel(cx + x, cy - y, brightness);
-            setPixel(cx - x, cy - y, brightness);
-            setPixel(cx + x, cy + y, brightness);
-            setPixel(cx - x, cy + y, brightness);
+            plot(cx + x, cy - y, brightness);
+            plot(cx - x, cy - y, brightness);
+            plot(cx + x, cy + y, brightness);
+            plot(cx - x, cy + y, brightness);
         }
 
         x++;
@@ -340,15 +1016,15 @@ void IS31FL3731_Graphics::drawEllipse(int16_t cx, int16_t cy, int16_t rx, int16_
     {
         if(fill)
         {
-            drawHLine(cx - x, cy - y, 2 * x + 1, brightness);
-            drawHLine(cx - x, cy + y, 2 * x + 1, brightness);
+            span(cx - x, cx + x + 1, cy - y, brightness);
+            span(cx - x, cx + x + 1, cy + y, brightness);
         }
         else
         {
-            setPixel(cx + x, cy - y, brightness);
-            setPixel(cx - x, cy - y, brightness);
-            setPixel(cx + x, cy + y, brightness);
-            setPixel(cx - x, cy + y, brightness);
+            plot(cx + x, cy - y, brightness);
+            plot(cx - x, cy - y, brightness);
+            plot(cx + x, cy + y, brightness);
+            plot(cx - x, cy + y, brightness);
         }
 
         y--;
@@ -366,183 +1042,411 @@ void IS31FL3731_Graphics::drawEllipse(int16_t cx, int16_t cy, int16_t rx, int16_
 
 void IS31FL3731_Graphics::drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint8_t brightness, bool fill)
 {
-    if(w < 1 || h < 1)
+    int32_t right  = (int32_t)x + w;
+    int32_t bottom = (int32_t)y + h;
+    if(w < 1 || h < 1 || !overlaps(x, y, right, bottom))
         return;
 
-    if(r < 0)
-        r = 0;
-    if(r * 2 > w)
-        r = w / 2;
-    if(r * 2 > h)
-        r = h / 2;
+    int32_t rr = r;
+    if(rr < 0)
+        rr = 0;
+    if(rr * 2 > w)
+        rr = w / 2;
+    if(rr * 2 > h)
+        rr = h / 2;
 
-    int16_t x1 = x + r;
-    int16_t y1 = y + r;
-    int16_t x2 = x + w - 1 - r;
-    int16_t y2 = y + h - 1 - r;
+    // Centres of the corner arcs.
+    int32_t x1 = x + rr;
+    int32_t y1 = y + rr;
+    int32_t x2 = (int32_t)x + w - 1 - rr;
+    int32_t y2 = (int32_t)y + h - 1 - rr;
 
     if(fill)
     {
-        for(int16_t iy = y1; iy <= y2; iy++)
+        // Rows level with a corner are inset to the widest dx that still
+        // has dx * dx + dy * dy <= r * r. Only rows inside the clip are
+        // visited, so dx is moved whichever way the first of them needs.
+        int32_t dx = 0;
+        int32_t y0 = max((int32_t)y, view_.y0);
+        int32_t y3 = min(bottom, view_.y1);
+        for(int32_t iy = y0; iy < y3; iy++)
         {
-            drawHLine(x1, iy, x2 - x1 + 1, brightness);
+            int32_t dy = iy < y1 ? y1 - iy : (iy > y2 ? iy - y2 : 0);
+            while(dx < rr && (dx + 1) * (dx + 1) + dy * dy <= rr * rr)
+                dx++;
+            while(dx > 0 && dx * dx + dy * dy > rr * rr)
+                dx--;
+            span(x1 - dx, x2 + 1 + dx, iy, brightness);
         }
+        return;
+    }
 
-        for(int16_t iy = y; iy <= y2; iy++)
+    span(x1, x2 + 1, y, brightness);
+    span(x1, x2 + 1, bottom - 1, brightness);
+    vspan(x, y1, y2 + 1, brightness);
+    vspan(right - 1, y1, y2 + 1, brightness);
+
+    // One midpoint circle, each quadrant drawn around its own corner. The
+    // arcs stay inside the rectangle, so if it is inside the clip they are
+    // drawn without checks.
+    bool inside = contains(x, y, right, bottom);
+    if(inside)
+        markDirty(x + origin_x_, y + origin_y_, right + origin_x_, bottom + origin_y_);
+
+    int32_t cx  = 0;
+    int32_t cy  = rr;
+    int32_t err = 1 - rr;
+    while(cy >= cx)
+    {
+        point(inside, x2 + cx, y1 - cy, brightness);
+        point(inside, x2 + cy, y1 - cx, brightness);
+        point(inside, x1 - cx, y1 - cy, brightness);
+        point(inside, x1 - cy, y1 - cx, brightness);
+        point(inside, x2 + cx, y2 + cy, brightness);
+        point(inside, x2 + cy, y2 + cx, brightness);
+        point(inside, x1 - cx, y2 + cy, brightness);
+        point(inside, x1 - cy, y2 + cx, brightness);
+
+        if(err < 0)
         {
-            for(int16_t ix = x; ix < x1; ix++)
-            {
-                int16_t dx = x1 - ix;
-                int16_t dy = iy - y1;
-                if(dx * dx + dy * dy <= r * r)
-                {
-                    setPixel(ix, iy, brightness);
-                }
-            }
+            err += 2 * cx + 3;
         }
-
-        for(int16_t iy = y; iy <= y2; iy++)
+        else
         {
-            for(int16_t ix = x2 + 1; ix <= x + w - 1; ix++)
-            {
-                int16_t dx = ix - x2;
-                int16_t dy = iy - y1;
-                if(dx * dx + dy * dy <= r * r)
-                {
-                    setPixel(ix, iy, brightness);
-                }
-            }
+            cy--;
+            err += 2 * (cx - cy) + 5;
         }
+        cx++;
+    }
+}
+
+// Clips a w x h block at (x, y) in drawing coordinates to the clip and
+// returns it in target coordinates, with (sx, sy) the offset of the
+// visible part inside the block. Worked out in 32 bits: -x does not fit
+// an int16_t for x = -32768. The clipped values always do.
+bool IS31FL3731_Graphics::clipBlit(int16_t& x, int16_t& y, int16_t& w, int16_t& h, int16_t& sx, int16_t& sy)
+{
+    int32_t x0 = x, y0 = y, cw = w, ch = h;
+    int32_t ox = 0, oy = 0;
+
+    if(x0 < view_.x0)
+    {
+        ox = view_.x0 - x0;
+        cw -= ox;
+        x0 = view_.x0;
+    }
+    if(y0 < view_.y0)
+    {
+        oy = view_.y0 - y0;
+        ch -= oy;
+        y0 = view_.y0;
+    }
+    if(x0 + cw > view_.x1)
+        cw = view_.x1 - x0;
+    if(y0 + ch > view_.y1)
+        ch = view_.y1 - y0;
 
-        for(int16_t iy = y2 + 1; iy <= y + h - 1; iy++)
+    if(cw <= 0 || ch <= 0)
+        return false;
+
+    x  = x0 + origin_x_;
+    y  = y0 + origin_y_;
+    w  = cw;
+    h  = ch;
+    sx = ox;
+    sy = oy;
+    return true;
+}
+
+void IS31FL3731_Graphics::drawBitmapMasked(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h, uint8_t brightness, uint8_t background, bool opaque)
+{
+    int16_t stride = (w + 7) / 8;
+    int16_t sx, sy;
+    int16_t cw = w;
+    int16_t ch = h;
+
+    if(bitmap == nullptr || !clipBlit(x, y, cw, ch, sx, sy))
+        return;
+
+    uint8_t scratch[IS31FL3731_CANVAS_MAX_ROW];
+    for(int16_t j = 0; j < ch; j++)
+    {
+        const uint8_t* src = &bitmap[(sy + j) * stride];
+        uint8_t*       dst = target_->loadRow(x, y + j, cw, scratch);
+
+        for(int16_t i = 0; i < cw; i++)
         {
-            for(int16_t ix = x; ix < x1; ix++)
-            {
-                int16_t dx = x1 - ix;
-                int16_t dy = iy - y2;
-                if(dx * dx + dy * dy <= r * r)
-                {
-                    setPixel(ix, iy, brightness);
-                }
-            }
+            int16_t bit = sx + i;
+            if(src[bit >> 3] & (0x80 >> (bit & 7)))
+                dst[i] = brightness;
+            else if(opaque)
+                dst[i] = background;
         }
+        target_->storeRow(x, y + j, cw, dst);
+    }
+
+    markDirty(x, y, x + cw, y + ch);
+}
+
+void IS31FL3731_Graphics::drawBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h, uint8_t brightness)
+{
+    drawBitmapMasked(x, y, bitmap, w, h, brightness, 0, false);
+}
+
+void IS31FL3731_Graphics::drawBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h, uint8_t brightness, uint8_t background)
+{
+    drawBitmapMasked(x, y, bitmap, w, h, brightness, background, true);
+}
+
+void IS31FL3731_Graphics::drawGrayscaleBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h)
+{
+    int16_t sx, sy;
+    int16_t cw = w;
+    int16_t ch = h;
+
+    if(bitmap == nullptr || !clipBlit(x, y, cw, ch, sx, sy))
+        return;
+
+    for(int16_t j = 0; j < ch; j++)
+    {
+        target_->storeRow(x, y + j, cw, &bitmap[sx + (sy + j) * w]);
+    }
 
-        for(int16_t iy = y2 + 1; iy <= y + h - 1; iy++)
+    markDirty(x, y, x + cw, y + ch);
+}
+
+void IS31FL3731_Graphics::drawGrayscaleBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h, uint8_t transparent)
+{
+    int16_t sx, sy;
+    int16_t cw = w;
+    int16_t ch = h;
+
+    if(bitmap == nullptr || !clipBlit(x, y, cw, ch, sx, sy))
+        return;
+
+    uint8_t scratch[IS31FL3731_CANVAS_MAX_ROW];
+    for(int16_t j = 0; j < ch; j++)
+    {
+        const uint8_t* src = &bitmap[sx + (sy + j) * w];
+        uint8_t*       dst = target_->loadRow(x, y + j, cw, scratch);
+
+        for(int16_t i = 0; i < cw; i++)
         {
-            for(int16_t ix = x2 + 1; ix <= x + w - 1; ix++)
-            {
-                int16_t dx = ix - x2;
-                int16_t dy = iy - y2;
-                if(dx * dx + dy * dy <= r * r)
-                {
-                    setPixel(ix, iy, brightness);
-                }
-            }
+            if(src[i] != transparent)
+                dst[i] = src[i];
         }
+        target_->storeRow(x, y + j, cw, dst);
     }
-    else
+
+    markDirty(x, y, x + cw, y + ch);
+}
+
+void IS31FL3731_Graphics::drawGrayscaleBitmap(int16_t x, int16_t y, const uint8_t* bitmap, const uint8_t* mask, int16_t w, int16_t h)
+{
+    if(mask == nullptr)
     {
-        drawLine(x1, y, x2, y, brightness);
-        drawLine(x2, y, x2, y2, brightness);
-        drawLine(x2, y2, x1, y2, brightness);
-        drawLine(x1, y2, x1, y, brightness);
+        drawGrayscaleBitmap(x, y, bitmap, w, h);
+        return;
+    }
 
-        int16_t cx = x + r;
-        int16_t cy = y + r;
-        int16_t c_x = 0;
-        int16_t c_y = r;
-        int32_t p = 1 - r;
+    int16_t stride = (w + 7) / 8;
+    int16_t sx, sy;
+    int16_t cw = w;
+    int16_t ch = h;
 
-        while(c_y >= c_x)
-        {
-            setPixel(cx + c_x, cy - c_y, brightness);
-            setPixel(cx - c_x, cy - c_y, brightness);
+    if(bitmap == nullptr || !clipBlit(x, y, cw, ch, sx, sy))
+        return;
 
-            c_x++;
-            if(p < 0)
-            {
-                p += 2 * c_x + 1;
-            }
-            else
-            {
-                c_y--;
-                p += 2 * (c_x - c_y) + 1;
-            }
+    uint8_t scratch[IS31FL3731_CANVAS_MAX_ROW];
+    for(int16_t j = 0; j < ch; j++)
+    {
+        const uint8_t* src  = &bitmap[sx + (sy + j) * w];
+        const uint8_t* bits = &mask[(sy + j) * stride];
+        uint8_t*       dst  = target_->loadRow(x, y + j, cw, scratch);
+
+        for(int16_t i = 0; i < cw; i++)
+        {
+            int16_t bit = sx + i;
+            if(bits[bit >> 3] & (0x80 >> (bit & 7)))
+                dst[i] = src[i];
         }
+        target_->storeRow(x, y + j, cw, dst);
+    }
 
-        cx = x + w - 1 - r;
-        cy = y + r;
-        c_x = 0;
-        c_y = r;
-        p = 1 - r;
+    markDirty(x, y, x + cw, y + ch);
+}
 
-        while(c_y >= c_x)
-        {
-            setPixel(cx + c_x, cy - c_y, brightness);
-            setPixel(cx - c_x, cy - c_y, brightness);
+void IS31FL3731_Graphics::scroll(int16_t dx, int16_t dy, uint8_t fill)
+{
+    scrollRect(view_.x0, view_.y0, view_.x1 - view_.x0, view_.y1 - view_.y0, dx, dy, fill);
+}
 
-            c_x++;
-            if(p < 0)
-            {
-                p += 2 * c_x + 1;
-            }
-            else
-            {
-                c_y--;
-                p += 2 * (c_x - c_y) + 1;
-            }
-        }
+void IS31FL3731_Graphics::scrollRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t dx, int16_t dy, uint8_t fill)
+{
+    int16_t sx, sy;
+    if(!clipBlit(x, y, w, h, sx, sy))
+        return;
+    if(dx == 0 && dy == 0)
+        return;
 
-        cx = x + r;
-        cy = y + h - 1 - r;
-        c_x = 0;
-        c_y = r;
-        p = 1 - r;
+    // Columns of each row (relative to x) that receive shifted content.
+    int16_t keep    = w - abs(dx);
+    int16_t dst_col = dx > 0 ? dx : 0;
+    int16_t src_col = dx > 0 ? 0 : -dx;
+
+    // Walk rows against the direction of motion so sources are read
+    // before they are overwritten. For packed targets both rows go
+    // through scratch buffers; for 8-bit ones they are the canvas itself.
+    uint8_t src_scratch[IS31FL3731_CANVAS_MAX_ROW];
+    uint8_t dst_scratch[IS31FL3731_CANVAS_MAX_ROW];
+    for(int16_t i = 0; i < h; i++)
+    {
+        int16_t row     = (dy > 0) ? y + h - 1 - i : y + i;
+        int16_t src_row = row - dy;
 
-        while(c_y >= c_x)
+        if(keep <= 0 || src_row < y || src_row >= y + h)
         {
-            setPixel(cx + c_x, cy + c_y, brightness);
-            setPixel(cx - c_x, cy + c_y, brightness);
-
-            c_x++;
-            if(p < 0)
-            {
-                p += 2 * c_x + 1;
-            }
-            else
-            {
-                c_y--;
-                p += 2 * (c_x - c_y) + 1;
-            }
+            target_->fillSpan(x, x + w, row, fill);
+            continue;
         }
 
-        cx = x + w - 1 - r;
-        cy = y + h - 1 - r;
-        c_x = 0;
-        c_y = r;
-        p = 1 - r;
+        const uint8_t* src = target_->loadRow(x, src_row, w, src_scratch);
+        uint8_t*       dst = target_->loadRow(x, row, w, dst_scratch);
+        memmove(&dst[dst_col], &src[src_col], keep);
+        if(dx > 0)
+            memset(dst, fill, dx);
+        else if(dx < 0)
+            memset(&dst[keep], fill, -dx);
+        target_->storeRow(x, row, w, dst);
+    }
 
-        while(c_y >= c_x)
-        {
-            setPixel(cx + c_x, cy + c_y, brightness);
-            setPixel(cx - c_x, cy + c_y, brightness);
+    markDirty(x, y, x + w, y + h);
+}
 
-            c_x++;
-            if(p < 0)
-            {
-                p += 2 * c_x + 1;
-            }
-            else
-            {
-                c_y--;
-                p += 2 * (c_x - c_y) + 1;
-            }
+void IS31FL3731_Graphics::drawCanvas(int16_t x, int16_t y, const IS31FL3731_Canvas* src, int16_t sx, int16_t sy, int16_t w, int16_t h)
+{
+    if(src == nullptr)
+        return;
+
+    // Clipping to the source first can push x or y past the int16_t range;
+    // such a window is off the target anyway.
+    int32_t dx = x, dy = y, cw = w, ch = h;
+    if(sx < 0)
+    {
+        dx -= sx;
+        cw += sx;
+        sx = 0;
+    }
+    if(sy < 0)
+    {
+        dy -= sy;
+        ch += sy;
+        sy = 0;
+    }
+    if(sx + cw > src->width())
+        cw = src->width() - sx;
+    if(sy + ch > src->height())
+        ch = src->height() - sy;
+    if(!overlaps(dx, dy, dx + cw, dy + ch))
+        return;
+
+    x = dx;
+    y = dy;
+    w = cw;
+    h = ch;
+    int16_t cx, cy;
+    if(!clipBlit(x, y, w, h, cx, cy))
+        return;
+
+    // A packed source is expanded through its palette on the way. Copying
+    // a canvas onto itself further down runs bottom up so no source row is
+    // overwritten before it is read.
+    sx += cx;
+    sy += cy;
+    bool    up = src == target_ && y > sy;
+    uint8_t scratch[IS31FL3731_CANVAS_MAX_ROW];
+    for(int16_t i = 0; i < h; i++)
+    {
+        int16_t j = up ? h - 1 - i : i;
+        target_->storeRow(x, y + j, w, src->expandRow(sx, sy + j, w, scratch));
+    }
+
+    markDirty(x, y, x + w, y + h);
+}
+
+void IS31FL3731_Graphics::setFont(const IS31FL3731_Font* font)
+{
+    font_ = (font != nullptr) ? font : &IS31FL3731_FONT_5X7;
+}
+
+int16_t IS31FL3731_Graphics::drawChar(int16_t x, int16_t y, char c, uint8_t brightness)
+{
+    int16_t advance = font_->width + font_->spacing;
+
+    // Characters outside the font show as '?', or as a blank cell in a
+    // font that has no '?' either.
+    if(c < font_->first || c > font_->last)
+        c = '?';
+    if(c < font_->first || c > font_->last)
+        return advance;
+
+    int16_t w = font_->width;
+    int16_t h = font_->height;
+    int16_t sx, sy;
+    int16_t dx = x;
+    int16_t dy = y;
+    if(!clipBlit(dx, dy, w, h, sx, sy))
+        return advance;
+
+    const uint8_t* glyph = &font_->glyphs[(c - font_->first) * font_->width];
+
+    for(int16_t i = 0; i < w; i++)
+    {
+        uint8_t column = glyph[sx + i] >> sy;
+        for(int16_t j = 0; j < h; j++)
+        {
+            if(column & (1 << j))
+                target_->setPixel(dx + i, dy + j, brightness);
         }
     }
+
+    markDirty(dx, dy, dx + w, dy + h);
+    return advance;
+}
+
+int16_t IS31FL3731_Graphics::drawText(int16_t x, int16_t y, const char* text, uint8_t brightness)
+{
+    if(text == nullptr)
+        return x;
+
+    while(*text != '\0' && x < view_.x1)
+    {
+        x += drawChar(x, y, *text++, brightness);
+    }
+
+    while(*text != '\0')
+    {
+        x += font_->width + font_->spacing;
+        text++;
+    }
+
+    return x;
+}
+
+int16_t IS31FL3731_Graphics::textWidth(const char* text) const
+{
+    if(text == nullptr || *text == '\0')
+        return 0;
+
+    int16_t count = strlen(text);
+    return count * (font_->width + font_->spacing) - font_->spacing;
 }
 
 void IS31FL3731_Graphics::fadeAll(uint8_t target, uint8_t step)
 {
+    if(step == 0)
+        step = 1;
+
     bool any_changed;
     
     do
@@ -561,12 +1465,10 @@ void IS31FL3731_Graphics::fadeAll(uint8_t target, uint8_t step)
                 else
                     next_val = max(target, current - step);
                 
-                brightness_cache_[i] = next_val;
-                
                 int16_t x = i % width_;
                 int16_t y = i / width_;
                 
-                setPixel(x, y, next_val);
+                setOutputPixel(x, y, next_val);
                 any_changed = true;
             }
         }
@@ -583,6 +1485,8 @@ void IS31FL3731_Graphics::fadePixel(int16_t x, int16_t y, uint8_t target, uint8_
 {
     if(x < 0 || x >= width_ || y < 0 || y >= height_)
         return;
+    if(step == 0)
+        step = 1;
 
     uint16_t led_num = x + y * width_;
     
@@ -596,7 +1500,7 @@ void IS31FL3731_Graphics::fadePixel(int16_t x, int16_t y, uint8_t target, uint8_
         else
             next_val = max(target, current - step);
         
-        setPixel(x, y, next_val);
+        setOutputPixel(x, y, next_val);
         update();
     }
 }
@@ -5,10 +5,17 @@
 
 #include "daisy_seed.h"
 #include "../is31fl3731/is31fl3731.h"
+#include "IS31FL3731_Canvas.h"
+#include "IS31FL3731_Font.h"
+#include "IS31FL3731_FrameQueue.h"
 #include <stdint.h>
 
 using namespace daisy;
 
+#ifndef IS31FL3731_GRAPHICS_MAX_LAYERS
+#define IS31FL3731_GRAPHICS_MAX_LAYERS 4
+#endif
+
 class IS31FL3731_Graphics
 {
   public:
@@ -16,11 +23,43 @@ class IS31FL3731_Graphics
     {
         IS31FL3731* driver;
         uint8_t      frame;
-        
+        // Framebuffer of at least width * height bytes. With nullptr Init()
+        // allocates one, unless IS31FL3731_GRAPHICS_NO_HEAP is defined.
+        // Initialised here too, so a Config filled in by hand without
+        // Defaults() keeps the allocating behaviour.
+        uint8_t*     buffer      = nullptr;
+        uint16_t     buffer_size = 0;
+        // Read the frame back every this many update() calls and rewrite
+        // it if the chip lost anything. 0 turns the readback off.
+        uint16_t     verify_interval = 0;
+
         void Defaults()
         {
-            driver = nullptr;
-            frame  = 0;
+            driver          = nullptr;
+            frame           = 0;
+            buffer          = nullptr;
+            buffer_size     = 0;
+            verify_interval = 0;
+        }
+    };
+
+    // The whole display fades up from floor to what is drawn, back down,
+    // then stays at floor for off_ms, over and over.
+    struct BreathConfig
+    {
+        uint16_t fade_in_ms;
+        uint16_t fade_out_ms;
+        uint16_t off_ms;
+        uint8_t  floor;
+        bool     allow_hardware;
+
+        void Defaults()
+        {
+            fade_in_ms     = 832;
+            fade_out_ms    = 832;
+            off_ms         = 112;
+            floor          = 0;
+            allow_hardware = true;
         }
     };
 
@@ -34,6 +73,22 @@ class IS31FL3731_Graphics
     void fill(uint8_t brightness);
     void update();
 
+    // Reads the PWM registers back and compares them with the framebuffer.
+    // On a mismatch or bus error the whole frame is marked for rewriting
+    // by the next update().
+    bool verify();
+
+    // After the chip lost power: restores the driver's register state and
+    // rewrites the current frame in the same pass, so what was on screen
+    // comes back without begin() and without a visible clear. The
+    // framebuffer is the shadow copy; verify() confirms the result.
+    bool restore();
+
+    // Update and flush counters; bus traffic is in the driver's stats().
+    // All zero with IS31FL3731_NO_STATS.
+    const IS31FL3731_GraphicsStats& stats() const { return stats_; }
+    void                            resetStats();
+
     void drawLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t brightness);
     void drawHLine(int16_t x, int16_t y, int16_t w, uint8_t brightness);
     void drawVLine(int16_t x, int16_t y, int16_t h, uint8_t brightness);
@@ -44,21 +99,189 @@ class IS31FL3731_Graphics
     void drawEllipse(int16_t x, int16_t y, int16_t rx, int16_t ry, uint8_t brightness, bool fill = false);
     void drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint8_t brightness, bool fill = false);
 
+    // 1-bit bitmaps are row-major, MSB first, each row padded to a byte.
+    // Clear bits are transparent unless a background is given.
+    void drawBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h, uint8_t brightness);
+    void drawBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h, uint8_t brightness, uint8_t background);
+    void drawGrayscaleBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h);
+    void drawGrayscaleBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h, uint8_t transparent);
+    void drawGrayscaleBitmap(int16_t x, int16_t y, const uint8_t* bitmap, const uint8_t* mask, int16_t w, int16_t h);
+
+    // Shifts the draw target (or a region of it) in place by (dx, dy);
+    // uncovered pixels are set to fill.
+    void scroll(int16_t dx, int16_t dy, uint8_t fill = 0);
+    void scrollRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t dx, int16_t dy, uint8_t fill = 0);
+
+    // Copies a w x h window of src starting at (sx, sy), clipped to both.
+    void drawCanvas(int16_t x, int16_t y, const IS31FL3731_Canvas* src, int16_t sx, int16_t sy, int16_t w, int16_t h);
+
+    void                   setFont(const IS31FL3731_Font* font);
+    const IS31FL3731_Font* font() const { return font_; }
+    int16_t                drawChar(int16_t x, int16_t y, char c, uint8_t brightness);
+    int16_t                drawText(int16_t x, int16_t y, const char* text, uint8_t brightness);
+    int16_t                textWidth(const char* text) const;
+
     void fadeAll(uint8_t target, uint8_t step = 10);
     void fadePixel(int16_t x, int16_t y, uint8_t target, uint8_t step = 10);
 
+    // Hands breathing to the chip's breath control when the envelope fits
+    // it: floor 0, fades up to 3328 ms and off_ms up to 448 ms, with times
+    // snapped to the chip's power-of-two steps. Idle breathing then costs
+    // no bus traffic at all. Otherwise update() scales the frame itself
+    // and rewrites all of it whenever the level changes. Drawing carries
+    // on as usual either way. Returns false if the chip did not take it.
+    bool breathe(const BreathConfig& config);
+    void stopBreathing();
+    bool breathing() const { return breath_hardware_ || breath_software_; }
+    bool breathingInHardware() const { return breath_hardware_; }
+
+    // Layers are composited bottom to top into the output buffer on
+    // update(). While any layer is attached the output buffer belongs to
+    // the compositor, so draw into the layers instead.
+    bool addLayer(IS31FL3731_Canvas* layer);
+    void removeLayer(IS31FL3731_Canvas* layer);
+    void compose();
+
+    // With a frame queue attached, update() first takes the newest frame
+    // the producer published. All drawing then belongs to the producer
+    // context (into queue->back()); the flush context only calls update().
+    bool attachFrameQueue(IS31FL3731_FrameQueue* queue);
+
+    // Redirects all drawing into a canvas; nullptr draws into the output.
+    // Call it again after attaching the target to storage of another size.
+    void               setTarget(IS31FL3731_Canvas* canvas);
+    IS31FL3731_Canvas* target() { return target_; }
+
+    // Restricts drawing to a w x h rectangle of the target at (x, y). The
+    // clip stays set across setTarget() and is intersected with each
+    // target. Primitives clip their geometry to it up front and write the
+    // visible part without per-pixel checks, so an off-screen shape costs
+    // next to nothing. fill(), clear() and scroll() act on the clip.
+    void setClip(int16_t x, int16_t y, int16_t w, int16_t h);
+    // setClip() that also moves the origin to (x, y), so a widget can draw
+    // itself at 0, 0 wherever it sits.
+    void setViewport(int16_t x, int16_t y, int16_t w, int16_t h);
+    // The whole target, origin at 0, 0.
+    void resetClip();
+    // The clip in target coordinates, already intersected with the target.
+    IS31FL3731_Rect clip() const;
+
+    // Clip and origin as set. Code that draws into a target of its own
+    // saves them, resets the clip, and restores them when it is done.
+    struct ClipState
+    {
+        IS31FL3731_Rect clip;
+        int16_t         origin_x;
+        int16_t         origin_y;
+    };
+    ClipState saveClip() const;
+    void      restoreClip(const ClipState& state);
+
+    // Records the union of everything drawn into the target in between.
+    void            beginCapture();
+    IS31FL3731_Rect endCapture();
+
     uint16_t width() const { return width_; }
     uint16_t height() const { return height_; }
 
+  protected:
+    // For subclasses that bring their own framebuffer storage.
+    IS31FL3731_Graphics(uint8_t* storage, uint16_t storage_size);
+
   private:
+    // Clip in drawing (origin-relative) coordinates, intersected with the
+    // target; empty when x1 <= x0 or y1 <= y0.
+    struct View
+    {
+        int32_t x0;
+        int32_t y0;
+        int32_t x1;
+        int32_t y1;
+    };
+
     IS31FL3731* driver_;
     uint16_t        width_;
     uint16_t        height_;
     uint8_t         frame_;
     uint8_t*        brightness_cache_;
     uint16_t        cache_size_;
-    
-    void writeBuffer(uint8_t* buffer, uint16_t size);
+    bool            owns_cache_;
+    uint8_t*        storage_;
+    uint16_t        storage_size_;
+
+    IS31FL3731_Canvas  output_;
+    IS31FL3731_Span    output_rows_[144]; // dirty span of each output row
+    IS31FL3731_Canvas* target_;
+    IS31FL3731_Canvas* layers_[IS31FL3731_GRAPHICS_MAX_LAYERS];
+    uint8_t            layer_count_;
+    IS31FL3731_Rect    compose_damage_;
+    const IS31FL3731_Font* font_;
+    IS31FL3731_Rect        capture_;
+    bool                   capturing_;
+    IS31FL3731_FrameQueue*   frame_queue_;
+    uint16_t                 verify_interval_;
+    uint16_t                 updates_since_verify_;
+    IS31FL3731_GraphicsStats stats_;
+    uint32_t                 dropped_base_;
+    IS31FL3731_Rect          clip_; // as set, in target coordinates
+    int16_t                  origin_x_;
+    int16_t                  origin_y_;
+    View                     view_;
+    BreathConfig             breath_;
+    bool                     breath_hardware_;
+    bool                     breath_software_;
+    uint32_t                 breath_start_ms_;
+    uint8_t                  breath_level_; // scale of the frame on the chip, 255 for none
+
+    void releaseCache();
+    void flush();
+    bool flushRun(uint16_t first, uint16_t last, const uint8_t* frame);
+    void recordFlush(uint32_t start);
+    void breathTick();
+    const uint8_t* chipFrame(uint8_t* scratch) const;
+    void takeFrame(const uint8_t* frame);
+    void markDirty(int16_t x0, int16_t y0, int16_t x1, int16_t y1);
+    void updateView();
+    uint8_t outcode(int32_t x, int32_t y) const;
+    bool contains(int32_t x0, int32_t y0, int32_t x1, int32_t y1) const;
+    void point(bool inside, int32_t x, int32_t y, uint8_t brightness)
+    {
+        if(inside)
+            target_->setPixel(x + origin_x_, y + origin_y_, brightness);
+        else
+            plot(x, y, brightness);
+    }
+    void plot(int32_t x, int32_t y, uint8_t brightness);
+    void span(int32_t x0, int32_t x1, int32_t y, uint8_t brightness);
+    void fillArea(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint8_t brightness);
+    void vspan(int32_t x, int32_t y0, int32_t y1, uint8_t brightness);
+    void line(int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint8_t brightness);
+    bool overlaps(int32_t x0, int32_t y0, int32_t x1, int32_t y1) const;
+    bool clipBlit(int16_t& x, int16_t& y, int16_t& w, int16_t& h, int16_t& sx, int16_t& sy);
+    void drawBitmapMasked(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h, uint8_t brightness, uint8_t background, bool opaque);
+    void setOutputPixel(int16_t x, int16_t y, uint8_t brightness);
+    void blendRow(uint8_t*                 dst,
+                  const uint8_t*           src,
+                  int16_t                  count,
+                  IS31FL3731_Canvas::Blend blend,
+                  uint8_t                  opacity);
+};
+
+// Graphics with its framebuffer as a member, sized at compile time, so it
+// lands in .bss and shows up in the link map instead of on the heap.
+template <uint16_t W, uint16_t H>
+class IS31FL3731_StaticGraphics : public IS31FL3731_Graphics
+{
+    static_assert(W * H > 0 && W * H <= 144, "one IS31FL3731 drives at most 144 LEDs");
+
+  public:
+    IS31FL3731_StaticGraphics() : IS31FL3731_Graphics(storage_, W * H)
+    {
+        memset(storage_, 0, sizeof(storage_));
+    }
+
+  private:
+    uint8_t storage_[W * H];
 };
 
 #endif
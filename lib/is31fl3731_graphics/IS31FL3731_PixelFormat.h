@@ -0,0 +1,118 @@
+#pragma once
+
+#ifndef IS31FL3731_PIXELFORMAT_H
+#define IS31FL3731_PIXELFORMAT_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Canvas pixel storage. Packed formats keep a level per pixel and are
+// expanded to 8-bit PWM through the canvas palette only when composited or
+// copied, so layers and animation frames fit in internal SRAM.
+enum class IS31FL3731_PixelFormat
+{
+    GRAY8, // one byte per pixel, the value is the PWM duty
+    GRAY4, // two pixels per byte, high nibble first, 16-entry palette
+    MONO1, // eight pixels per byte, MSB first, 2-entry palette
+};
+
+// Per-format kernels: row stride, single pixel access, span fill and
+// palette expansion. Drawing values are 8-bit; set() quantizes them and
+// get() scales the stored level back up, so a value survives a round trip
+// through a packed canvas as closely as the format allows.
+template <IS31FL3731_PixelFormat F>
+struct IS31FL3731_PixelOps;
+
+template <>
+struct IS31FL3731_PixelOps<IS31FL3731_PixelFormat::GRAY8>
+{
+    static constexpr uint16_t stride(uint16_t width) { return width; }
+
+    static uint8_t get(const uint8_t* row, int16_t x) { return row[x]; }
+    static void    set(uint8_t* row, int16_t x, uint8_t v) { row[x] = v; }
+
+    static void fill(uint8_t* row, int16_t x0, int16_t x1, uint8_t v)
+    {
+        memset(&row[x0], v, x1 - x0);
+    }
+
+    static void expand(const uint8_t* row, int16_t x0, int16_t n, const uint8_t*, uint8_t* out)
+    {
+        memcpy(out, &row[x0], n);
+    }
+};
+
+template <>
+struct IS31FL3731_PixelOps<IS31FL3731_PixelFormat::GRAY4>
+{
+    static constexpr uint16_t stride(uint16_t width) { return (width + 1) / 2; }
+
+    static uint8_t level(const uint8_t* row, int16_t x)
+    {
+        return (x & 1) ? row[x >> 1] & 0x0F : row[x >> 1] >> 4;
+    }
+
+    static uint8_t get(const uint8_t* row, int16_t x) { return level(row, x) * 17; }
+
+    static void set(uint8_t* row, int16_t x, uint8_t v)
+    {
+        uint8_t& b = row[x >> 1];
+        b          = (x & 1) ? (b & 0xF0) | (v >> 4) : (b & 0x0F) | (v & 0xF0);
+    }
+
+    static void fill(uint8_t* row, int16_t x0, int16_t x1, uint8_t v)
+    {
+        if(x0 >= x1)
+            return;
+        if(x0 & 1)
+            set(row, x0++, v);
+        if(x1 & 1)
+            set(row, --x1, v);
+        memset(&row[x0 >> 1], (v & 0xF0) | (v >> 4), (x1 - x0) >> 1);
+    }
+
+    static void expand(const uint8_t* row, int16_t x0, int16_t n, const uint8_t* lut, uint8_t* out)
+    {
+        for(int16_t i = 0; i < n; i++)
+            out[i] = lut[level(row, x0 + i)];
+    }
+};
+
+template <>
+struct IS31FL3731_PixelOps<IS31FL3731_PixelFormat::MONO1>
+{
+    static constexpr uint16_t stride(uint16_t width) { return (width + 7) / 8; }
+
+    static bool bit(const uint8_t* row, int16_t x)
+    {
+        return row[x >> 3] & (0x80 >> (x & 7));
+    }
+
+    static uint8_t get(const uint8_t* row, int16_t x) { return bit(row, x) ? 255 : 0; }
+
+    // Any non-zero brightness lights the pixel; the palette sets how bright.
+    static void set(uint8_t* row, int16_t x, uint8_t v)
+    {
+        if(v)
+            row[x >> 3] |= 0x80 >> (x & 7);
+        else
+            row[x >> 3] &= ~(0x80 >> (x & 7));
+    }
+
+    static void fill(uint8_t* row, int16_t x0, int16_t x1, uint8_t v)
+    {
+        while(x0 < x1 && (x0 & 7))
+            set(row, x0++, v);
+        while(x1 > x0 && (x1 & 7))
+            set(row, --x1, v);
+        memset(&row[x0 >> 3], v ? 0xFF : 0x00, (x1 - x0) >> 3);
+    }
+
+    static void expand(const uint8_t* row, int16_t x0, int16_t n, const uint8_t* lut, uint8_t* out)
+    {
+        for(int16_t i = 0; i < n; i++)
+            out[i] = lut[bit(row, x0 + i)];
+    }
+};
+
+#endif
@@ -0,0 +1,453 @@
+#include "IS31FL3731_Scene.h"
+#include <string.h>
+
+// Bounds are worked out in 32 bits and clamped, so a node far off the
+// display still gets a valid (if clipped) rectangle.
+static int16_t clampCoord(int32_t v)
+{
+    return v < INT16_MIN ? INT16_MIN : (v > INT16_MAX ? INT16_MAX : v);
+}
+
+static IS31FL3731_Rect makeRect(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+    IS31FL3731_Rect r;
+    r.x0 = clampCoord(x0);
+    r.y0 = clampCoord(y0);
+    r.x1 = clampCoord(x1);
+    r.y1 = clampCoord(y1);
+    if(r.empty())
+        r.clear();
+    return r;
+}
+
+static bool touches(const IS31FL3731_Rect& a, const IS31FL3731_Rect& b)
+{
+    return a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1;
+}
+
+static bool intersects(const IS31FL3731_Rect& a, const IS31FL3731_Rect& b)
+{
+    return !a.empty() && !b.empty() && a.x0 < b.x1 && b.x0 < a.x1 && a.y0 < b.y1 && b.y0 < a.y1;
+}
+
+static int32_t area(const IS31FL3731_Rect& r)
+{
+    return (int32_t)(r.x1 - r.x0) * (r.y1 - r.y0);
+}
+
+IS31FL3731_Scene::IS31FL3731_Scene()
+: node_count_(0), changed_(false), full_(false), background_(0), damage_count_(0)
+{
+}
+
+int8_t IS31FL3731_Scene::add(Type type, const int16_t* params, uint8_t count, uint8_t brightness, bool fill)
+{
+    if(node_count_ >= IS31FL3731_SCENE_MAX_NODES)
+    {
+        return -1;
+    }
+
+    Node& node = nodes_[node_count_];
+    memset(node.params, 0, sizeof(node.params));
+    memcpy(node.params, params, count * sizeof(int16_t));
+    node.type       = type;
+    node.brightness = brightness;
+    node.fill       = fill;
+    node.visible    = true;
+    node.changed    = true;
+    node.data       = nullptr;
+    node.font       = &IS31FL3731_FONT_5X7;
+    node.draw       = nullptr;
+    node.context    = nullptr;
+    node.drawn.clear();
+    changed_ = true;
+    return node_count_++;
+}
+
+int8_t IS31FL3731_Scene::addRect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t brightness, bool fill)
+{
+    const int16_t params[] = {x, y, w, h};
+    return add(Type::RECT, params, 4, brightness, fill);
+}
+
+int8_t IS31FL3731_Scene::addRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint8_t brightness, bool fill)
+{
+    const int16_t params[] = {x, y, w, h, r};
+    return add(Type::ROUND_RECT, params, 5, brightness, fill);
+}
+
+int8_t IS31FL3731_Scene::addLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t brightness)
+{
+    const int16_t params[] = {x1, y1, x2, y2};
+    return add(Type::LINE, params, 4, brightness, false);
+}
+
+int8_t IS31FL3731_Scene::addCircle(int16_t x, int16_t y, int16_t radius, uint8_t brightness, bool fill)
+{
+    const int16_t params[] = {x, y, radius};
+    return add(Type::CIRCLE, params, 3, brightness, fill);
+}
+
+int8_t IS31FL3731_Scene::addEllipse(int16_t x, int16_t y, int16_t rx, int16_t ry, uint8_t brightness, bool fill)
+{
+    const int16_t params[] = {x, y, rx, ry};
+    return add(Type::ELLIPSE, params, 4, brightness, fill);
+}
+
+int8_t IS31FL3731_Scene::addText(int16_t x, int16_t y, const char* text, uint8_t brightness, const IS31FL3731_Font* font)
+{
+    const int16_t params[] = {x, y};
+    int8_t        index    = add(Type::TEXT, params, 2, brightness, false);
+    if(index >= 0)
+    {
+        nodes_[index].data = text;
+        if(font != nullptr)
+            nodes_[index].font = font;
+    }
+    return index;
+}
+
+int8_t IS31FL3731_Scene::addBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h, uint8_t brightness)
+{
+    const int16_t params[] = {x, y, w, h};
+    int8_t        index    = add(Type::BITMAP, params, 4, brightness, false);
+    if(index >= 0)
+        nodes_[index].data = bitmap;
+    return index;
+}
+
+int8_t IS31FL3731_Scene::addSprite(int16_t x, int16_t y, const uint8_t* pixels, int16_t w, int16_t h, int16_t transparent)
+{
+    const int16_t params[] = {x, y, w, h, transparent};
+    int8_t        index    = add(Type::SPRITE, params, 5, 0, false);
+    if(index >= 0)
+        nodes_[index].data = pixels;
+    return index;
+}
+
+int8_t IS31FL3731_Scene::addCustom(int16_t x, int16_t y, int16_t w, int16_t h, DrawFn draw, void* context)
+{
+    if(draw == nullptr)
+    {
+        return -1;
+    }
+
+    const int16_t params[] = {x, y, w, h};
+    int8_t        index    = add(Type::CUSTOM, params, 4, 0, false);
+    if(index >= 0)
+    {
+        nodes_[index].draw    = draw;
+        nodes_[index].context = context;
+    }
+    return index;
+}
+
+void IS31FL3731_Scene::touch(Node& node)
+{
+    node.changed = true;
+    changed_     = true;
+}
+
+void IS31FL3731_Scene::setParam(uint8_t node, uint8_t param, int16_t value)
+{
+    if(node >= node_count_ || param >= IS31FL3731_SCENE_MAX_PARAMS)
+    {
+        return;
+    }
+
+    Node& n = nodes_[node];
+    if(n.params[param] != value)
+    {
+        n.params[param] = value;
+        touch(n);
+    }
+}
+
+void IS31FL3731_Scene::moveTo(uint8_t node, int16_t x, int16_t y)
+{
+    if(node >= node_count_)
+    {
+        return;
+    }
+
+    Node& n = nodes_[node];
+    if(n.params[0] == x && n.params[1] == y)
+    {
+        return;
+    }
+
+    if(n.type == Type::LINE)
+    {
+        n.params[2] = clampCoord((int32_t)n.params[2] + x - n.params[0]);
+        n.params[3] = clampCoord((int32_t)n.params[3] + y - n.params[1]);
+    }
+    n.params[0] = x;
+    n.params[1] = y;
+    touch(n);
+}
+
+void IS31FL3731_Scene::setBrightness(uint8_t node, uint8_t brightness)
+{
+    if(node < node_count_ && nodes_[node].brightness != brightness)
+    {
+        nodes_[node].brightness = brightness;
+        touch(nodes_[node]);
+    }
+}
+
+void IS31FL3731_Scene::setVisible(uint8_t node, bool visible)
+{
+    if(node < node_count_ && nodes_[node].visible != visible)
+    {
+        nodes_[node].visible = visible;
+        touch(nodes_[node]);
+    }
+}
+
+void IS31FL3731_Scene::setText(uint8_t node, const char* text)
+{
+    if(node < node_count_ && nodes_[node].type == Type::TEXT)
+    {
+        setData(node, text);
+    }
+}
+
+void IS31FL3731_Scene::setData(uint8_t node, const void* data)
+{
+    if(node < node_count_ && nodes_[node].data != data)
+    {
+        nodes_[node].data = data;
+        touch(nodes_[node]);
+    }
+}
+
+void IS31FL3731_Scene::invalidate(uint8_t node)
+{
+    if(node < node_count_)
+    {
+        touch(nodes_[node]);
+    }
+}
+
+void IS31FL3731_Scene::invalidateAll()
+{
+    full_    = true;
+    changed_ = true;
+}
+
+void IS31FL3731_Scene::setBackground(uint8_t brightness)
+{
+    if(background_ != brightness)
+    {
+        background_ = brightness;
+        invalidateAll();
+    }
+}
+
+int16_t IS31FL3731_Scene::param(uint8_t node, uint8_t param) const
+{
+    if(node >= node_count_ || param >= IS31FL3731_SCENE_MAX_PARAMS)
+    {
+        return 0;
+    }
+    return nodes_[node].params[param];
+}
+
+IS31FL3731_Rect IS31FL3731_Scene::bounds(uint8_t node) const
+{
+    if(node >= node_count_)
+    {
+        IS31FL3731_Rect r;
+        r.clear();
+        return r;
+    }
+    return nodeBounds(nodes_[node]);
+}
+
+// Exactly the pixels each primitive can touch, so damage is never larger
+// than the node. A node that draws nothing gets empty bounds and is
+// skipped by render().
+IS31FL3731_Rect IS31FL3731_Scene::nodeBounds(const Node& node) const
+{
+    const int16_t* p = node.params;
+    int32_t        x = p[0];
+    int32_t        y = p[1];
+
+    switch(node.type)
+    {
+        case Type::LINE:
+            return makeRect(x < p[2] ? x : p[2],
+                            y < p[3] ? y : p[3],
+                            (x > p[2] ? x : p[2]) + 1,
+                            (y > p[3] ? y : p[3]) + 1);
+        case Type::CIRCLE: return makeRect(x - p[2], y - p[2], x + p[2] + 1, y + p[2] + 1);
+        case Type::ELLIPSE:
+            if(p[2] < 1 || p[3] < 1)
+                return makeRect(0, 0, 0, 0);
+            return makeRect(x - p[2], y - p[3], x + p[2] + 1, y + p[3] + 1);
+        case Type::TEXT:
+        {
+            const char* text = (const char*)node.data;
+            if(text == nullptr || *text == '\0')
+                return makeRect(0, 0, 0, 0);
+            int32_t advance = node.font->width + node.font->spacing;
+            return makeRect(x, y, x + (int32_t)strlen(text) * advance - node.font->spacing, y + node.font->height);
+        }
+        case Type::BITMAP:
+        case Type::SPRITE:
+            if(node.data == nullptr)
+                return makeRect(0, 0, 0, 0);
+            return makeRect(x, y, x + p[2], y + p[3]);
+        default: return makeRect(x, y, x + p[2], y + p[3]);
+    }
+}
+
+// Damage is kept as a few disjoint rectangles: a new one absorbs every
+// rectangle it touches, and when the list is full it is merged with the
+// one that grows the least.
+void IS31FL3731_Scene::addDamage(IS31FL3731_Rect r)
+{
+    if(r.empty())
+    {
+        return;
+    }
+
+    for(uint8_t i = 0; i < damage_count_;)
+    {
+        if(touches(r, damage_[i]))
+        {
+            r.include(damage_[i]);
+            damage_[i] = damage_[--damage_count_];
+            i          = 0;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    if(damage_count_ < IS31FL3731_SCENE_MAX_DAMAGE)
+    {
+        damage_[damage_count_++] = r;
+        return;
+    }
+
+    uint8_t best  = 0;
+    int32_t added = INT32_MAX;
+    for(uint8_t i = 0; i < damage_count_; i++)
+    {
+        IS31FL3731_Rect u = r;
+        u.include(damage_[i]);
+        int32_t grow = area(u) - area(damage_[i]);
+        if(grow < added)
+        {
+            added = grow;
+            best  = i;
+        }
+    }
+    r.include(damage_[best]);
+    damage_[best] = damage_[--damage_count_];
+    addDamage(r);
+}
+
+void IS31FL3731_Scene::drawNode(IS31FL3731_Graphics& gfx, const Node& node, const IS31FL3731_Rect& region) const
+{
+    const int16_t* p = node.params;
+    switch(node.type)
+    {
+        case Type::RECT: gfx.drawRect(p[0], p[1], p[2], p[3], node.brightness, node.fill); break;
+        case Type::ROUND_RECT: gfx.drawRoundRect(p[0], p[1], p[2], p[3], p[4], node.brightness, node.fill); break;
+        case Type::LINE: gfx.drawLine(p[0], p[1], p[2], p[3], node.brightness); break;
+        case Type::CIRCLE: gfx.drawCircle(p[0], p[1], p[2], node.brightness, node.fill); break;
+        case Type::ELLIPSE: gfx.drawEllipse(p[0], p[1], p[2], p[3], node.brightness, node.fill); break;
+        case Type::TEXT:
+            gfx.setFont(node.font);
+            gfx.drawText(p[0], p[1], (const char*)node.data, node.brightness);
+            break;
+        case Type::BITMAP:
+            gfx.drawBitmap(p[0], p[1], (const uint8_t*)node.data, p[2], p[3], node.brightness);
+            break;
+        case Type::SPRITE:
+            if(p[4] < 0)
+                gfx.drawGrayscaleBitmap(p[0], p[1], (const uint8_t*)node.data, p[2], p[3]);
+            else
+                gfx.drawGrayscaleBitmap(p[0], p[1], (const uint8_t*)node.data, p[2], p[3], p[4]);
+            break;
+        case Type::CUSTOM:
+        {
+            // The viewport puts the node at 0, 0; the clip then narrows it
+            // to the part of the region the node covers.
+            IS31FL3731_Rect c = node.drawn;
+            c.x0 = c.x0 > region.x0 ? c.x0 : region.x0;
+            c.y0 = c.y0 > region.y0 ? c.y0 : region.y0;
+            c.x1 = c.x1 < region.x1 ? c.x1 : region.x1;
+            c.y1 = c.y1 < region.y1 ? c.y1 : region.y1;
+            gfx.setViewport(p[0], p[1], p[2], p[3]);
+            gfx.setClip(c.x0, c.y0, c.x1 - c.x0, c.y1 - c.y0);
+            node.draw(gfx, p, node.context);
+            gfx.resetClip();
+            gfx.setClip(region.x0, region.y0, region.x1 - region.x0, region.y1 - region.y0);
+            break;
+        }
+    }
+}
+
+IS31FL3731_Rect IS31FL3731_Scene::render(IS31FL3731_Graphics& gfx)
+{
+    IS31FL3731_Rect repainted;
+    repainted.clear();
+    if(!changed_)
+    {
+        return repainted;
+    }
+
+    // Each changed node damages where it was drawn and where it is now.
+    damage_count_ = 0;
+    if(full_)
+    {
+        addDamage(makeRect(0, 0, gfx.target()->width(), gfx.target()->height()));
+    }
+    for(uint8_t i = 0; i < node_count_; i++)
+    {
+        Node& node = nodes_[i];
+        if(!node.changed)
+        {
+            continue;
+        }
+
+        addDamage(node.drawn);
+        if(node.visible)
+            node.drawn = nodeBounds(node);
+        else
+            node.drawn.clear();
+        addDamage(node.drawn);
+        node.changed = false;
+    }
+
+    // Nodes only ever draw inside the region being repainted; one that
+    // merely overlaps it is clipped at its edge.
+    const IS31FL3731_Font* font = gfx.font();
+    for(uint8_t d = 0; d < damage_count_; d++)
+    {
+        IS31FL3731_Rect r = damage_[d];
+        r.clip(gfx.target()->width(), gfx.target()->height());
+        if(r.empty())
+            continue;
+
+        gfx.resetClip();
+        gfx.setClip(r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0);
+        gfx.fill(background_);
+        for(uint8_t i = 0; i < node_count_; i++)
+        {
+            if(nodes_[i].visible && intersects(nodes_[i].drawn, r))
+                drawNode(gfx, nodes_[i], r);
+        }
+        repainted.include(r);
+    }
+    gfx.resetClip();
+    gfx.setFont(font);
+
+    changed_ = false;
+    full_    = false;
+    return repainted;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#ifndef IS31FL3731_SCENE_H
+#define IS31FL3731_SCENE_H
+
+#include "IS31FL3731_Graphics.h"
+#include <stdint.h>
+
+#ifndef IS31FL3731_SCENE_MAX_NODES
+#define IS31FL3731_SCENE_MAX_NODES 16
+#endif
+
+// Separate regions render() keeps apart before merging the closest two.
+#ifndef IS31FL3731_SCENE_MAX_DAMAGE
+#define IS31FL3731_SCENE_MAX_DAMAGE 4
+#endif
+
+#define IS31FL3731_SCENE_MAX_PARAMS 5
+
+// Retained-mode display list on top of IS31FL3731_Graphics. Nodes keep
+// their geometry and know their bounds; changing a node damages where it
+// was and where it is now, and render() repaints only those regions, each
+// through a clip so nodes that merely overlap one are rasterized no
+// further than its edge. A scene with no changes costs nothing.
+class IS31FL3731_Scene
+{
+  public:
+    // Draws a custom node with the viewport set to its bounds, so at 0, 0.
+    typedef void (*DrawFn)(IS31FL3731_Graphics& gfx, const int16_t* params, void* context);
+
+    enum class Type : uint8_t
+    {
+        RECT,       // x, y, w, h
+        ROUND_RECT, // x, y, w, h, r
+        LINE,       // x1, y1, x2, y2
+        CIRCLE,     // x, y, radius
+        ELLIPSE,    // x, y, rx, ry
+        TEXT,       // x, y
+        BITMAP,     // x, y, w, h; 1-bit, clear bits transparent
+        SPRITE,     // x, y, w, h, transparent (-1 for none); 8-bit
+        CUSTOM,     // x, y, w, h, free
+    };
+
+    IS31FL3731_Scene();
+
+    // Nodes are drawn in the order they were added, later ones on top.
+    // Each returns the node index, or -1 when the scene is full. Text,
+    // bitmaps and custom contexts are referenced, not copied.
+    int8_t addRect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t brightness, bool fill = false);
+    int8_t addRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint8_t brightness, bool fill = false);
+    int8_t addLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t brightness);
+    int8_t addCircle(int16_t x, int16_t y, int16_t radius, uint8_t brightness, bool fill = false);
+    int8_t addEllipse(int16_t x, int16_t y, int16_t rx, int16_t ry, uint8_t brightness, bool fill = false);
+    int8_t addText(int16_t x, int16_t y, const char* text, uint8_t brightness, const IS31FL3731_Font* font = nullptr);
+    int8_t addBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h, uint8_t brightness);
+    int8_t addSprite(int16_t x, int16_t y, const uint8_t* pixels, int16_t w, int16_t h, int16_t transparent = -1);
+    int8_t addCustom(int16_t x, int16_t y, int16_t w, int16_t h, DrawFn draw, void* context = nullptr);
+
+    // Setters only damage the node when the value actually changes.
+    // Parameters are numbered as in the comments on Type.
+    void setParam(uint8_t node, uint8_t param, int16_t value);
+    // Moves x, y; a line keeps its length and direction.
+    void moveTo(uint8_t node, int16_t x, int16_t y);
+    void setBrightness(uint8_t node, uint8_t brightness);
+    void setVisible(uint8_t node, bool visible);
+    // Only for text nodes.
+    void setText(uint8_t node, const char* text);
+    // Text, bitmap or sprite pixels, which must match the node's size.
+    void setData(uint8_t node, const void* data);
+    // For content that changed behind the scene's back: a text buffer
+    // edited in place, or whatever a custom node draws.
+    void invalidate(uint8_t node);
+    // Repaints the whole target on the next render(), e.g. after something
+    // else drew over it.
+    void invalidateAll();
+
+    int16_t param(uint8_t node, uint8_t param) const;
+    bool    visible(uint8_t node) const { return node < node_count_ && nodes_[node].visible; }
+    // Where the node is now, whether or not it has been rendered there yet.
+    IS31FL3731_Rect bounds(uint8_t node) const;
+    bool            changed() const { return changed_; }
+
+    // Repaints the damaged regions of the graphics draw target: the
+    // background, then every visible node touching them, back to front.
+    // Draws in target coordinates and leaves the clip reset. Returns the
+    // region that was repainted, empty if nothing changed.
+    IS31FL3731_Rect render(IS31FL3731_Graphics& gfx);
+
+    void    setBackground(uint8_t brightness);
+    uint8_t background() const { return background_; }
+
+  private:
+    struct Node
+    {
+        Type                   type;
+        int16_t                params[IS31FL3731_SCENE_MAX_PARAMS];
+        uint8_t                brightness;
+        bool                   fill;
+        bool                   visible;
+        bool                   changed;
+        const void*            data;
+        const IS31FL3731_Font* font;
+        DrawFn                 draw;
+        void*                  context;
+        IS31FL3731_Rect        drawn; // bounds at the last render(), empty if hidden
+    };
+
+    Node            nodes_[IS31FL3731_SCENE_MAX_NODES];
+    uint8_t         node_count_;
+    bool            changed_;
+    bool            full_; // repaint the whole target
+    uint8_t         background_;
+    IS31FL3731_Rect damage_[IS31FL3731_SCENE_MAX_DAMAGE];
+    uint8_t         damage_count_;
+
+    int8_t add(Type type, const int16_t* params, uint8_t count, uint8_t brightness, bool fill);
+    void   touch(Node& node);
+    void   addDamage(IS31FL3731_Rect r);
+    void   drawNode(IS31FL3731_Graphics& gfx, const Node& node, const IS31FL3731_Rect& region) const;
+    IS31FL3731_Rect nodeBounds(const Node& node) const;
+};
+
+#endif
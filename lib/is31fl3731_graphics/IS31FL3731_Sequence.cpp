@@ -0,0 +1,283 @@
+#include "IS31FL3731_Sequence.h"
+
+uint32_t IS31FL3731_MemorySource::read(uint8_t* dst, uint32_t len)
+{
+    uint32_t left = size_ - pos_;
+    if(len > left)
+    {
+        len = left;
+    }
+    memcpy(dst, &data_[pos_], len);
+    pos_ += len;
+    return len;
+}
+
+bool IS31FL3731_MemorySource::seek(uint32_t offset)
+{
+    if(offset > size_)
+    {
+        return false;
+    }
+    pos_ = offset;
+    return true;
+}
+
+IS31FL3731_SequencePlayer::IS31FL3731_SequencePlayer()
+: width_(0),
+  height_(0),
+  frame_count_(0),
+  frame_(0),
+  due_ms_(0),
+  duration_(0),
+  payload_(0),
+  started_(false),
+  done_(true),
+  error_(false),
+  chunk_len_(0),
+  chunk_pos_(0)
+{
+    config_.Defaults();
+}
+
+bool IS31FL3731_SequencePlayer::Init(const Config& config)
+{
+    if(config.source == nullptr || config.canvas == nullptr)
+    {
+        return false;
+    }
+
+    config_    = config;
+    started_   = false;
+    done_      = true;
+    error_     = false;
+    chunk_len_ = 0;
+    chunk_pos_ = 0;
+
+    uint8_t header[IS31FL3731_SEQUENCE_HEADER_SIZE];
+    if(!config_.source->seek(0)
+       || config_.source->read(header, sizeof(header)) != sizeof(header))
+    {
+        return false;
+    }
+
+    if(header[0] != 'I' || header[1] != 'S' || header[2] != 'Q'
+       || header[3] != IS31FL3731_SEQUENCE_VERSION)
+    {
+        return false;
+    }
+
+    width_       = header[4];
+    height_      = header[5];
+    frame_count_ = header[6] | (header[7] << 8);
+
+    return frame_count_ > 0 && width_ == config_.canvas->width()
+           && height_ == config_.canvas->height()
+           && config_.canvas->format() == IS31FL3731_Canvas::Format::GRAY8;
+}
+
+void IS31FL3731_SequencePlayer::start(uint32_t now_ms)
+{
+    started_ = true;
+    done_    = false;
+    error_   = false;
+
+    uint16_t duration;
+    if(!rewind() || !decodeFrame(duration))
+    {
+        fail();
+        return;
+    }
+    duration_ = duration;
+    due_ms_   = now_ms + duration;
+}
+
+bool IS31FL3731_SequencePlayer::tick(uint32_t now_ms)
+{
+    if(!started_)
+    {
+        start(now_ms);
+        return !error_;
+    }
+
+    // Every frame is a delta, so a late tick still decodes each one in
+    // turn; the cap only stops zero-length sequences from spinning.
+    bool     changed = false;
+    uint16_t decoded = 0;
+    while(!done_ && (int32_t)(now_ms - due_ms_) >= 0)
+    {
+        if(decoded++ > frame_count_)
+        {
+            due_ms_ = now_ms + 1;
+            break;
+        }
+
+        if(frame_ == frame_count_)
+        {
+            if(!config_.loop)
+            {
+                done_ = true;
+                break;
+            }
+            if(!rewind())
+            {
+                fail();
+                return changed;
+            }
+        }
+
+        uint16_t duration;
+        if(!decodeFrame(duration))
+        {
+            fail();
+            return true;
+        }
+        duration_ = duration;
+        due_ms_ += duration;
+        changed = true;
+    }
+
+    return changed;
+}
+
+bool IS31FL3731_SequencePlayer::rewind()
+{
+    if(!config_.source->seek(IS31FL3731_SEQUENCE_HEADER_SIZE))
+    {
+        return false;
+    }
+    chunk_len_ = 0;
+    chunk_pos_ = 0;
+    frame_     = 0;
+
+    // The first frame is encoded against black, so clear what the last
+    // frame left lit and mark just those rows.
+    IS31FL3731_Canvas* canvas = config_.canvas;
+    uint8_t*           pixels = canvas->pixels();
+    for(int16_t y = 0; y < height_; y++)
+    {
+        uint8_t* row = &pixels[y * width_];
+        int16_t  x0  = 0;
+        int16_t  x1  = width_;
+        while(x0 < x1 && row[x0] == 0)
+            x0++;
+        while(x1 > x0 && row[x1 - 1] == 0)
+            x1--;
+        if(x0 == x1)
+            continue;
+
+        memset(&row[x0], 0, x1 - x0);
+        canvas->markDirty(x0, y, x1, y + 1);
+    }
+    return true;
+}
+
+bool IS31FL3731_SequencePlayer::decodeFrame(uint16_t& duration)
+{
+    uint16_t payload;
+    if(!readU16(duration) || !readU16(payload))
+    {
+        return false;
+    }
+    payload_ = payload;
+
+    IS31FL3731_Canvas* canvas = config_.canvas;
+    uint8_t*           pixels = canvas->pixels();
+    uint16_t           total  = width_ * height_;
+    uint16_t           pos    = 0;
+
+    while(payload_ > 0)
+    {
+        uint8_t op;
+        if(!readByte(op))
+        {
+            return false;
+        }
+
+        bool     literal = op & IS31FL3731_SEQUENCE_OP_LITERAL;
+        uint16_t count   = (op & (literal ? 0x7F : 0x3F)) + 1;
+        if(pos + count > total)
+        {
+            return false;
+        }
+
+        if(literal)
+        {
+            for(uint16_t i = 0; i < count; i++)
+            {
+                if(!readByte(pixels[pos + i]))
+                {
+                    return false;
+                }
+            }
+        }
+        else if(op & IS31FL3731_SEQUENCE_OP_RUN)
+        {
+            uint8_t value;
+            if(!readByte(value))
+            {
+                return false;
+            }
+            memset(&pixels[pos], value, count);
+        }
+        else
+        {
+            pos += count;
+            continue;
+        }
+
+        // Mark the span row by row so a change at the end of one row and
+        // the start of the next doesn't dirty both rows entirely.
+        uint16_t end = pos + count;
+        while(pos < end)
+        {
+            int16_t y  = pos / width_;
+            int16_t x0 = pos % width_;
+            int16_t x1 = end - y * width_ < width_ ? end - y * width_ : width_;
+            canvas->markDirty(x0, y, x1, y + 1);
+            pos = y * width_ + x1;
+        }
+    }
+
+    frame_++;
+    return true;
+}
+
+bool IS31FL3731_SequencePlayer::readByte(uint8_t& b)
+{
+    if(payload_ == 0)
+    {
+        return false;
+    }
+    if(chunk_pos_ == chunk_len_)
+    {
+        chunk_len_ = config_.source->read(chunk_, sizeof(chunk_));
+        chunk_pos_ = 0;
+        if(chunk_len_ == 0)
+        {
+            return false;
+        }
+    }
+    b = chunk_[chunk_pos_++];
+    payload_--;
+    return true;
+}
+
+bool IS31FL3731_SequencePlayer::readU16(uint16_t& v)
+{
+    // Frame headers sit outside the payload count.
+    uint8_t lo;
+    uint8_t hi;
+    payload_ = 2;
+    if(!readByte(lo) || !readByte(hi))
+    {
+        return false;
+    }
+    v = lo | (hi << 8);
+    return true;
+}
+
+void IS31FL3731_SequencePlayer::fail()
+{
+    error_ = true;
+    done_  = true;
+}
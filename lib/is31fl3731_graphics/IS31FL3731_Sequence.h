@@ -0,0 +1,128 @@
+#pragma once
+
+#ifndef IS31FL3731_SEQUENCE_H
+#define IS31FL3731_SEQUENCE_H
+
+#include "IS31FL3731_Canvas.h"
+#include <stdint.h>
+
+// Compressed frame sequence, little-endian:
+//
+//   header  "ISQ" version(1) width(1) height(1) frame_count(2)
+//   frame   duration_ms(2) payload_len(2) payload
+//
+// A payload walks the frame in row-major pixel order as a delta against the
+// previous frame (all zeros before the first one):
+//
+//   0x00-0x3F  skip n+1 unchanged pixels
+//   0x40-0x7F  n+1 pixels of the value in the next byte
+//   0x80-0xFF  n+1 literal pixel values follow
+//
+// Unchanged pixels at the end of a frame are not encoded.
+#define IS31FL3731_SEQUENCE_VERSION 1
+#define IS31FL3731_SEQUENCE_HEADER_SIZE 8
+#define IS31FL3731_SEQUENCE_FRAME_HEADER_SIZE 4
+
+#define IS31FL3731_SEQUENCE_OP_SKIP 0x00
+#define IS31FL3731_SEQUENCE_OP_RUN 0x40
+#define IS31FL3731_SEQUENCE_OP_LITERAL 0x80
+#define IS31FL3731_SEQUENCE_MAX_SKIP 64
+#define IS31FL3731_SEQUENCE_MAX_RUN 64
+#define IS31FL3731_SEQUENCE_MAX_LITERAL 128
+
+#ifndef IS31FL3731_SEQUENCE_READ_CHUNK
+#define IS31FL3731_SEQUENCE_READ_CHUNK 32
+#endif
+
+// Byte stream the player pulls from. Implement this for SD card files;
+// IS31FL3731_MemorySource covers sequences linked into flash.
+class IS31FL3731_SequenceSource
+{
+  public:
+    virtual ~IS31FL3731_SequenceSource() {}
+
+    // Returns the number of bytes read, less than len only at the end.
+    virtual uint32_t read(uint8_t* dst, uint32_t len) = 0;
+    virtual bool     seek(uint32_t offset)            = 0;
+};
+
+class IS31FL3731_MemorySource : public IS31FL3731_SequenceSource
+{
+  public:
+    IS31FL3731_MemorySource(const uint8_t* data = nullptr, uint32_t size = 0)
+    : data_(data), size_(size), pos_(0)
+    {
+    }
+
+    uint32_t read(uint8_t* dst, uint32_t len) override;
+    bool     seek(uint32_t offset) override;
+
+  private:
+    const uint8_t* data_;
+    uint32_t       size_;
+    uint32_t       pos_;
+};
+
+// Decodes a sequence straight into a canvas (usually display.target()),
+// marking only the pixels each frame changed. No heap; the only buffer is
+// a READ_CHUNK-byte window onto the source.
+class IS31FL3731_SequencePlayer
+{
+  public:
+    struct Config
+    {
+        IS31FL3731_SequenceSource* source;
+        IS31FL3731_Canvas*         canvas; // 8-bit, same size as the sequence
+        bool                       loop;
+
+        void Defaults()
+        {
+            source = nullptr;
+            canvas = nullptr;
+            loop   = true;
+        }
+    };
+
+    IS31FL3731_SequencePlayer();
+
+    // Reads and checks the header.
+    bool Init(const Config& config);
+
+    void start(uint32_t now_ms);
+
+    // Decodes every frame that came due since the last call. Returns true
+    // if the canvas changed. A malformed frame stops playback.
+    bool tick(uint32_t now_ms);
+
+    bool     done() const { return done_; }
+    bool     error() const { return error_; }
+    uint16_t frame() const { return frame_; }
+    uint16_t duration() const { return duration_; } // of the frame on show
+    uint16_t frameCount() const { return frame_count_; }
+    uint8_t  width() const { return width_; }
+    uint8_t  height() const { return height_; }
+
+  private:
+    bool rewind();
+    bool decodeFrame(uint16_t& duration);
+    bool readByte(uint8_t& b);
+    bool readU16(uint16_t& v);
+    void fail();
+
+    Config   config_;
+    uint8_t  width_;
+    uint8_t  height_;
+    uint16_t frame_count_;
+    uint16_t frame_;    // next frame to decode
+    uint32_t due_ms_;   // when the next frame is shown
+    uint16_t duration_;
+    uint32_t payload_;  // payload bytes left in the current frame
+    bool     started_;
+    bool     done_;
+    bool     error_;
+    uint8_t  chunk_[IS31FL3731_SEQUENCE_READ_CHUNK];
+    uint8_t  chunk_len_;
+    uint8_t  chunk_pos_;
+};
+
+#endif
@@ -0,0 +1,290 @@
+#include "IS31FL3731_Spectrum.h"
+#include <math.h>
+#include <string.h>
+
+static_assert(IS31FL3731_SPECTRUM_FFT_SIZE <= 256, "twiddles come from the 256-entry sine table");
+static_assert((1 << IS31FL3731_SPECTRUM_FFT_BITS) == IS31FL3731_SPECTRUM_FFT_SIZE, "FFT size and bits disagree");
+
+struct HannGen
+{
+    constexpr q15_t operator()(uint16_t i) const
+    {
+        return is31fl3731_math::toQ15(
+            0.5 - 0.5 * is31fl3731_math::sin(2 * is31fl3731_math::PI * i / IS31FL3731_SPECTRUM_FFT_SIZE + is31fl3731_math::PI / 2));
+    }
+};
+
+static constexpr IS31FL3731_Table<IS31FL3731_SPECTRUM_FFT_SIZE, q15_t> HANN_TABLE{HannGen()};
+
+// log2 in Q8, linear between powers of two (within 0.09 of exact).
+static int32_t log2Q8(uint64_t x)
+{
+    if(x == 0)
+        return 0;
+
+    int32_t msb = 63 - __builtin_clzll(x);
+    uint32_t frac = msb >= 8 ? (uint32_t)(x >> (msb - 8)) & 0xFF : (uint32_t)(x << (8 - msb)) & 0xFF;
+    return (msb << 8) + frac;
+}
+
+IS31FL3731_Spectrum::IS31FL3731_Spectrum()
+: dropped_(0), vu_level_(0), last_render_ms_(0), rendered_(false)
+{
+    config_.Defaults();
+    memset(level_, 0, sizeof(level_));
+    memset(bar_, 0, sizeof(bar_));
+    memset(peak_, 0, sizeof(peak_));
+    memset(peak_time_, 0, sizeof(peak_time_));
+}
+
+bool IS31FL3731_Spectrum::Init(const Config& config)
+{
+    if(config.bands == 0 || config.bands > IS31FL3731_SPECTRUM_MAX_BANDS || config.sample_rate == 0
+       || config.min_hz == 0 || config.max_hz <= config.min_hz || config.range_db == 0)
+    {
+        return false;
+    }
+
+    config_ = config;
+
+    // Log-spaced band edges, each band at least one bin wide. Runs once,
+    // so floating point is fine here.
+    const float bin_hz = (float)config_.sample_rate / IS31FL3731_SPECTRUM_FFT_SIZE;
+    const float ratio  = (float)config_.max_hz / config_.min_hz;
+    uint16_t    last   = 0;
+    for(uint8_t b = 0; b <= config_.bands; b++)
+    {
+        float    hz  = config_.min_hz * powf(ratio, (float)b / config_.bands);
+        uint16_t bin = (uint16_t)(hz / bin_hz + 0.5f);
+        if(bin < 1)
+            bin = 1;
+        if(b > 0 && bin <= last)
+            bin = last + 1;
+        if(bin > IS31FL3731_SPECTRUM_FFT_SIZE / 2)
+            bin = IS31FL3731_SPECTRUM_FFT_SIZE / 2;
+        band_edge_[b] = bin;
+        last          = bin;
+    }
+
+    memset(level_, 0, sizeof(level_));
+    memset(bar_, 0, sizeof(bar_));
+    memset(peak_, 0, sizeof(peak_));
+    vu_level_ = 0;
+    rendered_ = false;
+
+    return true;
+}
+
+uint32_t IS31FL3731_Spectrum::pushAudio(const float* samples, uint32_t count)
+{
+    int16_t  block[64];
+    uint32_t accepted = 0;
+
+    while(count > 0)
+    {
+        uint32_t n = count < 64 ? count : 64;
+        for(uint32_t i = 0; i < n; i++)
+        {
+            float s = samples[i];
+            if(s > 1.0f)
+                s = 1.0f;
+            if(s < -1.0f)
+                s = -1.0f;
+            block[i] = (int16_t)(s * IS31FL3731_Q15_ONE);
+        }
+
+        uint32_t pushed = ring_.push(block, n);
+        accepted += pushed;
+        if(pushed < n)
+        {
+            dropped_.fetch_add(count - pushed, std::memory_order_relaxed);
+            break;
+        }
+        samples += n;
+        count -= n;
+    }
+
+    return accepted;
+}
+
+uint32_t IS31FL3731_Spectrum::pushAudio(const int16_t* samples, uint32_t count)
+{
+    uint32_t pushed = ring_.push(samples, count);
+    if(pushed < count)
+    {
+        dropped_.fetch_add(count - pushed, std::memory_order_relaxed);
+    }
+    return pushed;
+}
+
+void IS31FL3731_Spectrum::fft()
+{
+    const uint16_t n = IS31FL3731_SPECTRUM_FFT_SIZE;
+
+    for(uint16_t i = 1, j = 0; i < n; i++)
+    {
+        uint16_t bit = n >> 1;
+        for(; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if(i < j)
+        {
+            int16_t t = re_[i];
+            re_[i]    = re_[j];
+            re_[j]    = t;
+        }
+    }
+
+    // Radix-2, halving every stage so Q15 never overflows; the result is
+    // scaled by 1 / n.
+    for(uint16_t len = 2; len <= n; len <<= 1)
+    {
+        uint16_t half   = len >> 1;
+        uint16_t stride = 256 / len;
+
+        for(uint16_t i = 0; i < n; i += len)
+        {
+            for(uint16_t j = 0; j < half; j++)
+            {
+                uint8_t idx = j * stride;
+                int32_t wr  = IS31FL3731_SINE_TABLE[(uint8_t)(idx + 64)];
+                int32_t wi  = -IS31FL3731_SINE_TABLE[idx];
+
+                uint16_t a  = i + j;
+                uint16_t b  = a + half;
+                int32_t  tr = (wr * re_[b] - wi * im_[b]) >> 15;
+                int32_t  ti = (wr * im_[b] + wi * re_[b]) >> 15;
+
+                re_[b] = (int16_t)((re_[a] - tr) >> 1);
+                im_[b] = (int16_t)((im_[a] - ti) >> 1);
+                re_[a] = (int16_t)((re_[a] + tr) >> 1);
+                im_[a] = (int16_t)((im_[a] + ti) >> 1);
+            }
+        }
+    }
+}
+
+q15_t IS31FL3731_Spectrum::toLevel(uint64_t energy) const
+{
+    // A full-scale sine lands around 2^26 in its bin, which is 0 dB.
+    // dB = 10 log10(E) = 3.0103 * log2(E); 3.0103 is 771 in Q8.
+    int32_t db_q8 = ((log2Q8(energy) - (26 << 8)) * 771) >> 8;
+    int32_t range = (int32_t)config_.range_db << 8;
+    int32_t level = db_q8 + range;
+
+    if(energy == 0 || level <= 0)
+        return 0;
+    if(level >= range)
+        return IS31FL3731_Q15_ONE;
+    return (q15_t)((level * IS31FL3731_Q15_ONE) / range);
+}
+
+bool IS31FL3731_Spectrum::process()
+{
+    const uint16_t n     = IS31FL3731_SPECTRUM_FFT_SIZE;
+    uint32_t       avail = ring_.available();
+    if(avail < n)
+    {
+        return false;
+    }
+
+    // Only the newest block matters for the display; older ones are
+    // skipped rather than analyzed late.
+    ring_.skip(avail - n);
+    ring_.pop(re_, n);
+
+    uint64_t sum_sq = 0;
+    for(uint16_t i = 0; i < n; i++)
+    {
+        int32_t s = re_[i];
+        sum_sq += s * s;
+        re_[i] = (int16_t)((s * HANN_TABLE[i]) >> 15);
+        im_[i] = 0;
+    }
+
+    // Full-scale sine RMS squared is 2^29; shift so toLevel() sees the
+    // same 0 dB point.
+    vu_level_ = toLevel((sum_sq / n) >> 3);
+
+    fft();
+
+    for(uint8_t b = 0; b < config_.bands; b++)
+    {
+        uint64_t energy = 0;
+        for(uint16_t k = band_edge_[b]; k < band_edge_[b + 1]; k++)
+        {
+            energy += (int32_t)re_[k] * re_[k] + (int32_t)im_[k] * im_[k];
+        }
+        // Bands get wider towards the top; averaging keeps them comparable.
+        uint16_t bins = band_edge_[b + 1] - band_edge_[b];
+        level_[b]     = toLevel(bins > 1 ? energy / bins : energy);
+    }
+
+    return true;
+}
+
+void IS31FL3731_Spectrum::fall(uint8_t i, q15_t target, uint32_t now_ms, int32_t drop)
+{
+    bar_[i] = bar_[i] - drop > target ? bar_[i] - drop : target;
+
+    if(target >= peak_[i])
+    {
+        peak_[i]      = target;
+        peak_time_[i] = now_ms;
+    }
+    else if(now_ms - peak_time_[i] > config_.peak_hold_ms)
+    {
+        peak_[i] = peak_[i] - drop > target ? peak_[i] - drop : target;
+    }
+}
+
+void IS31FL3731_Spectrum::render(IS31FL3731_Canvas* canvas, uint32_t now_ms)
+{
+    if(canvas->format() != IS31FL3731_Canvas::Format::GRAY8)
+        return;
+
+    uint8_t* pixels = canvas->pixels();
+    int16_t  w      = canvas->width();
+    int16_t  h      = canvas->height();
+
+    uint32_t elapsed = rendered_ ? now_ms - last_render_ms_ : 0;
+    last_render_ms_  = now_ms;
+    rendered_        = true;
+
+    // fall_per_s is in sixteenths of the full height per second.
+    int32_t drop = (int32_t)(((uint64_t)config_.fall_per_s * 2048 * elapsed) / 1000);
+
+    memset(pixels, 0, w * h);
+
+    if(config_.mode == Mode::VU)
+    {
+        const uint8_t vu = IS31FL3731_SPECTRUM_MAX_BANDS;
+        fall(vu, vu_level_, now_ms, drop);
+
+        int16_t len  = (bar_[vu] * w + 16384) >> 15;
+        int16_t peak = (peak_[vu] * w + 16384) >> 15;
+        for(int16_t y = 0; y < h; y++)
+        {
+            memset(&pixels[y * w], config_.brightness, len);
+            if(peak > 0)
+                pixels[peak - 1 + y * w] = config_.peak_brightness;
+        }
+    }
+    else
+    {
+        int16_t columns = config_.bands < w ? config_.bands : w;
+        for(int16_t x = 0; x < columns; x++)
+        {
+            fall(x, level_[x], now_ms, drop);
+
+            int16_t rows = (bar_[x] * h + 16384) >> 15;
+            int16_t peak = (peak_[x] * h + 16384) >> 15;
+            for(int16_t r = 0; r < rows; r++)
+                pixels[x + (h - 1 - r) * w] = config_.brightness;
+            if(peak > 0)
+                pixels[x + (h - peak) * w] = config_.peak_brightness;
+        }
+    }
+
+    canvas->markAllDirty();
+}
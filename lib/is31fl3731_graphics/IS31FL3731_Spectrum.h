@@ -0,0 +1,104 @@
+#pragma once
+
+#ifndef IS31FL3731_SPECTRUM_H
+#define IS31FL3731_SPECTRUM_H
+
+#include "IS31FL3731_Canvas.h"
+#include "IS31FL3731_FixedMath.h"
+#include "IS31FL3731_SpscRing.h"
+#include <atomic>
+#include <stdint.h>
+
+#define IS31FL3731_SPECTRUM_FFT_SIZE 256
+#define IS31FL3731_SPECTRUM_FFT_BITS 8
+#define IS31FL3731_SPECTRUM_MAX_BANDS 32
+
+#ifndef IS31FL3731_SPECTRUM_RING_SIZE
+#define IS31FL3731_SPECTRUM_RING_SIZE 1024
+#endif
+
+// Spectrum analyzer / VU meter. The audio callback hands blocks over with
+// pushAudio(), which only copies into a lock-free ring. process() in the
+// main loop runs a Q15 FFT on the newest complete block and render() draws
+// bars with peak hold into a canvas.
+class IS31FL3731_Spectrum
+{
+  public:
+    enum class Mode
+    {
+        SPECTRUM, // one bar per column, log-spaced bands
+        VU,       // horizontal level meter on every row
+    };
+
+    struct Config
+    {
+        uint32_t sample_rate;
+        uint16_t min_hz;
+        uint16_t max_hz;
+        uint8_t  bands;          // usually the canvas width
+        uint8_t  range_db;       // level range mapped onto the bar height
+        uint16_t peak_hold_ms;
+        uint16_t fall_per_s;     // bar and peak fall speed, in full heights / 16 per second
+        uint8_t  brightness;
+        uint8_t  peak_brightness;
+        Mode     mode;
+
+        void Defaults()
+        {
+            sample_rate     = 48000;
+            min_hz          = 60;
+            max_hz          = 16000;
+            bands           = 16;
+            range_db        = 48;
+            peak_hold_ms    = 400;
+            fall_per_s      = 24;
+            brightness      = 120;
+            peak_brightness = 255;
+            mode            = Mode::SPECTRUM;
+        }
+    };
+
+    IS31FL3731_Spectrum();
+
+    bool Init(const Config& config);
+
+    // Audio context. Safe to call from the audio callback; never blocks.
+    // Returns the number of samples accepted.
+    uint32_t pushAudio(const float* samples, uint32_t count);
+    uint32_t pushAudio(const int16_t* samples, uint32_t count);
+
+    // Main loop. Returns true when a new analysis is ready.
+    bool process();
+
+    // Needs an 8-bit canvas.
+    void render(IS31FL3731_Canvas* canvas, uint32_t now_ms);
+
+    // Band level in Q15, 0 is the bottom of the range and 32767 the top.
+    q15_t    band(uint8_t i) const { return i < config_.bands ? level_[i] : 0; }
+    q15_t    vuLevel() const { return vu_level_; }
+    uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  private:
+    Config config_;
+
+    IS31FL3731_SpscRing<int16_t, IS31FL3731_SPECTRUM_RING_SIZE> ring_;
+    std::atomic<uint32_t> dropped_;
+
+    int16_t  re_[IS31FL3731_SPECTRUM_FFT_SIZE];
+    int16_t  im_[IS31FL3731_SPECTRUM_FFT_SIZE];
+    uint16_t band_edge_[IS31FL3731_SPECTRUM_MAX_BANDS + 1];
+    q15_t    level_[IS31FL3731_SPECTRUM_MAX_BANDS];
+    q15_t    vu_level_;
+
+    int32_t  bar_[IS31FL3731_SPECTRUM_MAX_BANDS + 1];  // displayed, Q15
+    int32_t  peak_[IS31FL3731_SPECTRUM_MAX_BANDS + 1]; // Q15
+    uint32_t peak_time_[IS31FL3731_SPECTRUM_MAX_BANDS + 1];
+    uint32_t last_render_ms_;
+    bool     rendered_;
+
+    void  fft();
+    q15_t toLevel(uint64_t energy) const;
+    void  fall(uint8_t i, q15_t target, uint32_t now_ms, int32_t drop);
+};
+
+#endif
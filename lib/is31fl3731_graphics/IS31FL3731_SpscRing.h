@@ -0,0 +1,77 @@
+#pragma once
+
+#ifndef IS31FL3731_SPSCRING_H
+#define IS31FL3731_SPSCRING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Lock-free single-producer/single-consumer ring. One context (e.g. the
+// audio callback) only pushes, another (the main loop) only pops.
+// N must be a power of two.
+template <typename T, uint32_t N>
+class IS31FL3731_SpscRing
+{
+    static_assert((N & (N - 1)) == 0, "ring size must be a power of two");
+
+  public:
+    IS31FL3731_SpscRing() : head_(0), tail_(0) {}
+
+    // Producer side. Returns how many items fit; the rest are dropped.
+    uint32_t push(const T* items, uint32_t count)
+    {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        uint32_t free = N - (head - tail);
+        if(count > free)
+            count = free;
+
+        for(uint32_t i = 0; i < count; i++)
+            buffer_[(head + i) & (N - 1)] = items[i];
+
+        head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer side. Returns how many items were copied out.
+    uint32_t pop(T* items, uint32_t count)
+    {
+        uint32_t tail  = tail_.load(std::memory_order_relaxed);
+        uint32_t head  = head_.load(std::memory_order_acquire);
+        uint32_t avail = head - tail;
+        if(count > avail)
+            count = avail;
+
+        for(uint32_t i = 0; i < count; i++)
+            items[i] = buffer_[(tail + i) & (N - 1)];
+
+        tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer side. Discards items without copying them.
+    uint32_t skip(uint32_t count)
+    {
+        uint32_t tail  = tail_.load(std::memory_order_relaxed);
+        uint32_t avail = head_.load(std::memory_order_acquire) - tail;
+        if(count > avail)
+            count = avail;
+        tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    uint32_t available() const
+    {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    static constexpr uint32_t capacity() { return N; }
+
+  private:
+    T                     buffer_[N];
+    std::atomic<uint32_t> head_;
+    std::atomic<uint32_t> tail_;
+};
+
+#endif
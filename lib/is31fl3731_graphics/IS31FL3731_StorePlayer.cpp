@@ -0,0 +1,105 @@
+#include "IS31FL3731_StorePlayer.h"
+
+IS31FL3731_StorePlayer::IS31FL3731_StorePlayer()
+: frame_(0), due_ms_(0), back_(0), started_(false), done_(true), pending_(false)
+{
+    config_.Defaults();
+}
+
+bool IS31FL3731_StorePlayer::Init(const Config& config)
+{
+    if(config.store == nullptr || config.driver == nullptr
+       || config.store->frameCount() == 0)
+    {
+        return false;
+    }
+    if(config.bank + (config.double_buffer ? 1 : 0) > 7)
+    {
+        return false;
+    }
+
+    config_  = config;
+    started_ = false;
+    done_    = false;
+    pending_ = false;
+    return true;
+}
+
+void IS31FL3731_StorePlayer::start(uint32_t now_ms)
+{
+    started_ = true;
+    done_    = false;
+    back_    = 0;
+    frame_   = 0;
+    show(0);
+    due_ms_ = now_ms + config_.store->duration(0);
+}
+
+bool IS31FL3731_StorePlayer::tick(uint32_t now_ms)
+{
+    if(!started_)
+    {
+        start(now_ms);
+        return !pending_;
+    }
+
+    // A frame whose burst failed is sent again until it goes through or
+    // the next one is due.
+    if(done_ || (int32_t)(now_ms - due_ms_) < 0)
+    {
+        return pending_ && show(frame_);
+    }
+
+    // Walk the durations to the frame that is due now; only that one is
+    // sent. A lap's worth of zero durations can't advance time, so stop.
+    IS31FL3731_AnimationStore* store = config_.store;
+    uint16_t                   next  = frame_;
+    uint16_t                   steps = 0;
+    while((int32_t)(now_ms - due_ms_) >= 0)
+    {
+        if(++next == store->frameCount())
+        {
+            if(!config_.loop)
+            {
+                done_ = true;
+                return false;
+            }
+            next = 0;
+        }
+        due_ms_ += store->duration(next);
+
+        if(++steps > store->frameCount())
+        {
+            due_ms_ = now_ms + 1;
+            break;
+        }
+    }
+
+    frame_ = next;
+    return show(frame_);
+}
+
+// With double buffering the banks only swap once the back one is written
+// and shown, so a failed frame is retried into the same bank.
+bool IS31FL3731_StorePlayer::show(uint16_t frame)
+{
+    uint8_t bank = config_.bank;
+    if(config_.double_buffer)
+    {
+        bank += back_;
+    }
+
+    bool ok = config_.driver->writePWMBurst(
+        config_.store->burst(frame), IS31FL3731_STORE_FRAME_PIXELS, bank);
+
+    if(ok && config_.double_buffer)
+    {
+        ok = config_.driver->displayFrame(bank);
+        if(ok)
+        {
+            back_ ^= 1;
+        }
+    }
+    pending_ = !ok;
+    return ok;
+}
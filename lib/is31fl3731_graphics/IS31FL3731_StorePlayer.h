@@ -0,0 +1,62 @@
+#pragma once
+
+#ifndef IS31FL3731_STOREPLAYER_H
+#define IS31FL3731_STOREPLAYER_H
+
+#include "../is31fl3731/is31fl3731.h"
+#include "IS31FL3731_AnimationStore.h"
+#include <stdint.h>
+
+// Plays an IS31FL3731_AnimationStore by handing each frame's burst straight
+// from flash to the driver. This writes PWM registers directly and bypasses
+// IS31FL3731_Graphics, so don't draw into the same bank while it plays.
+class IS31FL3731_StorePlayer
+{
+  public:
+    struct Config
+    {
+        IS31FL3731_AnimationStore* store;
+        IS31FL3731*                driver;
+        uint8_t                    bank;
+        // Alternate between bank and bank + 1 and switch with
+        // displayFrame(), so a frame is never seen half written.
+        bool double_buffer;
+        bool loop;
+
+        void Defaults()
+        {
+            store         = nullptr;
+            driver        = nullptr;
+            bank          = 0;
+            double_buffer = false;
+            loop          = true;
+        }
+    };
+
+    IS31FL3731_StorePlayer();
+
+    bool Init(const Config& config);
+
+    void start(uint32_t now_ms);
+
+    // Shows the frame that is due. Frames are independent, so a late tick
+    // skips straight to the current one. Returns true if it sent a frame;
+    // one that failed on the bus is sent again by the following ticks.
+    bool tick(uint32_t now_ms);
+
+    bool     done() const { return done_; }
+    uint16_t frame() const { return frame_; }
+
+  private:
+    bool show(uint16_t frame);
+
+    Config   config_;
+    uint16_t frame_;
+    uint32_t due_ms_;
+    uint8_t  back_;
+    bool     started_;
+    bool     done_;
+    bool     pending_; // the last frame did not reach the chip
+};
+
+#endif
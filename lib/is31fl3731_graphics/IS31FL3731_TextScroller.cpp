@@ -0,0 +1,120 @@
+#include "IS31FL3731_TextScroller.h"
+
+IS31FL3731_TextScroller::IS31FL3731_TextScroller()
+: text_width_(0), position_(0), last_step_ms_(0), started_(false)
+{
+    config_.Defaults();
+}
+
+bool IS31FL3731_TextScroller::Init(const Config& config)
+{
+    if(config.gfx == nullptr || config.strip == nullptr)
+    {
+        return false;
+    }
+
+    config_ = config;
+    if(config_.width <= 0)
+    {
+        config_.width = config_.gfx->width() - config_.x;
+    }
+    if(config_.step_ms == 0)
+    {
+        config_.step_ms = 1;
+    }
+
+    text_width_ = 0;
+    reset();
+
+    return true;
+}
+
+bool IS31FL3731_TextScroller::setText(const char* text)
+{
+    IS31FL3731_Graphics*           gfx         = config_.gfx;
+    IS31FL3731_Canvas*             prev_target = gfx->target();
+    const IS31FL3731_Font*         prev_font   = gfx->font();
+    IS31FL3731_Graphics::ClipState prev_clip   = gfx->saveClip();
+
+    // The clip and origin carry over to the strip, so render it with the
+    // whole strip in view and put back whatever the caller had set.
+    gfx->setTarget(config_.strip);
+    gfx->resetClip();
+    gfx->setFont(config_.font);
+    gfx->clear();
+    int16_t end = gfx->drawText(0, 0, text, config_.brightness);
+    gfx->setFont(prev_font);
+    gfx->setTarget(prev_target);
+    gfx->restoreClip(prev_clip);
+
+    text_width_ = gfx->textWidth(text);
+    bool fits   = end <= config_.strip->width();
+    if(!fits)
+    {
+        text_width_ = config_.strip->width();
+    }
+
+    reset();
+    return fits;
+}
+
+void IS31FL3731_TextScroller::reset()
+{
+    position_ = -config_.width;
+    started_  = false;
+}
+
+bool IS31FL3731_TextScroller::tick(uint32_t now_ms)
+{
+    if(!started_)
+    {
+        started_      = true;
+        last_step_ms_ = now_ms;
+        draw();
+        return true;
+    }
+
+    if(done() || now_ms - last_step_ms_ < config_.step_ms)
+    {
+        return false;
+    }
+
+    // Step in whole intervals so slow frames don't make the text drift.
+    uint32_t steps = (now_ms - last_step_ms_) / config_.step_ms;
+    last_step_ms_ += steps * config_.step_ms;
+    position_ += steps;
+
+    if(position_ >= text_width_ && config_.loop)
+    {
+        int16_t period = text_width_ + config_.width;
+        position_      = (position_ + config_.width) % period - config_.width;
+    }
+
+    draw();
+    return true;
+}
+
+void IS31FL3731_TextScroller::draw()
+{
+    IS31FL3731_Graphics* gfx = config_.gfx;
+    int16_t              h   = config_.strip->height();
+
+    gfx->fillRect(config_.x, config_.y, config_.width, h, 0);
+
+    // Negative positions mean the text is still entering from the right.
+    int16_t dst_x = config_.x;
+    int16_t src_x = position_;
+    int16_t w     = config_.width;
+    if(src_x < 0)
+    {
+        dst_x -= src_x;
+        w += src_x;
+        src_x = 0;
+    }
+    if(src_x + w > text_width_)
+    {
+        w = text_width_ - src_x;
+    }
+
+    gfx->drawCanvas(dst_x, config_.y, config_.strip, src_x, 0, w, h);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#ifndef IS31FL3731_TEXTSCROLLER_H
+#define IS31FL3731_TEXTSCROLLER_H
+
+#include "IS31FL3731_Graphics.h"
+#include <stdint.h>
+
+// Marquee that rasterizes its text once into an off-screen strip and then
+// only copies a moving window of that strip into the draw target.
+class IS31FL3731_TextScroller
+{
+  public:
+    struct Config
+    {
+        IS31FL3731_Graphics*   gfx;
+        IS31FL3731_Canvas*     strip; // must be at least as tall as the font
+        const IS31FL3731_Font* font;
+        int16_t                x;
+        int16_t                y;
+        int16_t                width; // viewport width, 0 for the display width
+        uint8_t                brightness;
+        uint16_t               step_ms;
+        bool                   loop;
+
+        void Defaults()
+        {
+            gfx        = nullptr;
+            strip      = nullptr;
+            font       = nullptr;
+            x          = 0;
+            y          = 0;
+            width      = 0;
+            brightness = 255;
+            step_ms    = 60;
+            loop       = true;
+        }
+    };
+
+    IS31FL3731_TextScroller();
+
+    bool Init(const Config& config);
+
+    // Renders text into the strip. Returns false if it had to be truncated.
+    bool setText(const char* text);
+    void reset();
+
+    // Advances by one column per step_ms and redraws the window when the
+    // position changed. Returns true if it drew.
+    bool tick(uint32_t now_ms);
+    void draw();
+
+    bool    done() const { return !config_.loop && position_ >= text_width_; }
+    int16_t position() const { return position_; }
+    int16_t textWidth() const { return text_width_; }
+
+  private:
+    Config   config_;
+    int16_t  text_width_;
+    int16_t  position_;
+    uint32_t last_step_ms_;
+    bool     started_;
+};
+
+#endif
@@ -0,0 +1,271 @@
+#include "IS31FL3731_Timeline.h"
+
+struct EaseInGen
+{
+    constexpr q15_t operator()(uint16_t i) const
+    {
+        return is31fl3731_math::toQ15((i / 256.0) * (i / 256.0));
+    }
+};
+
+struct EaseOutGen
+{
+    constexpr q15_t operator()(uint16_t i) const
+    {
+        return is31fl3731_math::toQ15(1 - (1 - i / 256.0) * (1 - i / 256.0));
+    }
+};
+
+struct EaseInOutGen
+{
+    constexpr q15_t operator()(uint16_t i) const
+    {
+        return is31fl3731_math::toQ15(i < 128 ? 4 * (i / 256.0) * (i / 256.0) * (i / 256.0)
+                                              : 1 - 4 * (1 - i / 256.0) * (1 - i / 256.0) * (1 - i / 256.0));
+    }
+};
+
+struct EaseSineGen
+{
+    constexpr q15_t operator()(uint16_t i) const
+    {
+        return is31fl3731_math::toQ15(
+            0.5 - 0.5 * is31fl3731_math::sin(is31fl3731_math::PI * (i / 256.0 + 0.5)));
+    }
+};
+
+static constexpr IS31FL3731_Table<256, q15_t> EASE_IN_TABLE{EaseInGen()};
+static constexpr IS31FL3731_Table<256, q15_t> EASE_OUT_TABLE{EaseOutGen()};
+static constexpr IS31FL3731_Table<256, q15_t> EASE_IN_OUT_TABLE{EaseInOutGen()};
+static constexpr IS31FL3731_Table<256, q15_t> EASE_SINE_TABLE{EaseSineGen()};
+
+static q15_t lookupEase(const IS31FL3731_Table<256, q15_t>& table, uint16_t progress)
+{
+    uint8_t index = progress >> 8;
+    int32_t a     = table[index];
+    int32_t b     = index < 255 ? table[index + 1] : IS31FL3731_Q15_ONE;
+    return (q15_t)(a + (((b - a) * (progress & 0xFF)) >> 8));
+}
+
+q15_t IS31FL3731_ease(IS31FL3731_Easing easing, uint16_t progress)
+{
+    switch(easing)
+    {
+        case IS31FL3731_Easing::EASE_IN: return lookupEase(EASE_IN_TABLE, progress);
+        case IS31FL3731_Easing::EASE_OUT: return lookupEase(EASE_OUT_TABLE, progress);
+        case IS31FL3731_Easing::EASE_IN_OUT: return lookupEase(EASE_IN_OUT_TABLE, progress);
+        case IS31FL3731_Easing::SINE: return lookupEase(EASE_SINE_TABLE, progress);
+        case IS31FL3731_Easing::STEP: return progress == 0xFFFF ? IS31FL3731_Q15_ONE : 0;
+        default: return progress >> 1;
+    }
+}
+
+IS31FL3731_Timeline::IS31FL3731_Timeline()
+: track_count_(0), element_count_(0), start_ms_(0), background_(0)
+{
+}
+
+int8_t IS31FL3731_Timeline::addTrack(const IS31FL3731_Keyframe* keys, uint8_t count, bool loop)
+{
+    if(keys == nullptr || count == 0 || track_count_ >= IS31FL3731_TIMELINE_MAX_TRACKS)
+    {
+        return -1;
+    }
+
+    Track& track = tracks_[track_count_];
+    track.keys   = keys;
+    track.count  = count;
+    track.loop   = loop;
+    track.value  = keys[0].value;
+    return track_count_++;
+}
+
+int8_t IS31FL3731_Timeline::addElement(DrawFn draw, void* context)
+{
+    if(draw == nullptr || element_count_ >= IS31FL3731_TIMELINE_MAX_ELEMENTS)
+    {
+        return -1;
+    }
+
+    Element& element = elements_[element_count_];
+    element.draw     = draw;
+    element.context  = context;
+    element.changed  = true;
+    element.bounds.clear();
+    for(uint8_t i = 0; i < IS31FL3731_TIMELINE_MAX_PARAMS; i++)
+    {
+        element.params[i] = 0;
+        element.tracks[i] = -1;
+    }
+    return element_count_++;
+}
+
+void IS31FL3731_Timeline::bindParam(uint8_t element, uint8_t param, int8_t track)
+{
+    if(element >= element_count_ || param >= IS31FL3731_TIMELINE_MAX_PARAMS || track >= track_count_)
+    {
+        return;
+    }
+
+    Element& e      = elements_[element];
+    e.tracks[param] = track;
+    if(track >= 0)
+    {
+        e.params[param] = tracks_[track].value;
+    }
+    e.changed = true;
+}
+
+void IS31FL3731_Timeline::setParam(uint8_t element, uint8_t param, int16_t value)
+{
+    if(element >= element_count_ || param >= IS31FL3731_TIMELINE_MAX_PARAMS)
+    {
+        return;
+    }
+
+    Element& e      = elements_[element];
+    e.tracks[param] = -1;
+    if(e.params[param] != value)
+    {
+        e.params[param] = value;
+        e.changed       = true;
+    }
+}
+
+void IS31FL3731_Timeline::start(uint32_t now_ms)
+{
+    start_ms_ = now_ms;
+}
+
+int16_t IS31FL3731_Timeline::evaluate(const Track& track, uint32_t t) const
+{
+    const IS31FL3731_Keyframe* keys = track.keys;
+    uint32_t                   end  = keys[track.count - 1].time_ms;
+
+    if(track.loop && end > 0)
+    {
+        t %= end;
+    }
+    if(t <= keys[0].time_ms)
+    {
+        return keys[0].value;
+    }
+    if(t >= end)
+    {
+        return keys[track.count - 1].value;
+    }
+
+    uint8_t k = 1;
+    while(keys[k].time_ms <= t)
+    {
+        k++;
+    }
+
+    const IS31FL3731_Keyframe& a = keys[k - 1];
+    const IS31FL3731_Keyframe& b = keys[k];
+    uint16_t progress = ((uint64_t)(t - a.time_ms) * 0xFFFF) / (b.time_ms - a.time_ms);
+    int32_t  delta    = (int32_t)b.value - a.value;
+
+    return a.value + (int16_t)((delta * IS31FL3731_ease(b.easing, progress) + (1 << 14)) >> 15);
+}
+
+bool IS31FL3731_Timeline::update(uint32_t now_ms)
+{
+    uint32_t t       = now_ms - start_ms_;
+    bool     changed = false;
+
+    for(uint8_t i = 0; i < track_count_; i++)
+    {
+        int16_t v = evaluate(tracks_[i], t);
+        if(v != tracks_[i].value)
+        {
+            tracks_[i].value = v;
+            changed          = true;
+        }
+    }
+
+    if(!changed)
+    {
+        return false;
+    }
+
+    for(uint8_t i = 0; i < element_count_; i++)
+    {
+        Element& e = elements_[i];
+        for(uint8_t p = 0; p < IS31FL3731_TIMELINE_MAX_PARAMS; p++)
+        {
+            if(e.tracks[p] >= 0 && e.params[p] != tracks_[e.tracks[p]].value)
+            {
+                e.params[p] = tracks_[e.tracks[p]].value;
+                e.changed   = true;
+            }
+        }
+    }
+
+    return true;
+}
+
+IS31FL3731_Rect IS31FL3731_Timeline::render(IS31FL3731_Graphics& gfx)
+{
+    IS31FL3731_Rect damage;
+    damage.clear();
+
+    for(uint8_t i = 0; i < element_count_; i++)
+    {
+        if(elements_[i].changed)
+        {
+            damage.include(elements_[i].bounds);
+        }
+    }
+
+    bool any_changed = false;
+    for(uint8_t i = 0; i < element_count_; i++)
+    {
+        any_changed |= elements_[i].changed;
+    }
+    if(!any_changed)
+    {
+        return damage;
+    }
+
+    // Erase where changed elements used to be, then redraw back to front
+    // everything that changed or overlaps the area being repainted.
+    if(!damage.empty())
+    {
+        gfx.fillRect(damage.x0, damage.y0, damage.x1 - damage.x0, damage.y1 - damage.y0, background_);
+    }
+
+    for(uint8_t i = 0; i < element_count_; i++)
+    {
+        Element&        e = elements_[i];
+        IS31FL3731_Rect b = e.bounds;
+        bool overlaps = !b.empty() && !damage.empty() && b.x0 < damage.x1 && b.x1 > damage.x0
+                        && b.y0 < damage.y1 && b.y1 > damage.y0;
+        if(!e.changed && !overlaps)
+        {
+            continue;
+        }
+
+        gfx.beginCapture();
+        e.draw(gfx, e.params, e.context);
+        e.bounds  = gfx.endCapture();
+        e.changed = false;
+        damage.include(e.bounds);
+    }
+
+    return damage;
+}
+
+bool IS31FL3731_Timeline::done(uint32_t now_ms) const
+{
+    uint32_t t = now_ms - start_ms_;
+    for(uint8_t i = 0; i < track_count_; i++)
+    {
+        const Track& track = tracks_[i];
+        if(track.loop || t < track.keys[track.count - 1].time_ms)
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#ifndef IS31FL3731_TIMELINE_H
+#define IS31FL3731_TIMELINE_H
+
+#include "IS31FL3731_Graphics.h"
+#include "IS31FL3731_FixedMath.h"
+#include <stdint.h>
+
+#ifndef IS31FL3731_TIMELINE_MAX_TRACKS
+#define IS31FL3731_TIMELINE_MAX_TRACKS 8
+#endif
+
+#ifndef IS31FL3731_TIMELINE_MAX_ELEMENTS
+#define IS31FL3731_TIMELINE_MAX_ELEMENTS 8
+#endif
+
+#define IS31FL3731_TIMELINE_MAX_PARAMS 6
+
+enum class IS31FL3731_Easing : uint8_t
+{
+    LINEAR,
+    EASE_IN,     // quadratic
+    EASE_OUT,    // quadratic
+    EASE_IN_OUT, // cubic
+    SINE,        // sine in-out
+    STEP,        // jump at the end of the segment
+};
+
+// Eased progress in Q15 for a linear progress in Q16 (65535 is the end).
+q15_t IS31FL3731_ease(IS31FL3731_Easing easing, uint16_t progress);
+
+struct IS31FL3731_Keyframe
+{
+    uint32_t          time_ms;
+    int16_t           value;
+    IS31FL3731_Easing easing; // curve of the segment leading into this key
+};
+
+// Keyframed parameters driving graphics draw calls. Tracks are evaluated
+// against wall-clock time, and an element is only re-rasterized when one
+// of its parameters actually changed since the last render().
+class IS31FL3731_Timeline
+{
+  public:
+    typedef void (*DrawFn)(IS31FL3731_Graphics& gfx, const int16_t* params, void* context);
+
+    IS31FL3731_Timeline();
+
+    // Keyframes must be sorted by time and outlive the timeline; const
+    // arrays stay in flash. Returns the track index, or -1 when full.
+    int8_t addTrack(const IS31FL3731_Keyframe* keys, uint8_t count, bool loop = false);
+
+    // Elements are drawn in the order they were added. Returns the element
+    // index, or -1 when full.
+    int8_t addElement(DrawFn draw, void* context = nullptr);
+    void   bindParam(uint8_t element, uint8_t param, int8_t track);
+    void   setParam(uint8_t element, uint8_t param, int16_t value);
+
+    void start(uint32_t now_ms);
+
+    // Evaluates all tracks at now_ms. Returns true if any value changed.
+    bool update(uint32_t now_ms);
+
+    // Clears and redraws only what changed, in the graphics draw target.
+    // Returns the region that was touched, empty if nothing changed.
+    IS31FL3731_Rect render(IS31FL3731_Graphics& gfx);
+
+    void    setBackground(uint8_t brightness) { background_ = brightness; }
+    int16_t value(uint8_t track) const { return track < track_count_ ? tracks_[track].value : 0; }
+    bool    done(uint32_t now_ms) const;
+
+  private:
+    struct Track
+    {
+        const IS31FL3731_Keyframe* keys;
+        uint8_t                    count;
+        bool                       loop;
+        int16_t                    value;
+    };
+
+    struct Element
+    {
+        DrawFn          draw;
+        void*           context;
+        int16_t         params[IS31FL3731_TIMELINE_MAX_PARAMS];
+        int8_t          tracks[IS31FL3731_TIMELINE_MAX_PARAMS];
+        IS31FL3731_Rect bounds;
+        bool            changed;
+    };
+
+    Track    tracks_[IS31FL3731_TIMELINE_MAX_TRACKS];
+    Element  elements_[IS31FL3731_TIMELINE_MAX_ELEMENTS];
+    uint8_t  track_count_;
+    uint8_t  element_count_;
+    uint32_t start_ms_;
+    uint8_t  background_;
+
+    int16_t evaluate(const Track& track, uint32_t t) const;
+};
+
+#endif
@@ -0,0 +1,498 @@
+#include "IS31FL3731_Widgets.h"
+#include <string.h>
+
+static q15_t toQ15(float level)
+{
+    if(!(level > 0.0f))
+        return 0;
+    if(level >= 1.0f)
+        return IS31FL3731_Q15_ONE;
+    return (q15_t)(level * IS31FL3731_Q15_ONE);
+}
+
+static q15_t clampLevel(q15_t level)
+{
+    return level < 0 ? 0 : level;
+}
+
+// Q15 level to a count of cells out of n, rounded.
+static uint8_t cells(int32_t level, uint8_t n)
+{
+    return (uint8_t)((level * n + 16384) >> 15);
+}
+
+static void includeRect(IS31FL3731_Rect& r, int32_t x, int32_t y, int32_t w, int32_t h)
+{
+    r.include(x, y, x + w, y + h);
+}
+
+// ---------------------------------------------------------------------------
+// Bar meter
+
+IS31FL3731_BarMeter::IS31FL3731_BarMeter()
+: last_render_ms_(0), rendered_(false), valid_(false)
+{
+    config_.Defaults();
+    for(uint8_t i = 0; i < IS31FL3731_WIDGET_MAX_BARS; i++)
+    {
+        input_[i].store(0, std::memory_order_relaxed);
+        bar_[i]        = 0;
+        peak_[i]       = 0;
+        peak_time_[i]  = 0;
+        drawn_len_[i]  = 0;
+        drawn_peak_[i] = 0;
+    }
+}
+
+bool IS31FL3731_BarMeter::Init(const Config& config)
+{
+    uint8_t across = config.orientation == Orientation::VERTICAL ? config.width : config.height;
+    if(config.width == 0 || config.height == 0 || config.bars == 0
+       || config.bars > IS31FL3731_WIDGET_MAX_BARS || config.bars > across)
+    {
+        return false;
+    }
+
+    config_   = config;
+    rendered_ = false;
+    valid_    = false;
+    return true;
+}
+
+void IS31FL3731_BarMeter::setValue(uint8_t bar, q15_t level)
+{
+    if(bar < IS31FL3731_WIDGET_MAX_BARS)
+    {
+        input_[bar].store(clampLevel(level), std::memory_order_relaxed);
+    }
+}
+
+void IS31FL3731_BarMeter::setValue(uint8_t bar, float level)
+{
+    setValue(bar, toQ15(level));
+}
+
+// In viewport coordinates. Bar i covers [i * across / bars, (i + 1) *
+// across / bars) across the meter, so bars share the space evenly.
+void IS31FL3731_BarMeter::drawBar(IS31FL3731_Graphics& gfx, uint8_t i, uint8_t len, uint8_t peak) const
+{
+    bool    vertical = config_.orientation == Orientation::VERTICAL;
+    uint8_t across   = vertical ? config_.width : config_.height;
+    uint8_t length   = vertical ? config_.height : config_.width;
+    int16_t s0       = i * across / config_.bars;
+    int16_t s1       = (i + 1) * across / config_.bars;
+
+    if(vertical)
+    {
+        gfx.fillRect(s0, 0, s1 - s0, length - len, config_.background);
+        gfx.fillRect(s0, length - len, s1 - s0, len, config_.brightness);
+        if(peak > 0)
+            gfx.drawHLine(s0, length - peak, s1 - s0, config_.peak_brightness);
+    }
+    else
+    {
+        gfx.fillRect(0, s0, len, s1 - s0, config_.brightness);
+        gfx.fillRect(len, s0, length - len, s1 - s0, config_.background);
+        if(peak > 0)
+            gfx.drawVLine(peak - 1, s0, s1 - s0, config_.peak_brightness);
+    }
+}
+
+IS31FL3731_Rect IS31FL3731_BarMeter::render(IS31FL3731_Graphics& gfx, uint32_t now_ms)
+{
+    bool    vertical = config_.orientation == Orientation::VERTICAL;
+    uint8_t across   = vertical ? config_.width : config_.height;
+    uint8_t length   = vertical ? config_.height : config_.width;
+
+    uint32_t elapsed = rendered_ ? now_ms - last_render_ms_ : 0;
+    last_render_ms_  = now_ms;
+    rendered_        = true;
+
+    // fall_per_s is in sixteenths of the full length per second, as for
+    // IS31FL3731_Spectrum.
+    int32_t drop = config_.fall_per_s > 0
+                       ? (int32_t)(((uint64_t)config_.fall_per_s * 2048 * elapsed) / 1000)
+                       : IS31FL3731_Q15_ONE;
+
+    IS31FL3731_Rect touched;
+    touched.clear();
+    gfx.setViewport(config_.x, config_.y, config_.width, config_.height);
+
+    for(uint8_t i = 0; i < config_.bars; i++)
+    {
+        int32_t target = input_[i].load(std::memory_order_relaxed);
+
+        bar_[i] = bar_[i] - drop > target ? bar_[i] - drop : target;
+        if(target >= peak_[i])
+        {
+            peak_[i]      = target;
+            peak_time_[i] = now_ms;
+        }
+        else if(now_ms - peak_time_[i] > config_.peak_hold_ms)
+        {
+            peak_[i] = peak_[i] - drop > target ? peak_[i] - drop : target;
+        }
+
+        uint8_t len  = cells(bar_[i], length);
+        uint8_t peak = config_.peak_hold_ms > 0 ? cells(peak_[i], length) : 0;
+        if(valid_ && len == drawn_len_[i] && peak == drawn_peak_[i])
+            continue;
+
+        drawBar(gfx, i, len, peak);
+        drawn_len_[i]  = len;
+        drawn_peak_[i] = peak;
+
+        int16_t s0 = i * across / config_.bars;
+        int16_t s1 = (i + 1) * across / config_.bars;
+        if(vertical)
+            includeRect(touched, config_.x + s0, config_.y, s1 - s0, length);
+        else
+            includeRect(touched, config_.x, config_.y + s0, length, s1 - s0);
+    }
+
+    gfx.resetClip();
+    valid_ = true;
+    return touched;
+}
+
+// ---------------------------------------------------------------------------
+// Sparkline
+
+IS31FL3731_Sparkline::IS31FL3731_Sparkline()
+: head_(0), next_ms_(0), started_(false), valid_(false)
+{
+    config_.Defaults();
+    latest_.store(0, std::memory_order_relaxed);
+    high_.store(-1, std::memory_order_relaxed);
+    memset(history_, 0, sizeof(history_));
+}
+
+bool IS31FL3731_Sparkline::Init(const Config& config)
+{
+    if(config.width == 0 || config.width > IS31FL3731_WIDGET_MAX_COLUMNS || config.height == 0
+       || config.interval_ms == 0)
+    {
+        return false;
+    }
+
+    config_  = config;
+    head_    = 0;
+    started_ = false;
+    valid_   = false;
+    memset(history_, 0, sizeof(history_));
+    return true;
+}
+
+void IS31FL3731_Sparkline::setValue(q15_t level)
+{
+    level = clampLevel(level);
+    latest_.store(level, std::memory_order_relaxed);
+
+    q15_t high = high_.load(std::memory_order_relaxed);
+    while(level > high && !high_.compare_exchange_weak(high, level, std::memory_order_relaxed))
+    {
+    }
+}
+
+void IS31FL3731_Sparkline::setValue(float level)
+{
+    setValue(toQ15(level));
+}
+
+// Row of the trace counted from the bottom for LINE, bar height for BARS.
+uint8_t IS31FL3731_Sparkline::toLevel(q15_t v) const
+{
+    return config_.style == Style::LINE ? cells(v, config_.height - 1) : cells(v, config_.height);
+}
+
+// Draws into a column that is already background. prev is the level of
+// the column to the left, which a LINE trace joins vertically.
+void IS31FL3731_Sparkline::drawColumn(IS31FL3731_Graphics& gfx, int16_t x, uint8_t level, uint8_t prev) const
+{
+    int16_t h = config_.height;
+    if(config_.style == Style::BARS)
+    {
+        gfx.drawVLine(x, h - level, level, config_.brightness);
+        return;
+    }
+
+    if(prev == level)
+        gfx.setPixel(x, h - 1 - level, config_.brightness);
+    else if(prev < level)
+        gfx.drawVLine(x, h - 1 - level, level - prev, config_.brightness);
+    else
+        gfx.drawVLine(x, h - prev, prev - level, config_.brightness);
+}
+
+IS31FL3731_Rect IS31FL3731_Sparkline::render(IS31FL3731_Graphics& gfx, uint32_t now_ms)
+{
+    uint8_t w = config_.width;
+    if(!started_)
+    {
+        next_ms_ = now_ms + config_.interval_ms;
+        started_ = true;
+    }
+
+    // Columns due since the last call, all showing what was set since the
+    // previous one; after a long stall at most a screenful is added.
+    uint32_t due = 0;
+    if((int32_t)(now_ms - next_ms_) >= 0)
+    {
+        due = (now_ms - next_ms_) / config_.interval_ms + 1;
+        next_ms_ += due * config_.interval_ms;
+    }
+    uint8_t added = due < w ? due : w;
+
+    // The ring holds one column more than is shown, so the leftmost one
+    // still knows where the trace came from. head_ is the oldest.
+    uint8_t slots = w + 1;
+    if(added > 0)
+    {
+        q15_t high = high_.exchange(-1, std::memory_order_relaxed);
+        if(high < 0)
+            high = latest_.load(std::memory_order_relaxed);
+        uint8_t level = toLevel(high);
+        for(uint8_t i = 0; i < added; i++)
+        {
+            history_[head_] = level;
+            head_           = (head_ + 1) % slots;
+        }
+    }
+
+    IS31FL3731_Rect touched;
+    touched.clear();
+    if(valid_ && added == 0)
+        return touched;
+
+    gfx.setViewport(config_.x, config_.y, w, config_.height);
+    int16_t first = 0;
+    if(valid_)
+    {
+        // Columns that scroll in from past the right edge of the target
+        // were never drawn, so they are drawn along with the new ones.
+        IS31FL3731_Rect clip    = gfx.clip();
+        int16_t         visible = clip.x1 - config_.x < w ? clip.x1 - config_.x : w;
+        first                   = visible - added > 0 ? visible - added : 0;
+        gfx.scroll(-added, 0, config_.background);
+        gfx.fillRect(first, 0, w - first, config_.height, config_.background);
+    }
+    else
+    {
+        gfx.fill(config_.background);
+    }
+
+    for(int16_t c = first; c < w; c++)
+    {
+        drawColumn(gfx, c, history_[(head_ + 1 + c) % slots], history_[(head_ + c) % slots]);
+    }
+
+    gfx.resetClip();
+    valid_ = true;
+    includeRect(touched, config_.x, config_.y, w, config_.height);
+    return touched;
+}
+
+// ---------------------------------------------------------------------------
+// Knob ring
+
+IS31FL3731_KnobRing::IS31FL3731_KnobRing() : count_(0), valid_(false)
+{
+    config_.Defaults();
+    input_.store(0, std::memory_order_relaxed);
+}
+
+// Nearest integer to radius * v, v in Q15.
+static int16_t scaleRound(uint8_t radius, q15_t v)
+{
+    int32_t p = (int32_t)radius * v;
+    return (int16_t)(p >= 0 ? (p + 16384) >> 15 : -((-p + 16384) >> 15));
+}
+
+bool IS31FL3731_KnobRing::Init(const Config& config)
+{
+    if(config.dots == 0 || config.dots > IS31FL3731_WIDGET_MAX_DOTS)
+    {
+        return false;
+    }
+
+    config_ = config;
+    count_  = 0;
+    for(uint8_t i = 0; i < config.dots; i++)
+    {
+        uint16_t phase = config.start;
+        if(config.dots > 1)
+            phase += (uint16_t)(((uint32_t)config.sweep * i) / (config.dots - 1));
+
+        int16_t x = config.cx + scaleRound(config.radius, cos16(phase));
+        int16_t y = config.cy + scaleRound(config.radius, sin16(phase));
+        if(count_ > 0 && x == dot_x_[count_ - 1] && y == dot_y_[count_ - 1])
+            continue;
+        dot_x_[count_] = x;
+        dot_y_[count_] = y;
+        count_++;
+    }
+    // A full turn ends where it started.
+    if(count_ > 1 && dot_x_[count_ - 1] == dot_x_[0] && dot_y_[count_ - 1] == dot_y_[0])
+        count_--;
+
+    valid_ = false;
+    return true;
+}
+
+void IS31FL3731_KnobRing::setValue(q15_t value)
+{
+    input_.store(clampLevel(value), std::memory_order_relaxed);
+}
+
+void IS31FL3731_KnobRing::setValue(float value)
+{
+    setValue(toQ15(value));
+}
+
+// Positions along the ring are in Q15 dot steps: dot i sits at i << 15.
+// The lit interval covers dots inside it fully and fades out over one
+// step beyond each end, so the value moves smoothly between dots.
+uint8_t IS31FL3731_KnobRing::dotBrightness(uint8_t i, int32_t position) const
+{
+    const int32_t one = 1 << 15;
+    int32_t       lo  = position;
+    int32_t       hi  = position;
+    if(config_.mode == Mode::ARC)
+        lo = 0;
+    else if(config_.mode == Mode::BIPOLAR)
+    {
+        int32_t middle = (int32_t)(count_ - 1) << 14;
+        lo             = position < middle ? position : middle;
+        hi             = position < middle ? middle : position;
+    }
+
+    int32_t at       = (int32_t)i << 15;
+    int32_t distance = at < lo ? lo - at : (at > hi ? at - hi : 0);
+    int32_t cover    = distance < one ? one - distance : 0;
+    return (uint8_t)(config_.dim + (((int32_t)config_.brightness - config_.dim) * cover >> 15));
+}
+
+IS31FL3731_Rect IS31FL3731_KnobRing::render(IS31FL3731_Graphics& gfx, uint32_t /*now_ms*/)
+{
+    IS31FL3731_Rect touched;
+    touched.clear();
+
+    // Full scale lands exactly on the last dot.
+    int64_t value    = input_.load(std::memory_order_relaxed);
+    int32_t position = (int32_t)((value * (count_ - 1) << 15) / IS31FL3731_Q15_ONE);
+
+    gfx.resetClip();
+    for(uint8_t i = 0; i < count_; i++)
+    {
+        uint8_t b = dotBrightness(i, position);
+        if(valid_ && b == drawn_[i])
+            continue;
+
+        gfx.setPixel(dot_x_[i], dot_y_[i], b);
+        drawn_[i] = b;
+        touched.include(dot_x_[i], dot_y_[i]);
+    }
+
+    valid_ = true;
+    return touched;
+}
+
+// ---------------------------------------------------------------------------
+// Readout
+
+IS31FL3731_Readout::IS31FL3731_Readout() : valid_(false)
+{
+    config_.Defaults();
+    input_.store(0, std::memory_order_relaxed);
+    memset(drawn_, ' ', sizeof(drawn_));
+}
+
+bool IS31FL3731_Readout::Init(const Config& config)
+{
+    if(config.digits == 0 || config.digits > IS31FL3731_WIDGET_MAX_DIGITS)
+    {
+        return false;
+    }
+
+    config_ = config;
+    if(config_.font == nullptr)
+        config_.font = &IS31FL3731_FONT_3X5;
+    valid_ = false;
+    return true;
+}
+
+void IS31FL3731_Readout::setValue(int32_t value)
+{
+    input_.store(value, std::memory_order_relaxed);
+}
+
+void IS31FL3731_Readout::format(int32_t value, char* out) const
+{
+    uint8_t  n        = config_.digits;
+    bool     negative = value < 0;
+    uint32_t v        = negative ? 0u - (uint32_t)value : (uint32_t)value;
+
+    int8_t i = n - 1;
+    do
+    {
+        if(i < (negative ? 1 : 0))
+        {
+            memset(out, '-', n);
+            return;
+        }
+        out[i--] = '0' + v % 10;
+        v /= 10;
+    } while(v != 0);
+
+    char pad = config_.leading_zeros ? '0' : ' ';
+    for(; i >= 0; i--)
+        out[i] = pad;
+    if(negative)
+    {
+        // The sign goes right before the digits, or first with zeros.
+        int8_t s = 0;
+        if(!config_.leading_zeros)
+            while(s + 1 < n && out[s + 1] == ' ')
+                s++;
+        out[s] = '-';
+    }
+}
+
+IS31FL3731_Rect IS31FL3731_Readout::render(IS31FL3731_Graphics& gfx, uint32_t /*now_ms*/)
+{
+    const IS31FL3731_Font* font    = config_.font;
+    int16_t                advance = font->width + font->spacing;
+
+    IS31FL3731_Rect touched;
+    touched.clear();
+
+    char cells_now[IS31FL3731_WIDGET_MAX_DIGITS];
+    format(input_.load(std::memory_order_relaxed), cells_now);
+
+    const IS31FL3731_Font* previous = gfx.font();
+    gfx.resetClip();
+    gfx.setFont(font);
+    if(!valid_)
+    {
+        int16_t w = config_.digits * advance - font->spacing;
+        gfx.fillRect(config_.x, config_.y, w, font->height, config_.background);
+        includeRect(touched, config_.x, config_.y, w, font->height);
+    }
+
+    for(uint8_t i = 0; i < config_.digits; i++)
+    {
+        if(valid_ && cells_now[i] == drawn_[i])
+            continue;
+
+        int16_t x = config_.x + i * advance;
+        gfx.fillRect(x, config_.y, font->width, font->height, config_.background);
+        if(cells_now[i] != ' ')
+            gfx.drawChar(x, config_.y, cells_now[i], config_.brightness);
+        drawn_[i] = cells_now[i];
+        includeRect(touched, x, config_.y, font->width, font->height);
+    }
+
+    gfx.setFont(previous);
+    valid_ = true;
+    return touched;
+}
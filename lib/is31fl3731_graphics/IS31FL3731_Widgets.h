@@ -0,0 +1,278 @@
+#pragma once
+
+#ifndef IS31FL3731_WIDGETS_H
+#define IS31FL3731_WIDGETS_H
+
+#include "IS31FL3731_Graphics.h"
+#include "IS31FL3731_FixedMath.h"
+#include <atomic>
+#include <stdint.h>
+
+#ifndef IS31FL3731_WIDGET_MAX_BARS
+#define IS31FL3731_WIDGET_MAX_BARS 16
+#endif
+
+#ifndef IS31FL3731_WIDGET_MAX_DOTS
+#define IS31FL3731_WIDGET_MAX_DOTS 32
+#endif
+
+#ifndef IS31FL3731_WIDGET_MAX_DIGITS
+#define IS31FL3731_WIDGET_MAX_DIGITS 8
+#endif
+
+#define IS31FL3731_WIDGET_MAX_COLUMNS 32
+
+// Small indicators for LED matrices. Each one splits its work like
+// IS31FL3731_Spectrum: setValue() only stores into an atomic, so the audio
+// callback can call it every block, and render() in the main loop redraws
+// just the bars, columns, dots or digits whose pixels changed since the
+// last call. render() draws into the graphics draw target in target
+// coordinates, leaves the clip reset, and returns the region it touched,
+// empty when nothing changed; the first call draws the whole widget.
+// Levels are Q15, 0 to 32767; the float overloads take 0 to 1.
+
+// Row of bars with peak hold: vertical bars grow up, horizontal bars grow
+// to the right.
+class IS31FL3731_BarMeter
+{
+  public:
+    enum class Orientation
+    {
+        VERTICAL,
+        HORIZONTAL,
+    };
+
+    struct Config
+    {
+        int16_t     x;
+        int16_t     y;
+        uint8_t     width;
+        uint8_t     height;
+        uint8_t     bars; // side by side across the meter
+        Orientation orientation;
+        uint8_t     brightness;
+        uint8_t     peak_brightness;
+        uint8_t     background;
+        uint16_t    peak_hold_ms; // 0 turns the peak marker off
+        uint16_t    fall_per_s;   // full lengths / 16 per second, 0 follows the input at once
+
+        void Defaults()
+        {
+            x               = 0;
+            y               = 0;
+            width           = 16;
+            height          = 9;
+            bars            = 16;
+            orientation     = Orientation::VERTICAL;
+            brightness      = 120;
+            peak_brightness = 255;
+            background      = 0;
+            peak_hold_ms    = 400;
+            fall_per_s      = 24;
+        }
+    };
+
+    IS31FL3731_BarMeter();
+
+    bool Init(const Config& config);
+
+    // Audio context.
+    void setValue(uint8_t bar, q15_t level);
+    void setValue(uint8_t bar, float level);
+
+    // Main loop.
+    IS31FL3731_Rect render(IS31FL3731_Graphics& gfx, uint32_t now_ms);
+    void            invalidate() { valid_ = false; }
+
+  private:
+    Config               config_;
+    std::atomic<q15_t>   input_[IS31FL3731_WIDGET_MAX_BARS];
+    int32_t              bar_[IS31FL3731_WIDGET_MAX_BARS];  // displayed, Q15
+    int32_t              peak_[IS31FL3731_WIDGET_MAX_BARS]; // Q15
+    uint32_t             peak_time_[IS31FL3731_WIDGET_MAX_BARS];
+    uint8_t              drawn_len_[IS31FL3731_WIDGET_MAX_BARS];
+    uint8_t              drawn_peak_[IS31FL3731_WIDGET_MAX_BARS];
+    uint32_t             last_render_ms_;
+    bool                 rendered_;
+    bool                 valid_;
+
+    void drawBar(IS31FL3731_Graphics& gfx, uint8_t i, uint8_t len, uint8_t peak) const;
+};
+
+// Scrolling history, one column per interval, newest on the right. A
+// column shows the highest level set during its interval, so short peaks
+// between renders are not lost. New columns scroll the old ones left and
+// only the new ones are rasterized.
+class IS31FL3731_Sparkline
+{
+  public:
+    enum class Style
+    {
+        LINE, // connected trace
+        BARS, // filled from the bottom
+    };
+
+    struct Config
+    {
+        int16_t  x;
+        int16_t  y;
+        uint8_t  width; // at most IS31FL3731_WIDGET_MAX_COLUMNS
+        uint8_t  height;
+        uint16_t interval_ms;
+        Style    style;
+        uint8_t  brightness;
+        uint8_t  background;
+
+        void Defaults()
+        {
+            x           = 0;
+            y           = 0;
+            width       = 16;
+            height      = 9;
+            interval_ms = 50;
+            style       = Style::LINE;
+            brightness  = 180;
+            background  = 0;
+        }
+    };
+
+    IS31FL3731_Sparkline();
+
+    bool Init(const Config& config);
+
+    // Audio context.
+    void setValue(q15_t level);
+    void setValue(float level);
+
+    // Main loop.
+    IS31FL3731_Rect render(IS31FL3731_Graphics& gfx, uint32_t now_ms);
+    void            invalidate() { valid_ = false; }
+
+  private:
+    Config             config_;
+    std::atomic<q15_t> latest_;
+    std::atomic<q15_t> high_; // highest since the last column, -1 if none
+    uint8_t            history_[IS31FL3731_WIDGET_MAX_COLUMNS + 1]; // ring of column levels
+    uint8_t            head_;
+    uint32_t           next_ms_;
+    bool               started_;
+    bool               valid_;
+
+    uint8_t toLevel(q15_t v) const;
+    void    drawColumn(IS31FL3731_Graphics& gfx, int16_t x, uint8_t level, uint8_t prev) const;
+};
+
+// Dots on a circle around a knob, lit along the arc up to the value.
+class IS31FL3731_KnobRing
+{
+  public:
+    enum class Mode
+    {
+        ARC,     // from the start of the sweep to the value
+        DOT,     // only the dot at the value
+        BIPOLAR, // from the middle of the sweep to the value
+    };
+
+    struct Config
+    {
+        int16_t  cx;
+        int16_t  cy;
+        uint8_t  radius;
+        uint8_t  dots;
+        uint16_t start; // phase of the first dot, 65536 per turn, 0 pointing right, clockwise
+        uint16_t sweep; // phase from the first dot to the last
+        Mode     mode;
+        uint8_t  brightness;
+        uint8_t  dim; // unlit dots, so the ring stays visible
+
+        void Defaults()
+        {
+            cx         = 4;
+            cy         = 4;
+            radius     = 4;
+            dots       = 16;
+            start      = 24576; // 7:30 o'clock ...
+            sweep      = 49152; // ... round to 4:30, 270 degrees
+            mode       = Mode::ARC;
+            brightness = 255;
+            dim        = 8;
+        }
+    };
+
+    IS31FL3731_KnobRing();
+
+    // Fails when dots is 0 or above IS31FL3731_WIDGET_MAX_DOTS. Dots that
+    // land on the same LED as their neighbour are merged.
+    bool Init(const Config& config);
+
+    // Audio context.
+    void setValue(q15_t value);
+    void setValue(float value);
+
+    // Main loop. The dot where the value falls between two is lit in
+    // proportion.
+    IS31FL3731_Rect render(IS31FL3731_Graphics& gfx, uint32_t now_ms = 0);
+    void            invalidate() { valid_ = false; }
+    uint8_t         dots() const { return count_; }
+
+  private:
+    Config             config_;
+    std::atomic<q15_t> input_;
+    int16_t            dot_x_[IS31FL3731_WIDGET_MAX_DOTS];
+    int16_t            dot_y_[IS31FL3731_WIDGET_MAX_DOTS];
+    uint8_t            drawn_[IS31FL3731_WIDGET_MAX_DOTS];
+    uint8_t            count_;
+    bool               valid_;
+
+    uint8_t dotBrightness(uint8_t i, int32_t position) const;
+};
+
+// Right-aligned integer in fixed character cells; only cells whose
+// character changed are redrawn.
+class IS31FL3731_Readout
+{
+  public:
+    struct Config
+    {
+        int16_t                x;
+        int16_t                y;
+        uint8_t                digits; // cells, including a minus sign
+        const IS31FL3731_Font* font;
+        uint8_t                brightness;
+        uint8_t                background;
+        bool                   leading_zeros;
+
+        void Defaults()
+        {
+            x             = 0;
+            y             = 0;
+            digits        = 4;
+            font          = &IS31FL3731_FONT_3X5;
+            brightness    = 200;
+            background    = 0;
+            leading_zeros = false;
+        }
+    };
+
+    IS31FL3731_Readout();
+
+    bool Init(const Config& config);
+
+    // Audio context. A value that does not fit shows as all dashes.
+    void    setValue(int32_t value);
+    int32_t value() const { return input_.load(std::memory_order_relaxed); }
+
+    // Main loop.
+    IS31FL3731_Rect render(IS31FL3731_Graphics& gfx, uint32_t now_ms = 0);
+    void            invalidate() { valid_ = false; }
+
+  private:
+    Config               config_;
+    std::atomic<int32_t> input_;
+    char                 drawn_[IS31FL3731_WIDGET_MAX_DIGITS];
+    bool                 valid_;
+
+    void format(int32_t value, char* cells) const;
+};
+
+#endif
@@ -0,0 +1,220 @@
+// Builds an IS31FL3731_AnimationStore image from a sequence made by
+// sequence_encode, then maps the image file back in the way the Daisy
+// sees QSPI flash and checks every burst is byte for byte what the
+// sequence decodes to. Finally it plays the mapped store through
+// IS31FL3731_StorePlayer into the host chip model, single and double
+// buffered, and checks the PWM registers of every frame shown against
+// the decoded frame.
+//
+//   g++ -O2 -std=gnu++14 -Itools/host -I. -o animation_store tools/animation_store.cpp
+//       lib/is31fl3731/*.cpp
+//       lib/is31fl3731_graphics/IS31FL3731_Canvas.cpp
+//       lib/is31fl3731_graphics/IS31FL3731_Sequence.cpp
+//       lib/is31fl3731_graphics/IS31FL3731_AnimationStore.cpp
+//       lib/is31fl3731_graphics/IS31FL3731_StorePlayer.cpp
+//   ./animation_store anim.isq store.bin
+//
+// Flash store.bin at the QSPI offset the firmware passes to Init().
+
+#include "lib/is31fl3731_graphics/IS31FL3731_AnimationStore.h"
+#include "lib/is31fl3731_graphics/IS31FL3731_Canvas.h"
+#include "lib/is31fl3731_graphics/IS31FL3731_Sequence.h"
+#include "lib/is31fl3731_graphics/IS31FL3731_StorePlayer.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+struct Frame
+{
+    uint16_t             duration_ms;
+    std::vector<uint8_t> pixels;
+};
+
+static bool decodeSequence(const char* path, std::vector<Frame>& frames, int& w, int& h)
+{
+    FILE* f = fopen(path, "rb");
+    if(f == nullptr)
+        return false;
+    std::vector<uint8_t> data;
+    uint8_t              buf[4096];
+    size_t               n;
+    while((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    fclose(f);
+
+    IS31FL3731_MemorySource source(data.data(), data.size());
+    if(data.size() < IS31FL3731_SEQUENCE_HEADER_SIZE)
+        return false;
+    w = data[4];
+    h = data[5];
+    if(w * h > IS31FL3731_STORE_FRAME_PIXELS)
+        return false;
+
+    std::vector<uint8_t>      pixels(w * h, 0);
+    IS31FL3731_Canvas         canvas(pixels.data(), w, h);
+    IS31FL3731_SequencePlayer player;
+
+    IS31FL3731_SequencePlayer::Config cfg;
+    cfg.Defaults();
+    cfg.source = &source;
+    cfg.canvas = &canvas;
+    cfg.loop   = false;
+    if(!player.Init(cfg))
+        return false;
+
+    uint32_t now = 0;
+    player.start(now);
+    while(!player.error() && frames.size() < player.frameCount())
+    {
+        Frame frame;
+        frame.duration_ms = player.duration();
+        frame.pixels      = pixels;
+        frames.push_back(frame);
+
+        now += frame.duration_ms;
+        player.tick(now);
+    }
+    return !player.error();
+}
+
+static std::vector<uint8_t> registerImage(const Frame& frame)
+{
+    std::vector<uint8_t> regs(IS31FL3731_STORE_FRAME_PIXELS, 0);
+    std::copy(frame.pixels.begin(), frame.pixels.end(), regs.begin());
+    return regs;
+}
+
+// Plays the store on the chip model the way the firmware does and compares
+// the bank each frame went to with the frame it came from.
+static bool replay(IS31FL3731_AnimationStore& store, const std::vector<Frame>& frames, bool double_buffer)
+{
+    HostChip& chip = HostChip::instance();
+    chip.reset();
+
+    IS31FL3731 driver;
+    if(!driver.begin())
+        return false;
+
+    IS31FL3731_StorePlayer         player;
+    IS31FL3731_StorePlayer::Config cfg;
+    cfg.Defaults();
+    cfg.store         = &store;
+    cfg.driver        = &driver;
+    cfg.bank          = 2;
+    cfg.double_buffer = double_buffer;
+    cfg.loop          = false;
+    if(!player.Init(cfg))
+        return false;
+
+    uint32_t now   = 0;
+    size_t   shown = 0;
+    player.start(now);
+    for(bool sent = true;; sent = player.tick(now))
+    {
+        if(sent)
+        {
+            uint8_t bank = double_buffer ? chip.regs[HostChip::BANK_FUNCTION][ISSI_REG_PICTUREFRAME]
+                                         : cfg.bank;
+            std::vector<uint8_t> expected = registerImage(frames[player.frame()]);
+            if(memcmp(&chip.regs[bank][0x24], expected.data(), expected.size()) != 0)
+            {
+                fprintf(stderr,
+                        "replay%s: frame %u differs on the chip\n",
+                        double_buffer ? " (double buffered)" : "",
+                        player.frame());
+                return false;
+            }
+            shown++;
+        }
+        if(player.done())
+            break;
+        now += store.duration(player.frame());
+    }
+
+    if(chip.bad_accesses != 0 || shown == 0)
+        return false;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc != 3)
+    {
+        fprintf(stderr, "usage: %s anim.isq store.bin\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<Frame> frames;
+    int                w;
+    int                h;
+    if(!decodeSequence(argv[1], frames, w, h))
+    {
+        fprintf(stderr, "could not decode %s (frames must fit in 144 pixels)\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<uint8_t> image(IS31FL3731_AnimationStore::imageSize(frames.size()));
+    IS31FL3731_AnimationStore::formatHeader(image.data(), frames.size(), w, h);
+    for(size_t i = 0; i < frames.size(); i++)
+    {
+        uint8_t* record = &image[IS31FL3731_STORE_HEADER_SIZE + i * IS31FL3731_STORE_RECORD_SIZE];
+        IS31FL3731_AnimationStore::formatRecord(
+            record, frames[i].pixels.data(), frames[i].pixels.size(), frames[i].duration_ms);
+    }
+
+    FILE* out = fopen(argv[2], "wb");
+    if(out == nullptr || fwrite(image.data(), 1, image.size(), out) != image.size())
+    {
+        fprintf(stderr, "could not write %s\n", argv[2]);
+        return 1;
+    }
+    fclose(out);
+
+    // Read it back through a read-only mapping, like QSPI in memory-mapped mode.
+    int         fd = open(argv[2], O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0)
+    {
+        fprintf(stderr, "could not map %s\n", argv[2]);
+        return 1;
+    }
+    const uint8_t* flash = (const uint8_t*)mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(flash == MAP_FAILED)
+    {
+        fprintf(stderr, "could not map %s\n", argv[2]);
+        return 1;
+    }
+
+    IS31FL3731_AnimationStore store;
+    bool                      ok = store.Init(flash, st.st_size) && store.frameCount() == frames.size();
+    for(size_t i = 0; ok && i < frames.size(); i++)
+    {
+        std::vector<uint8_t> expected(1, 0x24);
+        std::vector<uint8_t> regs = registerImage(frames[i]);
+        expected.insert(expected.end(), regs.begin(), regs.end());
+
+        ok = memcmp(store.burst(i), expected.data(), expected.size()) == 0
+             && store.duration(i) == frames[i].duration_ms;
+        if(!ok)
+            fprintf(stderr, "frame %zu differs\n", i);
+    }
+    if(ok && !(replay(store, frames, false) && replay(store, frames, true)))
+    {
+        fprintf(stderr, "playing the store did not reproduce the frames\n");
+        ok = false;
+    }
+    munmap((void*)flash, st.st_size);
+
+    if(!ok)
+        return 1;
+
+    fprintf(stderr, "%zu frames, %dx%d: %zu byte image, every burst verified and replayed\n",
+            frames.size(), w, h, image.size());
+    return 0;
+}
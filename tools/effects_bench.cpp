@@ -0,0 +1,76 @@
+// Host benchmark for the procedural effects. Builds without libDaisy:
+//
+//   g++ -O2 -std=gnu++14 -I. -o effects_bench tools/effects_bench.cpp
+//       lib/is31fl3731_graphics/IS31FL3731_Canvas.cpp
+//       lib/is31fl3731_graphics/IS31FL3731_FixedMath.cpp
+//       lib/is31fl3731_graphics/IS31FL3731_Effects.cpp
+//   ./effects_bench [frames]
+//
+// Run it on the same machine before and after a change; the numbers are
+// only comparable to each other, not to the Cortex-M7.
+
+#include "lib/is31fl3731_graphics/IS31FL3731_Canvas.h"
+#include "lib/is31fl3731_graphics/IS31FL3731_Effects.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+// A fresh set per measurement, so no run starts from the state, clock or
+// canvas contents another run left behind.
+struct BenchEffects
+{
+    IS31FL3731_PlasmaEffect  plasma;
+    IS31FL3731_WaveEffect    wave;
+    IS31FL3731_RippleEffect  ripple;
+    IS31FL3731_FireEffect    fire;
+    IS31FL3731_TwinkleEffect twinkle;
+    IS31FL3731_CometEffect   comet;
+
+    BenchEffects() { fire.setStepMs(16); }
+
+    IS31FL3731_Effect* get(int index)
+    {
+        IS31FL3731_Effect* all[] = {&plasma, &wave, &ripple, &fire, &twinkle, &comet};
+        return all[index];
+    }
+};
+
+static const char* const BENCH_NAMES[] = {"plasma", "wave", "ripple", "fire", "twinkle", "comet"};
+static const int         BENCH_COUNT   = sizeof(BENCH_NAMES) / sizeof(BENCH_NAMES[0]);
+
+template <uint16_t W, uint16_t H>
+static void runBench(uint32_t frames)
+{
+    printf("%ux%u canvas, %lu frames\n", W, H, (unsigned long)frames);
+    for(int e = 0; e < BENCH_COUNT; e++)
+    {
+        IS31FL3731_StaticCanvas<W, H> canvas;
+        BenchEffects                  effects;
+        IS31FL3731_Effect*            effect   = effects.get(e);
+        uint32_t                      checksum = 0;
+        auto                          start    = std::chrono::steady_clock::now();
+        for(uint32_t f = 0; f < frames; f++)
+        {
+            effect->render(&canvas, f * 16);
+            checksum += canvas.pixels()[f % (W * H)];
+        }
+        auto   end = std::chrono::steady_clock::now();
+        double ns  = std::chrono::duration<double, std::nano>(end - start).count();
+
+        printf("  %-8s %9.1f ns/frame %7.2f ns/pixel  (checksum %lu)\n",
+               BENCH_NAMES[e],
+               ns / frames,
+               ns / frames / (W * H),
+               (unsigned long)checksum);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t frames = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+
+    runBench<16, 9>(frames);
+    runBench<128, 9>(frames / 8);
+
+    return 0;
+}
@@ -0,0 +1,251 @@
+// Fuzz harness for the IS31FL3731 driver's register protocol: the input is
+// turned into public driver calls with arbitrary LEDs, counts, banks and
+// frames, interleaved with injected bus failures, against the host chip
+// model in tools/host. The run aborts when anything reaches the chip
+// outside its register map, when a bank other than the frames and the
+// function bank gets selected, when a PWM write or read that reported
+// success, retries included, does not match the chip, when restore()
+// after a simulated power loss reports success but the chip is not back
+// as it was, or when a successful sync() leaves any register differing
+// from the driver's shadow. A small trace is attached throughout and
+// serialized after every input.
+//
+//   clang++ -g -O1 -std=gnu++14 -fsanitize=fuzzer,address,undefined
+//       -Itools/host -I. -o fuzz_driver tools/fuzz_driver.cpp
+//       lib/is31fl3731/*.cpp
+//
+// or with -DIS31FL3731_FUZZ_MAIN instead of -fsanitize=fuzzer for AFL.
+
+#include "lib/is31fl3731/is31fl3731.h"
+#include "fuzz_main.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t FUZZ_MAX_OPS = 64;
+
+enum FuzzOp
+{
+    OP_PWM,
+    OP_BURST,
+    OP_RAW_BURST,
+    OP_PIXELS,
+    OP_READ,
+    OP_VERIFY,
+    OP_DRAW_PIXEL,
+    OP_FRAME,
+    OP_AUDIO_SYNC,
+    OP_CLEAR,
+    OP_BUS_FAULT,
+    OP_TRANSFER,
+    OP_SLEEP,
+    OP_POWER_LOSS,
+    OP_REGISTER,
+    OP_LED_CONTROL,
+    OP_SYNC,
+    OP_COUNT,
+};
+
+static void fail(const char* what)
+{
+    fprintf(stderr, "fuzz_driver: %s\n", what);
+    abort();
+}
+
+static void checkChip()
+{
+    const HostChip& chip = HostChip::instance();
+    if(chip.bad_accesses != 0)
+        fail("access outside the register map");
+    if(chip.bank > 7 && chip.bank != HostChip::BANK_FUNCTION)
+        fail("unknown bank selected");
+}
+
+static void expectPWM(uint8_t bank, uint8_t led, const uint8_t* values, uint8_t count)
+{
+    if(memcmp(&HostChip::instance().regs[bank][0x24 + led], values, count) != 0)
+        fail("PWM registers differ from what was written");
+}
+
+static void expectShadow(const IS31FL3731& driver)
+{
+    const HostChip& chip = HostChip::instance();
+    for(uint8_t f = 0; f < 8; f++)
+    {
+        for(uint8_t r = 0; r < ISSI_FRAME_REGS; r++)
+        {
+            if(chip.regs[f][r] != driver.shadowRegister(f, r))
+                fail("frame register differs from the shadow after sync()");
+        }
+    }
+    for(uint8_t r = 0; r < ISSI_FUNCTION_REGS; r++)
+    {
+        if(r != 0x04 && r != 0x07
+           && chip.regs[HostChip::BANK_FUNCTION][r] != driver.shadowRegister(ISSI_BANK_FUNCTIONREG, r))
+            fail("function register differs from the shadow after sync()");
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    FuzzInput in(data, size);
+    HostChip::instance().reset();
+
+    IS31FL3731_StaticTrace<16, 256> trace;
+    IS31FL3731_Wing                 wing;
+    IS31FL3731                      matrix;
+    IS31FL3731&                     driver = in.u8() & 1 ? wing : matrix;
+    if(!driver.begin())
+        fail("begin() failed on a healthy bus");
+    driver.attachTrace(&trace);
+    checkChip();
+
+    for(uint8_t i = 0; i < FUZZ_MAX_OPS && !in.done(); i++)
+    {
+        // Arguments are read into a fixed record first so the input decodes
+        // the same under every compiler.
+        uint8_t op    = in.u8() % OP_COUNT;
+        uint8_t led   = in.u8();
+        uint8_t count = in.u8();
+        uint8_t bank  = in.u8();
+        uint8_t v     = in.u8();
+        int16_t x     = in.coord();
+        int16_t y     = in.coord();
+
+        switch(op)
+        {
+            case OP_PWM:
+                if(driver.setLEDPWM(led, v, bank))
+                    expectPWM(bank, led, &v, 1);
+                break;
+            case OP_BURST:
+            {
+                std::vector<uint8_t> pwm = in.bytes(count);
+                if(driver.setLEDPWMBurst(led, pwm.data(), count, bank))
+                    expectPWM(bank, led, pwm.data(), count < 144 - led ? count : 144 - led);
+                break;
+            }
+            case OP_RAW_BURST:
+            {
+                std::vector<uint8_t> burst = in.bytes(count + 1);
+                burst[0]                   = led;
+                if(driver.writePWMBurst(burst.data(), count, bank))
+                    expectPWM(bank, led - 0x24, &burst[1], count);
+                break;
+            }
+            case OP_PIXELS:
+            {
+                std::vector<uint8_t> raw = in.bytes(count * 2);
+                std::vector<IS31FL3731::Update> updates(count);
+                for(uint8_t j = 0; j < count; j++)
+                    updates[j] = {raw[2 * j], raw[2 * j + 1]};
+                uint8_t frame[144];
+                memcpy(frame, &HostChip::instance().regs[bank & 7][0x24], sizeof(frame));
+                uint8_t sent = driver.writePixels(
+                    updates.empty() ? nullptr : updates.data(), count, bank, v & 1 ? frame : nullptr);
+                // A nonzero count promises every update reached the chip.
+                if(sent > 0)
+                {
+                    for(uint8_t j = 0; j < count; j++)
+                        if(updates[j].led < 144)
+                            frame[updates[j].led] = updates[j].pwm;
+                    expectPWM(bank, 0, frame, sizeof(frame));
+                }
+                break;
+            }
+            case OP_READ:
+            {
+                std::vector<uint8_t> pwm(count == 0 ? 1 : count);
+                if(driver.readPWM(led, pwm.data(), count, bank))
+                    expectPWM(bank, led, pwm.data(), count);
+                break;
+            }
+            case OP_VERIFY:
+            {
+                std::vector<uint8_t> expected = in.bytes(count);
+                driver.verifyPWM(led, expected.data(), count, bank);
+                break;
+            }
+            case OP_DRAW_PIXEL: driver.drawPixel(x, y, (uint16_t)(v << 1) | (count & 1)); break;
+            case OP_FRAME:
+                driver.setFrame(bank);
+                driver.displayFrame(led);
+                break;
+            case OP_AUDIO_SYNC: driver.audioSync(v & 1); break;
+            case OP_CLEAR: driver.clear(); break;
+            case OP_BUS_FAULT: HostChip::instance().fail_next = v % 8; break;
+            case OP_TRANSFER:
+            {
+                IS31FL3731::TransferConfig cfg;
+                cfg.Defaults();
+                cfg.retries     = v % 4;
+                cfg.recover_bus = count & 1;
+                driver.setTransferConfig(cfg);
+                break;
+            }
+            case OP_SLEEP:
+            {
+                if(v & 1)
+                {
+                    driver.sleep();
+                    break;
+                }
+                // wake() is one write of the shutdown register plus at
+                // most one bank select, however much else is still dirty.
+                bool     clean        = HostChip::instance().fail_next == 0;
+                uint32_t transactions = driver.stats().transactions;
+                uint32_t switches     = driver.stats().bank_switches;
+                bool     ok           = driver.wake();
+                switches              = driver.stats().bank_switches - switches;
+                transactions          = driver.stats().transactions - transactions;
+                if(clean && (!ok || switches > 1 || transactions != 1 + switches))
+                    fail("wake() sent more than the shutdown register");
+                if(ok && (HostChip::instance().regs[HostChip::BANK_FUNCTION][ISSI_REG_SHUTDOWN] & 1) == 0)
+                    fail("wake() left the chip shut down");
+                break;
+            }
+            case OP_POWER_LOSS:
+            {
+                // Everything but the PWM values of one bank is lost; those
+                // stand in for the caller's shadow copy.
+                HostChip& chip = HostChip::instance();
+                uint8_t   frame[144];
+                uint8_t   fail_next = chip.fail_next;
+                memcpy(frame, &chip.regs[bank & 7][0x24], sizeof(frame));
+                chip.reset();
+                chip.fail_next = fail_next;
+                if(driver.restore(frame, bank & 7))
+                {
+                    expectPWM(bank & 7, 0, frame, sizeof(frame));
+                    if((chip.regs[HostChip::BANK_FUNCTION][ISSI_REG_SHUTDOWN] & 1) != (driver.asleep() ? 0 : 1))
+                        fail("restore() left the chip in the wrong shutdown state");
+                    expectShadow(driver);
+                }
+                break;
+            }
+            case OP_REGISTER:
+                // Mostly the function bank, where the interesting registers are.
+                driver.setRegister(count & 1 ? bank & 7 : ISSI_BANK_FUNCTIONREG, led, v);
+                break;
+            case OP_LED_CONTROL:
+                if(v & 1)
+                    driver.setLEDBlink(led, v & 2, bank);
+                else
+                    driver.setLEDEnabled(led, v & 2, bank);
+                break;
+            case OP_SYNC:
+                if(driver.sync())
+                {
+                    if(driver.shadowDirty())
+                        fail("sync() succeeded but left registers dirty");
+                    expectShadow(driver);
+                }
+                break;
+        }
+        checkChip();
+    }
+
+    std::vector<uint8_t> out(trace.serializedSize());
+    if(trace.serialize(out.data(), out.size()) != out.size())
+        fail("trace serialization size mismatch");
+    return 0;
+}
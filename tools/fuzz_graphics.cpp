@@ -0,0 +1,280 @@
+// Fuzz harness for IS31FL3731_Graphics: the input is turned into a
+// sequence of draw calls, clip, target and layer changes, and update()s
+// against the host chip model in tools/host. Every buffer the library
+// touches is sized exactly on the heap so AddressSanitizer reports any
+// access past the framebuffer, a canvas or a bitmap, and the run aborts
+// when the chip model sees a register or bank outside the IS31FL3731's
+// map, or when a clean update() leaves the chip disagreeing with the
+// framebuffer.
+//
+// libFuzzer:
+//   clang++ -g -O1 -std=gnu++14 -fsanitize=fuzzer,address,undefined
+//       -Itools/host -I. -o fuzz_graphics tools/fuzz_graphics.cpp
+//       lib/is31fl3731/*.cpp lib/is31fl3731_graphics/*.cpp
+//   ./fuzz_graphics -max_len=512 corpus/
+//
+// AFL, or replaying a crash: the same with -DIS31FL3731_FUZZ_MAIN and
+// without -fsanitize=fuzzer (afl-clang-fast++ as the compiler for AFL);
+// the binary then runs each file argument, or stdin, once.
+
+#include "lib/is31fl3731/is31fl3731.h"
+#include "lib/is31fl3731_graphics/IS31FL3731_Graphics.h"
+#include "fuzz_main.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t FUZZ_MAX_OPS = 64;
+
+// Driver geometries, including ones Init() has to refuse.
+static const uint8_t FUZZ_SIZES[][2] = {{16, 9}, {15, 7}, {8, 8}, {12, 12}, {16, 10}, {0, 9}};
+
+enum FuzzOp
+{
+    OP_PIXEL,
+    OP_LINE,
+    OP_HLINE,
+    OP_VLINE,
+    OP_RECT,
+    OP_CIRCLE,
+    OP_TRIANGLE,
+    OP_ELLIPSE,
+    OP_ROUND_RECT,
+    OP_BITMAP,
+    OP_GRAYSCALE,
+    OP_CANVAS,
+    OP_SCROLL,
+    OP_TEXT,
+    OP_FILL,
+    OP_FADE,
+    OP_TARGET,
+    OP_CLIP,
+    OP_LAYER,
+    OP_LAYER_STATE,
+    OP_PUBLISH,
+    OP_BUS_FAULT,
+    OP_UPDATE,
+    OP_VERIFY,
+    OP_COUNT,
+};
+
+struct FuzzCanvas
+{
+    std::vector<uint8_t> pixels;
+    IS31FL3731_Canvas    canvas;
+};
+
+static void fail(const char* what)
+{
+    fprintf(stderr, "fuzz_graphics: %s\n", what);
+    abort();
+}
+
+static void checkChip()
+{
+    if(HostChip::instance().bad_accesses != 0)
+        fail("access outside the register map");
+}
+
+static void makeCanvas(FuzzInput& in, FuzzCanvas& c)
+{
+    static const IS31FL3731_PixelFormat formats[]
+        = {IS31FL3731_PixelFormat::GRAY8, IS31FL3731_PixelFormat::GRAY4, IS31FL3731_PixelFormat::MONO1};
+    uint16_t               w      = 1 + in.u8() % 24;
+    uint16_t               h      = 1 + in.u8() % 12;
+    IS31FL3731_PixelFormat format = formats[in.u8() % 3];
+
+    c.pixels.assign(IS31FL3731_Canvas::bufferSize(w, h, format), 0);
+    c.canvas = IS31FL3731_Canvas(c.pixels.data(), w, h, format);
+}
+
+// After a update() without bus errors the chip holds the output buffer.
+static void checkOutput(IS31FL3731_Graphics& g, uint8_t frame)
+{
+    IS31FL3731_Canvas* target = g.target();
+    g.setTarget(nullptr);
+    const uint8_t* out = g.target()->pixels();
+    g.setTarget(target);
+
+    if(memcmp(&HostChip::instance().regs[frame][0x24], out, g.width() * g.height()) != 0)
+        fail("chip differs from the framebuffer after update()");
+}
+
+static void update(IS31FL3731_Graphics& g, const IS31FL3731& driver, uint8_t frame)
+{
+    uint32_t failures = driver.busStats().failures;
+    g.update();
+    checkChip();
+    if(driver.busStats().failures == failures)
+        checkOutput(g, frame);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    FuzzInput in(data, size);
+    HostChip::instance().reset();
+
+    const uint8_t* dims = FUZZ_SIZES[in.u8() % (sizeof(FUZZ_SIZES) / sizeof(FUZZ_SIZES[0]))];
+    IS31FL3731     driver(dims[0], dims[1]);
+    if(!driver.begin())
+        fail("begin() failed on a healthy bus");
+
+    IS31FL3731_Graphics         g;
+    IS31FL3731_Graphics::Config cfg;
+    cfg.Defaults();
+    cfg.driver          = &driver;
+    cfg.frame           = in.u8() % 10;
+    cfg.verify_interval = in.u8() % 4;
+    if(!g.Init(cfg))
+    {
+        checkChip();
+        return 0;
+    }
+
+    FuzzCanvas canvases[3];
+    for(FuzzCanvas& c : canvases)
+        makeCanvas(in, c);
+
+    IS31FL3731_FrameQueue queue;
+    queue.Init(g.width(), g.height());
+
+    for(uint8_t i = 0; i < FUZZ_MAX_OPS && !in.done(); i++)
+    {
+        // Every call takes its arguments from the same fixed-size record,
+        // read up front: argument evaluation order differs between
+        // compilers, and a crash found under libFuzzer has to replay the
+        // same way in a gcc build.
+        uint8_t op = in.u8() % OP_COUNT;
+        uint8_t v  = in.u8();
+        uint8_t f  = in.u8();
+        uint8_t b  = in.u8();
+        int16_t a[7];
+        for(int16_t& c : a)
+            c = in.coord();
+
+        switch(op)
+        {
+            case OP_PIXEL: g.setPixel(a[0], a[1], v); break;
+            case OP_LINE: g.drawLine(a[0], a[1], a[2], a[3], v); break;
+            case OP_HLINE: g.drawHLine(a[0], a[1], a[2], v); break;
+            case OP_VLINE: g.drawVLine(a[0], a[1], a[2], v); break;
+            case OP_RECT: g.drawRect(a[0], a[1], a[2], a[3], v, f & 1); break;
+            case OP_CIRCLE: g.drawCircle(a[0], a[1], a[2], v, f & 1); break;
+            case OP_TRIANGLE: g.drawTriangle(a[0], a[1], a[2], a[3], a[4], a[5], v, f & 1); break;
+            case OP_ELLIPSE: g.drawEllipse(a[0], a[1], a[2], a[3], v, f & 1); break;
+            case OP_ROUND_RECT: g.drawRoundRect(a[0], a[1], a[2], a[3], a[4], v, f & 1); break;
+            case OP_BITMAP:
+            case OP_GRAYSCALE:
+            {
+                // Bitmaps are small, but placed anywhere.
+                int16_t w    = (int16_t)(f % 28) - 4;
+                int16_t h    = (int16_t)(b % 16) - 4;
+                size_t  bits = w > 0 && h > 0 ? (size_t)((w + 7) / 8) * h : 0;
+                size_t  gray = w > 0 && h > 0 ? (size_t)w * h : 0;
+                std::vector<uint8_t> bitmap = in.bytes(op == OP_BITMAP ? bits : gray);
+                std::vector<uint8_t> mask   = in.bytes(op == OP_BITMAP ? 0 : bits);
+                const uint8_t*       ptr    = bitmap.empty() ? nullptr : bitmap.data();
+                const uint8_t*       mptr   = mask.empty() ? nullptr : mask.data();
+                switch(a[2] & 3)
+                {
+                    case 0:
+                        if(op == OP_BITMAP)
+                            g.drawBitmap(a[0], a[1], ptr, w, h, v);
+                        else
+                            g.drawGrayscaleBitmap(a[0], a[1], ptr, w, h);
+                        break;
+                    case 1:
+                        if(op == OP_BITMAP)
+                            g.drawBitmap(a[0], a[1], ptr, w, h, v, a[3]);
+                        else
+                            g.drawGrayscaleBitmap(a[0], a[1], ptr, w, h, a[3]);
+                        break;
+                    default:
+                        if(op == OP_BITMAP)
+                            g.drawBitmap(a[0], a[1], ptr, w, h, v, a[3]);
+                        else
+                            g.drawGrayscaleBitmap(a[0], a[1], ptr, mptr, w, h);
+                        break;
+                }
+                break;
+            }
+            case OP_CANVAS:
+                g.drawCanvas(a[0], a[1], &canvases[v % 3].canvas, a[2], a[3], a[4], a[5]);
+                break;
+            case OP_SCROLL:
+                if(f & 1)
+                    g.scroll(a[0], a[1], v);
+                else
+                    g.scrollRect(a[0], a[1], a[2], a[3], a[4], a[5], v);
+                break;
+            case OP_TEXT:
+            {
+                std::vector<uint8_t> text = in.bytes(b % 12);
+                text.push_back(0);
+                g.setFont(f & 1 ? &IS31FL3731_FONT_3X5 : nullptr);
+                g.drawText(a[0], a[1], (const char*)text.data(), v);
+                g.textWidth((const char*)text.data());
+                break;
+            }
+            case OP_FILL:
+                if(f & 1)
+                    g.fill(v);
+                else
+                    g.clear();
+                break;
+            case OP_FADE:
+                // Both fade through update() until they reach the target.
+                if(f & 1)
+                    g.fadeAll(v, b);
+                else
+                    g.fadePixel(a[0], a[1], v, b);
+                break;
+            case OP_TARGET:
+                switch(v % 5)
+                {
+                    case 3: g.setTarget(queue.back()); break;
+                    case 4: g.setTarget(nullptr); break;
+                    default: g.setTarget(&canvases[v % 5].canvas); break;
+                }
+                break;
+            case OP_CLIP:
+                switch(f % 3)
+                {
+                    case 0: g.setClip(a[0], a[1], a[2], a[3]); break;
+                    case 1: g.setViewport(a[0], a[1], a[2], a[3]); break;
+                    default: g.resetClip(); break;
+                }
+                break;
+            case OP_LAYER:
+                if(f & 1)
+                    g.removeLayer(&canvases[v % 3].canvas);
+                else
+                    g.addLayer(&canvases[v % 3].canvas);
+                break;
+            case OP_LAYER_STATE:
+            {
+                IS31FL3731_Canvas& c = canvases[v % 3].canvas;
+                c.setOffset(a[0], a[1]);
+                c.setOpacity(b);
+                c.setBlend((IS31FL3731_Canvas::Blend)(f % 5));
+                c.setVisible(f & 0x80);
+                break;
+            }
+            case OP_PUBLISH:
+                if(f & 1)
+                    g.attachFrameQueue(f & 2 ? &queue : nullptr);
+                queue.publish();
+                break;
+            case OP_BUS_FAULT: HostChip::instance().fail_next = v % 8; break;
+            case OP_UPDATE: update(g, driver, cfg.frame); break;
+            case OP_VERIFY: g.verify(); break;
+        }
+        checkChip();
+    }
+
+    // Whatever the sequence left behind has to reach the chip intact.
+    HostChip::instance().fail_next = 0;
+    g.setTarget(nullptr);
+    update(g, driver, cfg.frame);
+    update(g, driver, cfg.frame);
+    return 0;
+}
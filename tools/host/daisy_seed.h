@@ -0,0 +1,209 @@
+// Host stand-in for the few libDaisy pieces the driver uses, so the driver
+// and the graphics library build on Linux for the tools in tools/. Put
+// tools/host first on the include path:
+//
+//   g++ -std=gnu++14 -Itools/host -I. ... lib/is31fl3731/*.cpp
+//
+// I2C transactions go to HostChip, a register model of one IS31FL3731 that
+// also counts anything the real chip would reject.
+
+#ifndef IS31FL3731_HOST_DAISY_SEED_H
+#define IS31FL3731_HOST_DAISY_SEED_H
+
+#include <chrono>
+#include <stdint.h>
+#include <string.h>
+
+enum dsy_gpio_port
+{
+    DSY_GPIOA,
+    DSY_GPIOB,
+    DSY_GPIOC,
+    DSY_GPIOD,
+    DSY_GPIOX,
+};
+
+namespace daisy
+{
+struct Pin
+{
+    dsy_gpio_port port;
+    uint8_t       pin;
+};
+
+struct HostChip
+{
+    static const uint8_t BANK_FUNCTION     = 0x0B;
+    static const uint8_t LAST_FRAME_REG    = 0xB3;
+    static const uint8_t LAST_FUNCTION_REG = 0x0C;
+
+    uint8_t  regs[BANK_FUNCTION + 1][256];
+    uint8_t  bank;
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t bad_accesses; // unknown banks, registers past the end
+    uint32_t fail_next;    // fail this many transactions before the next success
+
+    static HostChip& instance()
+    {
+        static HostChip chip;
+        return chip;
+    }
+
+    void reset() { memset(this, 0, sizeof(*this)); }
+
+    // Registers reg .. reg + count - 1 of the selected bank, or nullptr.
+    uint8_t* access(uint8_t reg, uint16_t count)
+    {
+        uint8_t last = bank == BANK_FUNCTION ? LAST_FUNCTION_REG : LAST_FRAME_REG;
+        if((bank > 7 && bank != BANK_FUNCTION) || count == 0 || reg + count - 1 > last)
+        {
+            bad_accesses++;
+            return nullptr;
+        }
+        return &regs[bank][reg];
+    }
+};
+
+class I2CHandle
+{
+  public:
+    struct Config
+    {
+        enum class Peripheral
+        {
+            I2C_1,
+            I2C_2,
+            I2C_3,
+            I2C_4,
+        };
+        enum class Mode
+        {
+            I2C_MASTER,
+            I2C_SLAVE,
+        };
+        enum class Speed
+        {
+            I2C_100KHZ,
+            I2C_400KHZ,
+            I2C_1MHZ,
+        };
+
+        Peripheral periph;
+        Mode       mode;
+        Speed      speed;
+        struct
+        {
+            Pin scl;
+            Pin sda;
+        } pin_config;
+    };
+
+    enum class Result
+    {
+        OK,
+        ERR,
+    };
+
+    Result Init(const Config& config)
+    {
+        config_ = config;
+        return Result::OK;
+    }
+    const Config& GetConfig() const { return config_; }
+
+    Result TransmitBlocking(uint16_t address, uint8_t* data, uint16_t size, uint32_t timeout)
+    {
+        HostChip& chip = HostChip::instance();
+        if(!begin(chip, size))
+            return Result::ERR;
+        if(size < 2)
+        {
+            chip.bad_accesses++;
+            return Result::OK;
+        }
+        if(data[0] == 0xFD)
+        {
+            chip.bank = data[1];
+            if(size != 2 || (chip.bank > 7 && chip.bank != HostChip::BANK_FUNCTION))
+                chip.bad_accesses++;
+            return Result::OK;
+        }
+        uint8_t* regs = chip.access(data[0], size - 1);
+        if(regs != nullptr)
+            memcpy(regs, data + 1, size - 1);
+        return Result::OK;
+    }
+
+    Result ReadDataAtAddress(uint16_t address,
+                             uint16_t mem_address,
+                             uint16_t mem_address_size,
+                             uint8_t* data,
+                             uint16_t size,
+                             uint32_t timeout)
+    {
+        HostChip& chip = HostChip::instance();
+        if(!begin(chip, size + 1))
+            return Result::ERR;
+        uint8_t* regs = chip.access(mem_address, size);
+        if(regs != nullptr)
+            memcpy(data, regs, size);
+        else
+            memset(data, 0, size);
+        return Result::OK;
+    }
+
+  private:
+    Config config_;
+
+    static bool begin(HostChip& chip, uint16_t bytes)
+    {
+        if(chip.fail_next > 0)
+        {
+            chip.fail_next--;
+            return false;
+        }
+        chip.transactions++;
+        chip.bytes += bytes;
+        return true;
+    }
+};
+
+class GPIO
+{
+  public:
+    enum class Mode
+    {
+        INPUT,
+        OUTPUT,
+        OPEN_DRAIN,
+        ANALOG,
+    };
+    enum class Pull
+    {
+        NOPULL,
+        PULLUP,
+        PULLDOWN,
+    };
+
+    void Init(Pin pin, Mode mode, Pull pull = Pull::NOPULL) {}
+    bool Read() { return true; } // the model never holds SDA low
+    void Write(bool state) {}
+};
+
+class System
+{
+  public:
+    static void     Delay(uint32_t ms) {}
+    static void     DelayUs(uint32_t us) {}
+    static uint32_t GetNow() { return GetUs() / 1000; }
+    static uint32_t GetUs()
+    {
+        return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+};
+} // namespace daisy
+
+#endif
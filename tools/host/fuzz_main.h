@@ -0,0 +1,85 @@
+// Entry point for the fuzz harnesses in tools/ when they are not linked
+// against libFuzzer (AFL, or replaying a crash by hand): define
+// IS31FL3731_FUZZ_MAIN and every file named on the command line, or stdin
+// without any, is run through LLVMFuzzerTestOneInput() once.
+
+#ifndef IS31FL3731_HOST_FUZZ_MAIN_H
+#define IS31FL3731_HOST_FUZZ_MAIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+#ifdef IS31FL3731_FUZZ_MAIN
+static void fuzzRunFile(FILE* f)
+{
+    std::vector<uint8_t> input;
+    uint8_t              chunk[4096];
+    size_t               n;
+    while((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        input.insert(input.end(), chunk, chunk + n);
+    LLVMFuzzerTestOneInput(input.data(), input.size());
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        fuzzRunFile(stdin);
+        return 0;
+    }
+
+    for(int i = 1; i < argc; i++)
+    {
+        FILE* f = fopen(argv[i], "rb");
+        if(f == nullptr)
+        {
+            fprintf(stderr, "cannot open %s\n", argv[i]);
+            return 1;
+        }
+        fuzzRunFile(f);
+        fclose(f);
+    }
+    return 0;
+}
+#endif
+
+// Reads the fuzz input as a stream of arguments; past the end it yields
+// zeros. Coordinates are usually small so most calls land on or near the
+// display, and sometimes raw 16-bit values to reach the int16_t extremes.
+class FuzzInput
+{
+  public:
+    FuzzInput(const uint8_t* data, size_t size) : data_(data), size_(size), pos_(0) {}
+
+    bool     done() const { return pos_ >= size_; }
+    uint8_t  u8() { return pos_ < size_ ? data_[pos_++] : 0; }
+    uint16_t u16() { return u8() | (u8() << 8); }
+    int16_t  coord()
+    {
+        uint8_t mode = u8();
+        if(mode < 0xC0)
+            return (int16_t)(mode % 40) - 12;
+        return (int16_t)u16();
+    }
+
+    // A copy of the next n bytes on the heap, sized exactly, so the
+    // sanitizers see any read past what the caller handed in.
+    std::vector<uint8_t> bytes(size_t n)
+    {
+        std::vector<uint8_t> out(n);
+        for(size_t i = 0; i < n; i++)
+            out[i] = u8();
+        return out;
+    }
+
+  private:
+    const uint8_t* data_;
+    size_t         size_;
+    size_t         pos_;
+};
+
+#endif
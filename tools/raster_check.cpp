@@ -0,0 +1,900 @@
+// Renders a randomized corpus of draw calls through IS31FL3731_Graphics on
+// a Linux host and checks every case three ways:
+//
+//  - against a slow reference rasterizer that plots each primitive pixel by
+//    pixel with a bounds and clip check, so a faster implementation (span fills,
+//    integer triangles, fixed-point ellipses) must match it exactly;
+//  - that every pixel a call changed lies inside the dirty region, and that
+//    update() leaves the chip model holding exactly the framebuffer;
+//  - against golden frame hashes: by default the ones committed in
+//    tools/raster_check.golden, otherwise a file recorded with --record.
+//
+//   g++ -O2 -std=gnu++14 -Itools/host -I. -o raster_check tools/raster_check.cpp
+//       lib/is31fl3731/*.cpp lib/is31fl3731_graphics/*.cpp
+//   ./raster_check [-n cases] [-s seed] [--record golden.bin | --check golden.bin]
+//
+// The corpus mixes on-screen, off-screen, clipped and degenerate geometry
+// (zero and negative sizes, radii larger than the display), drawn with and
+// without a clip rectangle or viewport. Run from the repository root with
+// no options it checks the default corpus (seed 1, 20000 cases) against
+// tools/raster_check.golden; -n or -s run a different corpus without a
+// golden file. Re-record the committed file only for an intended change
+// in output:
+//
+//   ./raster_check --record tools/raster_check.golden
+//
+// The exit status is 1 if any check failed.
+
+#include "lib/is31fl3731/is31fl3731.h"
+#include "lib/is31fl3731_graphics/IS31FL3731_Graphics.h"
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static const int WIDTH  = 16;
+static const int HEIGHT = 9;
+
+enum OpType
+{
+    PIXEL,
+    FILL,
+    LINE,
+    HLINE,
+    VLINE,
+    RECT,
+    FILL_RECT,
+    CIRCLE,
+    FILL_CIRCLE,
+    TRIANGLE,
+    FILL_TRIANGLE,
+    ELLIPSE,
+    FILL_ELLIPSE,
+    ROUND_RECT,
+    FILL_ROUND_RECT,
+    BITMAP,
+    BITMAP_OPAQUE,
+    GRAY_BITMAP,
+    GRAY_TRANSPARENT,
+    GRAY_MASKED,
+    SCROLL_RECT,
+    SCROLL,
+    CANVAS,
+    TEXT,
+    SET_CLIP,
+    SET_VIEWPORT,
+    RESET_CLIP,
+    OP_COUNT,
+};
+
+static const char* OP_NAMES[OP_COUNT] = {
+    "setPixel",      "fill",          "drawLine",      "drawHLine",
+    "drawVLine",     "drawRect",      "fillRect",      "drawCircle",
+    "fillCircle",    "drawTriangle",  "fillTriangle",  "drawEllipse",
+    "fillEllipse",   "drawRoundRect", "fillRoundRect", "drawBitmap",
+    "drawBitmapBg",  "drawGrayscale", "drawGrayTransp", "drawGrayMasked",
+    "scrollRect",    "scroll",        "drawCanvas",    "drawText",
+    "setClip",       "setViewport",   "resetClip",
+};
+
+struct Op
+{
+    OpType               type;
+    int                  a[7];
+    uint8_t              value;
+    std::vector<uint8_t> data; // bitmap or text
+    std::vector<uint8_t> mask;
+};
+
+class Random
+{
+  public:
+    explicit Random(uint32_t seed) : state_(seed ? seed : 1) {}
+
+    uint32_t next()
+    {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 17;
+        state_ ^= state_ << 5;
+        return state_;
+    }
+    // Uniform in [lo, hi].
+    int range(int lo, int hi) { return lo + (int)(next() % (uint32_t)(hi - lo + 1)); }
+    // Mostly near the display, sometimes far off it.
+    int coord(int size) { return next() % 8 == 0 ? range(-60, 60) : range(-6, size + 5); }
+    int extent() { return next() % 8 == 0 ? range(-20, 40) : range(-2, 14); }
+
+  private:
+    uint32_t state_;
+};
+
+// Slow rasterizer: every primitive reduced to bounds-checked plots.
+// Coordinates are relative to the origin; the clip is kept in display
+// coordinates, already intersected with the display.
+class Reference
+{
+  public:
+    Reference()
+    {
+        memset(px_, 0, sizeof(px_));
+        resetClip();
+    }
+
+    uint8_t*       pixels() { return px_; }
+    const uint8_t* pixels() const { return px_; }
+
+    void setClip(int x, int y, int w, int h)
+    {
+        clip_[0] = std::max(x, 0);
+        clip_[1] = std::max(y, 0);
+        clip_[2] = std::min(x + w, WIDTH);
+        clip_[3] = std::min(y + h, HEIGHT);
+    }
+
+    void setViewport(int x, int y, int w, int h)
+    {
+        ox_ = x;
+        oy_ = y;
+        setClip(x, y, w, h);
+    }
+
+    void resetClip()
+    {
+        ox_ = oy_ = 0;
+        setClip(0, 0, WIDTH, HEIGHT);
+    }
+
+    void plot(int x, int y, uint8_t v)
+    {
+        x += ox_;
+        y += oy_;
+        if(x >= clip_[0] && x < clip_[2] && y >= clip_[1] && y < clip_[3])
+            px_[x + y * WIDTH] = v;
+    }
+
+    void fill(uint8_t v)
+    {
+        for(int y = clip_[1] - oy_; y < clip_[3] - oy_; y++)
+            hline(clip_[0] - ox_, y, clip_[2] - clip_[0], v);
+    }
+
+    void hline(int x, int y, int w, uint8_t v)
+    {
+        for(int i = 0; i < w; i++)
+            plot(x + i, y, v);
+    }
+
+    void line(int x1, int y1, int x2, int y2, uint8_t v)
+    {
+        int dx  = abs(x2 - x1);
+        int dy  = abs(y2 - y1);
+        int sx  = x1 < x2 ? 1 : -1;
+        int sy  = y1 < y2 ? 1 : -1;
+        int err = dx - dy;
+        while(true)
+        {
+            plot(x1, y1, v);
+            if(x1 == x2 && y1 == y2)
+                break;
+            int e2 = 2 * err;
+            if(e2 > -dy)
+            {
+                err -= dy;
+                x1 += sx;
+            }
+            if(e2 < dx)
+            {
+                err += dx;
+                y1 += sy;
+            }
+        }
+    }
+
+    void rect(int x, int y, int w, int h, uint8_t v, bool fill)
+    {
+        if(fill)
+        {
+            for(int j = 0; j < h; j++)
+                hline(x, y + j, w, v);
+            return;
+        }
+        line(x, y, x + w - 1, y, v);
+        line(x + w - 1, y, x + w - 1, y + h - 1, v);
+        line(x + w - 1, y + h - 1, x, y + h - 1, v);
+        line(x, y + h - 1, x, y, v);
+    }
+
+    // Midpoint circle, plotted as octants or as spans between them.
+    void circle(int cx, int cy, int r, uint8_t v, bool fill)
+    {
+        int x = 0, y = r, err = 1 - r;
+        while(y >= x)
+        {
+            if(fill)
+            {
+                hline(cx - x, cy - y, 2 * x + 1, v);
+                hline(cx - x, cy + y, 2 * x + 1, v);
+                hline(cx - y, cy - x, 2 * y + 1, v);
+                hline(cx - y, cy + x, 2 * y + 1, v);
+            }
+            else
+            {
+                int pts[8][2] = {{x, -y}, {-x, -y}, {x, y}, {-x, y}, {y, -x}, {-y, -x}, {y, x}, {-y, x}};
+                for(int i = 0; i < 8; i++)
+                    plot(cx + pts[i][0], cy + pts[i][1], v);
+            }
+            if(err < 0)
+                err += 2 * x + 3;
+            else
+            {
+                y--;
+                err += 2 * (x - y) + 5;
+            }
+            x++;
+        }
+    }
+
+    // Scanline fill: each row spans the leftmost to the rightmost edge
+    // crossing, edges half-open at their lower end.
+    void triangle(const int* c, uint8_t v, bool fill)
+    {
+        if(!fill)
+        {
+            line(c[0], c[1], c[2], c[3], v);
+            line(c[2], c[3], c[4], c[5], v);
+            line(c[4], c[5], c[0], c[1], v);
+            return;
+        }
+        int min_y = std::min(std::min(c[1], c[3]), c[5]);
+        int max_y = std::max(std::max(c[1], c[3]), c[5]);
+        for(int y = min_y; y <= max_y; y++)
+        {
+            int  lo = INT32_MAX, hi = INT32_MIN;
+            bool found = false;
+            for(int i = 0; i < 3; i++)
+            {
+                int j  = (i + 1) % 3;
+                int xa = c[2 * i], ya = c[2 * i + 1];
+                int xb = c[2 * j], yb = c[2 * j + 1];
+                if((y >= ya && y < yb) || (y >= yb && y < ya))
+                {
+                    float t = (float)(y - ya) / (yb - ya);
+                    int   x = xa + (int)(t * (xb - xa));
+                    lo      = std::min(lo, x);
+                    hi      = std::max(hi, x);
+                    found   = true;
+                }
+            }
+            if(found)
+                hline(lo, y, hi - lo + 1, v);
+        }
+    }
+
+    // Two-region midpoint ellipse.
+    void ellipse(int cx, int cy, int rx, int ry, uint8_t v, bool fill)
+    {
+        if(rx < 1 || ry < 1)
+            return;
+        int     x = 0, y = ry;
+        int32_t rx2 = rx * rx, ry2 = ry * ry;
+        int32_t p   = ry2 - rx2 * ry + rx2 / 4;
+        while(x * ry2 < y * rx2)
+        {
+            quad(cx, cy, x, y, v, fill);
+            x++;
+            if(p < 0)
+                p += 2 * ry2 * x + ry2;
+            else
+            {
+                y--;
+                p += 2 * ry2 * x - 2 * rx2 * y + ry2;
+            }
+        }
+        p = ry2 * (x + 0.5) * (x + 0.5) + rx2 * (y - 1) * (y - 1) - rx2 * ry2;
+        while(y >= 0)
+        {
+            quad(cx, cy, x, y, v, fill);
+            y--;
+            if(p > 0)
+                p += -2 * rx2 * y + rx2;
+            else
+            {
+                x++;
+                p += 2 * ry2 * x - 2 * rx2 * y + rx2;
+            }
+        }
+    }
+
+    // Corner arcs are centred r in from each corner. Filled, every pixel
+    // of the rectangle is set except those in a corner square farther than
+    // r from its centre; outlined, straight edges run between the arcs,
+    // which are the quadrants of one midpoint circle.
+    void roundRect(int x, int y, int w, int h, int r, uint8_t v, bool fill)
+    {
+        if(w < 1 || h < 1)
+            return;
+        if(r < 0)
+            r = 0;
+        if(r * 2 > w)
+            r = w / 2;
+        if(r * 2 > h)
+            r = h / 2;
+        int x1 = x + r, y1 = y + r, x2 = x + w - 1 - r, y2 = y + h - 1 - r;
+
+        if(fill)
+        {
+            for(int iy = y; iy < y + h; iy++)
+                for(int ix = x; ix < x + w; ix++)
+                {
+                    bool corner = (ix < x1 || ix > x2) && (iy < y1 || iy > y2);
+                    int  dx     = ix - (ix < x1 ? x1 : x2);
+                    int  dy     = iy - (iy < y1 ? y1 : y2);
+                    if(!corner || dx * dx + dy * dy <= r * r)
+                        plot(ix, iy, v);
+                }
+            return;
+        }
+
+        hline(x1, y, x2 - x1 + 1, v);
+        hline(x1, y + h - 1, x2 - x1 + 1, v);
+        for(int iy = y1; iy <= y2; iy++)
+        {
+            plot(x, iy, v);
+            plot(x + w - 1, iy, v);
+        }
+        int cx = 0, cy = r, err = 1 - r;
+        while(cy >= cx)
+        {
+            int pts[2][2] = {{cx, cy}, {cy, cx}};
+            for(int i = 0; i < 2; i++)
+            {
+                plot(x2 + pts[i][0], y1 - pts[i][1], v);
+                plot(x1 - pts[i][0], y1 - pts[i][1], v);
+                plot(x2 + pts[i][0], y2 + pts[i][1], v);
+                plot(x1 - pts[i][0], y2 + pts[i][1], v);
+            }
+            if(err < 0)
+                err += 2 * cx + 3;
+            else
+            {
+                cy--;
+                err += 2 * (cx - cy) + 5;
+            }
+            cx++;
+        }
+    }
+
+    void bitmap(int x, int y, const uint8_t* bits, int w, int h, uint8_t v, uint8_t bg, bool opaque)
+    {
+        int stride = (w + 7) / 8;
+        for(int j = 0; j < h; j++)
+            for(int i = 0; i < w; i++)
+            {
+                if(bits[j * stride + (i >> 3)] & (0x80 >> (i & 7)))
+                    plot(x + i, y + j, v);
+                else if(opaque)
+                    plot(x + i, y + j, bg);
+            }
+    }
+
+    void gray(int x, int y, const uint8_t* src, const uint8_t* mask, int w, int h, int transparent)
+    {
+        int stride = (w + 7) / 8;
+        for(int j = 0; j < h; j++)
+            for(int i = 0; i < w; i++)
+            {
+                uint8_t v = src[i + j * w];
+                if(mask != nullptr && !(mask[j * stride + (i >> 3)] & (0x80 >> (i & 7))))
+                    continue;
+                if(transparent >= 0 && v == transparent)
+                    continue;
+                plot(x + i, y + j, v);
+            }
+    }
+
+    // Every pixel of the clipped region takes the value dx, dy behind it,
+    // or fill where that lies outside the region.
+    void scrollRect(int x, int y, int w, int h, int dx, int dy, uint8_t fill)
+    {
+        int x0 = std::max(x + ox_, clip_[0]), y0 = std::max(y + oy_, clip_[1]);
+        int x1 = std::min(x + ox_ + w, clip_[2]), y1 = std::min(y + oy_ + h, clip_[3]);
+        if(x1 <= x0 || y1 <= y0 || (dx == 0 && dy == 0))
+            return;
+        uint8_t old[WIDTH * HEIGHT];
+        memcpy(old, px_, sizeof(old));
+        for(int py = y0; py < y1; py++)
+            for(int px = x0; px < x1; px++)
+            {
+                int sx = px - dx, sy = py - dy;
+                bool inside = sx >= x0 && sx < x1 && sy >= y0 && sy < y1;
+                px_[px + py * WIDTH] = inside ? old[sx + sy * WIDTH] : fill;
+            }
+    }
+
+    void canvas(int x, int y, const uint8_t* src, int src_w, int src_h, int sx, int sy, int w, int h)
+    {
+        for(int j = 0; j < h; j++)
+            for(int i = 0; i < w; i++)
+            {
+                int u = sx + i, t = sy + j;
+                if(u >= 0 && u < src_w && t >= 0 && t < src_h)
+                    plot(x + i, y + j, src[u + t * src_w]);
+            }
+    }
+
+    void scroll(int dx, int dy, uint8_t fill)
+    {
+        scrollRect(clip_[0] - ox_, clip_[1] - oy_, clip_[2] - clip_[0], clip_[3] - clip_[1], dx, dy, fill);
+    }
+
+    void text(int x, int y, const char* s, uint8_t v, const IS31FL3731_Font* font)
+    {
+        for(; *s != '\0'; s++, x += font->width + font->spacing)
+        {
+            char c = *s;
+            if(c < font->first || c > font->last)
+                c = '?';
+            if(c < font->first || c > font->last)
+                continue;
+            const uint8_t* glyph = &font->glyphs[(c - font->first) * font->width];
+            for(int i = 0; i < font->width; i++)
+                for(int j = 0; j < font->height; j++)
+                    if(glyph[i] & (1 << j))
+                        plot(x + i, y + j, v);
+        }
+    }
+
+  private:
+    uint8_t px_[WIDTH * HEIGHT];
+    int     clip_[4]; // x0, y0, x1, y1
+    int     ox_, oy_;
+
+    void quad(int cx, int cy, int x, int y, uint8_t v, bool fill)
+    {
+        if(fill)
+        {
+            hline(cx - x, cy - y, 2 * x + 1, v);
+            hline(cx - x, cy + y, 2 * x + 1, v);
+            return;
+        }
+        plot(cx + x, cy - y, v);
+        plot(cx - x, cy - y, v);
+        plot(cx + x, cy + y, v);
+        plot(cx - x, cy + y, v);
+    }
+};
+
+static uint8_t  canvas_pixels[10 * 6];
+static const int CANVAS_W = 10;
+static const int CANVAS_H = 6;
+
+static Op randomOp(Random& rng)
+{
+    Op op;
+    op.type  = (OpType)rng.range(0, OP_COUNT - 1);
+    op.value = rng.range(1, 255);
+    for(int i = 0; i < 7; i++)
+        op.a[i] = 0;
+
+    switch(op.type)
+    {
+        case PIXEL: op.a[0] = rng.coord(WIDTH), op.a[1] = rng.coord(HEIGHT); break;
+        case FILL: break;
+        case LINE:
+        case TRIANGLE:
+        case FILL_TRIANGLE:
+            for(int i = 0; i < 6; i += 2)
+            {
+                op.a[i]     = rng.coord(WIDTH);
+                op.a[i + 1] = rng.coord(HEIGHT);
+            }
+            break;
+        case HLINE:
+        case VLINE:
+            op.a[0] = rng.coord(WIDTH);
+            op.a[1] = rng.coord(HEIGHT);
+            op.a[2] = rng.extent();
+            break;
+        case CIRCLE:
+        case FILL_CIRCLE:
+            op.a[0] = rng.coord(WIDTH);
+            op.a[1] = rng.coord(HEIGHT);
+            op.a[2] = rng.extent();
+            break;
+        case ELLIPSE:
+        case FILL_ELLIPSE:
+            op.a[0] = rng.coord(WIDTH);
+            op.a[1] = rng.coord(HEIGHT);
+            op.a[2] = rng.extent();
+            op.a[3] = rng.extent();
+            break;
+        case ROUND_RECT:
+        case FILL_ROUND_RECT: op.a[4] = rng.extent(); // fall through
+        case RECT:
+        case FILL_RECT:
+            op.a[0] = rng.coord(WIDTH);
+            op.a[1] = rng.coord(HEIGHT);
+            op.a[2] = rng.extent();
+            op.a[3] = rng.extent();
+            break;
+        case BITMAP:
+        case BITMAP_OPAQUE:
+        case GRAY_BITMAP:
+        case GRAY_TRANSPARENT:
+        case GRAY_MASKED:
+        {
+            op.a[0] = rng.coord(WIDTH);
+            op.a[1] = rng.coord(HEIGHT);
+            op.a[2] = rng.range(0, 20);
+            op.a[3] = rng.range(0, 12);
+            op.a[4] = rng.range(0, 255); // background or transparent value
+            int  w = op.a[2], h = op.a[3];
+            bool packed = op.type == BITMAP || op.type == BITMAP_OPAQUE;
+            op.data.resize(packed ? (w + 7) / 8 * h : w * h);
+            for(auto& b : op.data)
+                b = rng.next() % 4 == 0 ? op.a[4] : rng.next();
+            op.mask.resize((w + 7) / 8 * h);
+            for(auto& b : op.mask)
+                b = rng.next();
+            break;
+        }
+        case SCROLL:
+            op.a[0] = rng.range(-20, 20);
+            op.a[1] = rng.range(-12, 12);
+            break;
+        case SCROLL_RECT:
+            op.a[0] = rng.coord(WIDTH);
+            op.a[1] = rng.coord(HEIGHT);
+            op.a[2] = rng.extent();
+            op.a[3] = rng.extent();
+            op.a[4] = rng.range(-20, 20);
+            op.a[5] = rng.range(-12, 12);
+            break;
+        case CANVAS:
+            op.a[0] = rng.coord(WIDTH);
+            op.a[1] = rng.coord(HEIGHT);
+            op.a[2] = rng.range(-4, CANVAS_W + 2);
+            op.a[3] = rng.range(-4, CANVAS_H + 2);
+            op.a[4] = rng.extent();
+            op.a[5] = rng.extent();
+            break;
+        case TEXT:
+        {
+            op.a[0] = rng.coord(WIDTH);
+            op.a[1] = rng.coord(HEIGHT);
+            op.a[2] = rng.range(0, 1); // font
+            int len = rng.range(0, 6);
+            for(int i = 0; i < len; i++)
+                op.data.push_back(rng.next() % 16 == 0 ? rng.range(1, 255) : rng.range(32, 126));
+            op.data.push_back(0);
+            break;
+        }
+        case SET_CLIP:
+        case SET_VIEWPORT:
+            op.a[0] = rng.coord(WIDTH);
+            op.a[1] = rng.coord(HEIGHT);
+            op.a[2] = rng.extent();
+            op.a[3] = rng.extent();
+            break;
+        default: break;
+    }
+    return op;
+}
+
+static const IS31FL3731_Font* opFont(const Op& op)
+{
+    return op.a[2] ? &IS31FL3731_FONT_3X5 : &IS31FL3731_FONT_5X7;
+}
+
+static void apply(const Op& op, IS31FL3731_Graphics& g, const IS31FL3731_Canvas* src)
+{
+    const int* a = op.a;
+    uint8_t    v = op.value;
+    switch(op.type)
+    {
+        case PIXEL: g.setPixel(a[0], a[1], v); break;
+        case FILL: g.fill(v); break;
+        case LINE: g.drawLine(a[0], a[1], a[2], a[3], v); break;
+        case HLINE: g.drawHLine(a[0], a[1], a[2], v); break;
+        case VLINE: g.drawVLine(a[0], a[1], a[2], v); break;
+        case RECT: g.drawRect(a[0], a[1], a[2], a[3], v); break;
+        case FILL_RECT: g.fillRect(a[0], a[1], a[2], a[3], v); break;
+        case CIRCLE: g.drawCircle(a[0], a[1], a[2], v); break;
+        case FILL_CIRCLE: g.drawCircle(a[0], a[1], a[2], v, true); break;
+        case TRIANGLE: g.drawTriangle(a[0], a[1], a[2], a[3], a[4], a[5], v); break;
+        case FILL_TRIANGLE: g.drawTriangle(a[0], a[1], a[2], a[3], a[4], a[5], v, true); break;
+        case ELLIPSE: g.drawEllipse(a[0], a[1], a[2], a[3], v); break;
+        case FILL_ELLIPSE: g.drawEllipse(a[0], a[1], a[2], a[3], v, true); break;
+        case ROUND_RECT: g.drawRoundRect(a[0], a[1], a[2], a[3], a[4], v); break;
+        case FILL_ROUND_RECT: g.drawRoundRect(a[0], a[1], a[2], a[3], a[4], v, true); break;
+        case BITMAP: g.drawBitmap(a[0], a[1], op.data.data(), a[2], a[3], v); break;
+        case BITMAP_OPAQUE: g.drawBitmap(a[0], a[1], op.data.data(), a[2], a[3], v, a[4]); break;
+        case GRAY_BITMAP: g.drawGrayscaleBitmap(a[0], a[1], op.data.data(), a[2], a[3]); break;
+        case GRAY_TRANSPARENT:
+            g.drawGrayscaleBitmap(a[0], a[1], op.data.data(), a[2], a[3], a[4]);
+            break;
+        case GRAY_MASKED:
+            g.drawGrayscaleBitmap(a[0], a[1], op.data.data(), op.mask.data(), a[2], a[3]);
+            break;
+        case SCROLL_RECT: g.scrollRect(a[0], a[1], a[2], a[3], a[4], a[5], v); break;
+        case SCROLL: g.scroll(a[0], a[1], v); break;
+        case CANVAS: g.drawCanvas(a[0], a[1], src, a[2], a[3], a[4], a[5]); break;
+        case TEXT:
+            g.setFont(opFont(op));
+            g.drawText(a[0], a[1], (const char*)op.data.data(), v);
+            break;
+        case SET_CLIP: g.setClip(a[0], a[1], a[2], a[3]); break;
+        case SET_VIEWPORT: g.setViewport(a[0], a[1], a[2], a[3]); break;
+        case RESET_CLIP: g.resetClip(); break;
+        default: break;
+    }
+}
+
+static void apply(const Op& op, Reference& r)
+{
+    const int* a = op.a;
+    uint8_t    v = op.value;
+    switch(op.type)
+    {
+        case PIXEL: r.plot(a[0], a[1], v); break;
+        case FILL: r.fill(v); break;
+        case LINE: r.line(a[0], a[1], a[2], a[3], v); break;
+        case HLINE: r.hline(a[0], a[1], a[2], v); break;
+        case VLINE:
+            for(int j = 0; j < a[2]; j++)
+                r.plot(a[0], a[1] + j, v);
+            break;
+        case RECT: r.rect(a[0], a[1], a[2], a[3], v, false); break;
+        case FILL_RECT: r.rect(a[0], a[1], a[2], a[3], v, true); break;
+        case CIRCLE: r.circle(a[0], a[1], a[2], v, false); break;
+        case FILL_CIRCLE: r.circle(a[0], a[1], a[2], v, true); break;
+        case TRIANGLE: r.triangle(a, v, false); break;
+        case FILL_TRIANGLE: r.triangle(a, v, true); break;
+        case ELLIPSE: r.ellipse(a[0], a[1], a[2], a[3], v, false); break;
+        case FILL_ELLIPSE: r.ellipse(a[0], a[1], a[2], a[3], v, true); break;
+        case ROUND_RECT: r.roundRect(a[0], a[1], a[2], a[3], a[4], v, false); break;
+        case FILL_ROUND_RECT: r.roundRect(a[0], a[1], a[2], a[3], a[4], v, true); break;
+        case BITMAP: r.bitmap(a[0], a[1], op.data.data(), a[2], a[3], v, 0, false); break;
+        case BITMAP_OPAQUE: r.bitmap(a[0], a[1], op.data.data(), a[2], a[3], v, a[4], true); break;
+        case GRAY_BITMAP: r.gray(a[0], a[1], op.data.data(), nullptr, a[2], a[3], -1); break;
+        case GRAY_TRANSPARENT: r.gray(a[0], a[1], op.data.data(), nullptr, a[2], a[3], a[4]); break;
+        case GRAY_MASKED: r.gray(a[0], a[1], op.data.data(), op.mask.data(), a[2], a[3], -1); break;
+        case SCROLL_RECT: r.scrollRect(a[0], a[1], a[2], a[3], a[4], a[5], v); break;
+        case SCROLL: r.scroll(a[0], a[1], v); break;
+        case CANVAS:
+            r.canvas(a[0], a[1], canvas_pixels, CANVAS_W, CANVAS_H, a[2], a[3], a[4], a[5]);
+            break;
+        case TEXT: r.text(a[0], a[1], (const char*)op.data.data(), v, opFont(op)); break;
+        case SET_CLIP: r.setClip(a[0], a[1], a[2], a[3]); break;
+        case SET_VIEWPORT: r.setViewport(a[0], a[1], a[2], a[3]); break;
+        case RESET_CLIP: r.resetClip(); break;
+        default: break;
+    }
+}
+
+static std::string describe(const Op& op)
+{
+    char buf[160];
+    snprintf(buf, sizeof(buf), "%s(%d, %d, %d, %d, %d, %d, %d) value %u",
+             OP_NAMES[op.type], op.a[0], op.a[1], op.a[2], op.a[3], op.a[4], op.a[5], op.a[6], op.value);
+    std::string s = buf;
+    if(op.type == TEXT)
+    {
+        s += " \"";
+        for(const uint8_t* c = op.data.data(); *c; c++)
+        {
+            snprintf(buf, sizeof(buf), *c >= 32 && *c < 127 ? "%c" : "\\x%02X", *c);
+            s += buf;
+        }
+        s += "\"";
+    }
+    return s;
+}
+
+static void printImages(const char* label_a, const uint8_t* a, const char* label_b, const uint8_t* b)
+{
+    const char* shades = " .:-=+*#%@";
+    printf("  %-18s%s\n", label_a, label_b);
+    for(int y = 0; y < HEIGHT; y++)
+    {
+        printf("  ");
+        for(int x = 0; x < WIDTH; x++)
+            putchar(shades[a[x + y * WIDTH] * 10 / 256]);
+        printf("  ");
+        for(int x = 0; x < WIDTH; x++)
+        {
+            int i = x + y * WIDTH;
+            putchar(a[i] != b[i] ? 'X' : shades[b[i] * 10 / 256]);
+        }
+        putchar('\n');
+    }
+}
+
+static uint32_t hashFrame(const uint8_t* px)
+{
+    uint32_t h = 2166136261u;
+    for(int i = 0; i < WIDTH * HEIGHT; i++)
+        h = (h ^ px[i]) * 16777619u;
+    return h;
+}
+
+static bool loadGolden(const char* path, uint32_t& seed, std::vector<uint32_t>& hashes)
+{
+    FILE* f = fopen(path, "rb");
+    if(f == nullptr)
+        return false;
+    uint8_t  header[12];
+    bool     ok = fread(header, 1, 12, f) == 12 && memcmp(header, "IRG", 3) == 0 && header[3] == 1;
+    uint32_t count;
+    if(ok)
+    {
+        memcpy(&seed, &header[4], 4);
+        memcpy(&count, &header[8], 4);
+        hashes.resize(count);
+        ok = fread(hashes.data(), 4, count, f) == count;
+    }
+    fclose(f);
+    return ok;
+}
+
+static bool saveGolden(const char* path, uint32_t seed, const std::vector<uint32_t>& hashes)
+{
+    FILE* f = fopen(path, "wb");
+    if(f == nullptr)
+        return false;
+    uint32_t count = hashes.size();
+    fwrite("IRG\x01", 1, 4, f);
+    fwrite(&seed, 4, 1, f);
+    fwrite(&count, 4, 1, f);
+    fwrite(hashes.data(), 4, count, f);
+    fclose(f);
+    return true;
+}
+
+static const char* DEFAULT_GOLDEN = "tools/raster_check.golden";
+
+int main(int argc, char** argv)
+{
+    uint32_t    cases  = 20000;
+    uint32_t    seed   = 1;
+    const char* record = nullptr;
+    const char* check  = nullptr;
+    bool        custom = false;
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            cases  = strtoul(argv[++i], nullptr, 0);
+            custom = true;
+        }
+        else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            seed   = strtoul(argv[++i], nullptr, 0);
+            custom = true;
+        }
+        else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            record = argv[++i];
+        else if(strcmp(argv[i], "--check") == 0 && i + 1 < argc)
+            check = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [-n cases] [-s seed] [--record golden.bin | --check golden.bin]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // The default corpus is always held to the committed hashes.
+    if(check == nullptr && record == nullptr && !custom)
+        check = DEFAULT_GOLDEN;
+
+    std::vector<uint32_t> golden;
+    if(check != nullptr)
+    {
+        if(!loadGolden(check, seed, golden))
+        {
+            fprintf(stderr, "could not read golden file %s\n", check);
+            return 2;
+        }
+        cases = golden.size();
+    }
+
+    HostChip& chip = HostChip::instance();
+    chip.reset();
+    static I2CHandle i2c;
+    static IS31FL3731 driver;
+    if(!driver.begin(ISSI_ADDR_DEFAULT, &i2c))
+        return 2;
+
+    static IS31FL3731_StaticGraphics<WIDTH, HEIGHT> display;
+    IS31FL3731_Graphics::Config cfg;
+    cfg.Defaults();
+    cfg.driver = &driver;
+    display.Init(cfg);
+
+    Random rng(seed);
+    for(auto& p : canvas_pixels)
+        p = rng.next();
+    IS31FL3731_Canvas src(canvas_pixels, CANVAS_W, CANVAS_H);
+
+    std::vector<uint32_t> hashes;
+    uint32_t              failures = 0;
+    uint32_t              ops_run  = 0;
+    for(uint32_t n = 0; n < cases; n++)
+    {
+        Reference ref;
+        uint8_t   bg = rng.next() % 2 ? rng.next() : 0;
+        display.resetClip();
+        display.fill(bg);
+        ref.fill(bg);
+        display.update();
+
+        // The whole case is generated first so a failure does not shift
+        // the random stream for the cases after it.
+        std::vector<Op> ops(rng.range(1, 5));
+        for(Op& op : ops)
+            op = randomOp(rng);
+
+        const char* failed = nullptr;
+        for(const Op& op : ops)
+        {
+            uint8_t before[WIDTH * HEIGHT];
+            memcpy(before, display.target()->pixels(), sizeof(before));
+
+            apply(op, display, &src);
+            apply(op, ref);
+            ops_run++;
+            if(failed != nullptr)
+                continue;
+
+            const uint8_t*  px    = display.target()->pixels();
+            IS31FL3731_Rect dirty = display.target()->dirty();
+            for(int p = 0; p < WIDTH * HEIGHT && failed == nullptr; p++)
+            {
+                int x = p % WIDTH, y = p / WIDTH;
+                if(px[p] != before[p] && !(x >= dirty.x0 && x < dirty.x1 && y >= dirty.y0 && y < dirty.y1))
+                    failed = "pixel changed outside the dirty region";
+            }
+            if(failed == nullptr && memcmp(px, ref.pixels(), WIDTH * HEIGHT) != 0)
+                failed = "differs from the reference";
+        }
+
+        if(failed == nullptr)
+        {
+            display.update();
+            if(memcmp(&chip.regs[0][0x24], display.target()->pixels(), WIDTH * HEIGHT) != 0)
+                failed = "chip does not hold the framebuffer after update()";
+            else if(chip.bad_accesses != 0)
+                failed = "invalid register access";
+        }
+
+        uint32_t hash = hashFrame(display.target()->pixels());
+        hashes.push_back(hash);
+        if(failed == nullptr && check != nullptr && golden[n] != hash)
+            failed = "differs from the golden image";
+
+        if(failed != nullptr)
+        {
+            if(failures++ < 5)
+            {
+                printf("case %u: %s (background %u)\n", n, failed, bg);
+                for(const Op& op : ops)
+                    printf("  %s\n", describe(op).c_str());
+                printImages("reference", ref.pixels(), "graphics (X = differs)", display.target()->pixels());
+            }
+            chip.bad_accesses = 0;
+        }
+    }
+
+    if(record != nullptr && !saveGolden(record, seed, hashes))
+    {
+        fprintf(stderr, "could not write %s\n", record);
+        return 2;
+    }
+    printf("%u cases, %u draw calls, seed %u: %u failed", cases, ops_run, seed, failures);
+    if(check != nullptr)
+        printf(" (golden %s)", check);
+    printf("\n");
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,284 @@
+// Encodes grayscale PGM frames into the IS31FL3731_Sequence format, then
+// decodes the result with IS31FL3731_SequencePlayer and checks every frame
+// comes back byte for byte.
+//
+//   g++ -O2 -std=gnu++14 -I. -o sequence_encode tools/sequence_encode.cpp
+//       lib/is31fl3731_graphics/IS31FL3731_Canvas.cpp
+//       lib/is31fl3731_graphics/IS31FL3731_Sequence.cpp
+//   ./sequence_encode [-d ms] [-o out.isq] [-c name] frame0.pgm frame1.pgm@250 ...
+//
+// -d sets the default frame duration (100 ms), file@ms overrides it per
+// frame. -c writes a C array named name instead of raw bytes, ready to be
+// compiled into flash. Convert PNG/GIF input first, e.g. with
+// "convert anim.gif -coalesce -colorspace gray frame%03d.pgm".
+
+#include "lib/is31fl3731_graphics/IS31FL3731_Canvas.h"
+#include "lib/is31fl3731_graphics/IS31FL3731_Sequence.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+struct Frame
+{
+    uint16_t             duration_ms;
+    std::vector<uint8_t> pixels;
+};
+
+static int readPgmInt(FILE* f)
+{
+    int c = fgetc(f);
+    while(c == '#' || c == ' ' || c == '\t' || c == '\r' || c == '\n')
+    {
+        if(c == '#')
+        {
+            while(c != '\n' && c != EOF)
+                c = fgetc(f);
+        }
+        c = fgetc(f);
+    }
+
+    int v = -1;
+    while(c >= '0' && c <= '9')
+    {
+        v = (v < 0 ? 0 : v * 10) + (c - '0');
+        c = fgetc(f);
+    }
+    return v;
+}
+
+// Reads binary (P5) or ASCII (P2) PGM, scaling maxval to 0-255.
+static bool loadPgm(const char* path, int& w, int& h, std::vector<uint8_t>& pixels)
+{
+    FILE* f = fopen(path, "rb");
+    if(f == nullptr)
+        return false;
+
+    char magic[2];
+    bool ok = fread(magic, 1, 2, f) == 2 && magic[0] == 'P' && (magic[1] == '5' || magic[1] == '2');
+    int  maxval = 0;
+    if(ok)
+    {
+        w      = readPgmInt(f);
+        h      = readPgmInt(f);
+        maxval = readPgmInt(f);
+        ok     = w > 0 && h > 0 && maxval > 0 && maxval < 256;
+    }
+
+    if(ok)
+    {
+        pixels.resize(w * h);
+        for(int i = 0; ok && i < w * h; i++)
+        {
+            int v = magic[1] == '5' ? fgetc(f) : readPgmInt(f);
+            ok    = v >= 0;
+            if(ok)
+                pixels[i] = (uint8_t)((v > maxval ? maxval : v) * 255 / maxval);
+        }
+    }
+
+    fclose(f);
+    return ok;
+}
+
+static int unchangedAt(const uint8_t* prev, const uint8_t* cur, int pos, int end)
+{
+    int n = 0;
+    while(pos + n < end && cur[pos + n] == prev[pos + n])
+        n++;
+    return n;
+}
+
+static int runAt(const uint8_t* cur, int pos, int end)
+{
+    int n = 1;
+    while(pos + n < end && cur[pos + n] == cur[pos])
+        n++;
+    return n;
+}
+
+static void encodeFrame(const uint8_t* prev, const uint8_t* cur, int n, std::vector<uint8_t>& out)
+{
+    int end = n;
+    while(end > 0 && cur[end - 1] == prev[end - 1])
+        end--;
+
+    int pos = 0;
+    while(pos < end)
+    {
+        // A single unchanged pixel is cheaper inside a literal than as a skip.
+        int same = unchangedAt(prev, cur, pos, end);
+        if(same >= 2)
+        {
+            int count = same < IS31FL3731_SEQUENCE_MAX_SKIP ? same : IS31FL3731_SEQUENCE_MAX_SKIP;
+            out.push_back(IS31FL3731_SEQUENCE_OP_SKIP | (count - 1));
+            pos += count;
+            continue;
+        }
+
+        int run = runAt(cur, pos, end);
+        if(run >= 3)
+        {
+            int count = run < IS31FL3731_SEQUENCE_MAX_RUN ? run : IS31FL3731_SEQUENCE_MAX_RUN;
+            out.push_back(IS31FL3731_SEQUENCE_OP_RUN | (count - 1));
+            out.push_back(cur[pos]);
+            pos += count;
+            continue;
+        }
+
+        int count = 1;
+        while(pos + count < end && count < IS31FL3731_SEQUENCE_MAX_LITERAL
+              && unchangedAt(prev, cur, pos + count, end) < 2 && runAt(cur, pos + count, end) < 3)
+        {
+            count++;
+        }
+        out.push_back(IS31FL3731_SEQUENCE_OP_LITERAL | (count - 1));
+        out.insert(out.end(), cur + pos, cur + pos + count);
+        pos += count;
+    }
+}
+
+static bool verify(const std::vector<uint8_t>& data, const std::vector<Frame>& frames, int w, int h)
+{
+    std::vector<uint8_t>      buffer(w * h, 0);
+    IS31FL3731_Canvas         canvas(buffer.data(), w, h);
+    IS31FL3731_MemorySource   source(data.data(), data.size());
+    IS31FL3731_SequencePlayer player;
+
+    IS31FL3731_SequencePlayer::Config cfg;
+    cfg.Defaults();
+    cfg.source = &source;
+    cfg.canvas = &canvas;
+    cfg.loop   = false;
+    if(!player.Init(cfg))
+        return false;
+
+    uint32_t now = 0;
+    for(size_t i = 0; i < frames.size(); i++)
+    {
+        if(i == 0)
+            player.start(now);
+        else
+            player.tick(now);
+
+        if(player.error() || buffer != frames[i].pixels)
+        {
+            fprintf(stderr, "frame %zu does not decode back\n", i);
+            return false;
+        }
+        now += frames[i].duration_ms;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    uint16_t                 duration = 100;
+    const char*              out_path = nullptr;
+    const char*              c_name   = nullptr;
+    std::vector<std::string> inputs;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+            duration = (uint16_t)atoi(argv[++i]);
+        else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            out_path = argv[++i];
+        else if(strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+            c_name = argv[++i];
+        else
+            inputs.push_back(argv[i]);
+    }
+
+    if(inputs.empty() || inputs.size() > 0xFFFF)
+    {
+        fprintf(stderr, "usage: %s [-d ms] [-o out.isq] [-c name] frame.pgm[@ms] ...\n", argv[0]);
+        return 1;
+    }
+
+    int                w = 0;
+    int                h = 0;
+    std::vector<Frame> frames;
+    for(const std::string& input : inputs)
+    {
+        std::string path = input;
+        Frame       frame;
+        frame.duration_ms = duration;
+
+        size_t at = path.rfind('@');
+        if(at != std::string::npos)
+        {
+            frame.duration_ms = (uint16_t)atoi(path.c_str() + at + 1);
+            path.resize(at);
+        }
+        if(frame.duration_ms == 0)
+            frame.duration_ms = 1;
+
+        int fw;
+        int fh;
+        if(!loadPgm(path.c_str(), fw, fh, frame.pixels))
+        {
+            fprintf(stderr, "could not read PGM %s\n", path.c_str());
+            return 1;
+        }
+        if(frames.empty())
+        {
+            w = fw;
+            h = fh;
+        }
+        if(fw != w || fh != h || w > 255 || h > 255)
+        {
+            fprintf(stderr, "%s: frames must all be the same size, at most 255x255\n", path.c_str());
+            return 1;
+        }
+        frames.push_back(frame);
+    }
+
+    std::vector<uint8_t> data = {'I', 'S', 'Q', IS31FL3731_SEQUENCE_VERSION,
+                                 (uint8_t)w, (uint8_t)h,
+                                 (uint8_t)(frames.size() & 0xFF), (uint8_t)(frames.size() >> 8)};
+
+    std::vector<uint8_t> prev(w * h, 0);
+    std::vector<uint8_t> payload;
+    for(const Frame& frame : frames)
+    {
+        payload.clear();
+        encodeFrame(prev.data(), frame.pixels.data(), w * h, payload);
+        data.push_back(frame.duration_ms & 0xFF);
+        data.push_back(frame.duration_ms >> 8);
+        data.push_back(payload.size() & 0xFF);
+        data.push_back(payload.size() >> 8);
+        data.insert(data.end(), payload.begin(), payload.end());
+        prev = frame.pixels;
+    }
+
+    if(!verify(data, frames, w, h))
+        return 1;
+
+    FILE* out = out_path != nullptr ? fopen(out_path, c_name != nullptr ? "w" : "wb") : stdout;
+    if(out == nullptr)
+    {
+        fprintf(stderr, "could not write %s\n", out_path);
+        return 1;
+    }
+
+    if(c_name != nullptr)
+    {
+        fprintf(out, "// %zu frames, %dx%d\n", frames.size(), w, h);
+        fprintf(out, "const uint8_t %s[%zu] = {", c_name, data.size());
+        for(size_t i = 0; i < data.size(); i++)
+            fprintf(out, "%s0x%02X,", i % 16 == 0 ? "\n    " : " ", data[i]);
+        fprintf(out, "\n};\n");
+    }
+    else
+    {
+        fwrite(data.data(), 1, data.size(), out);
+    }
+    if(out != stdout)
+        fclose(out);
+
+    fprintf(stderr, "%zu frames, %dx%d: %zu raw bytes -> %zu encoded\n",
+            frames.size(), w, h, frames.size() * w * h, data.size());
+    return 0;
+}
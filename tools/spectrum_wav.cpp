@@ -0,0 +1,181 @@
+// Feeds a WAV file through IS31FL3731_Spectrum on a Linux host. A producer
+// thread plays the role of the audio callback and pushes 48-sample blocks
+// in real time; the main thread runs process()/render() like the Daisy
+// main loop and prints the 16x9 canvas as ASCII art.
+//
+//   g++ -O2 -std=gnu++14 -pthread -I. -o spectrum_wav tools/spectrum_wav.cpp
+//       lib/is31fl3731_graphics/IS31FL3731_Canvas.cpp
+//       lib/is31fl3731_graphics/IS31FL3731_FixedMath.cpp
+//       lib/is31fl3731_graphics/IS31FL3731_Spectrum.cpp
+//   ./spectrum_wav input.wav [--vu] [--fast]
+//
+// Only 16-bit PCM is supported; stereo is mixed down to mono.
+
+#include "lib/is31fl3731_graphics/IS31FL3731_Canvas.h"
+#include "lib/is31fl3731_graphics/IS31FL3731_Spectrum.h"
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+static const uint32_t BLOCK_SIZE = 48;
+
+struct WavData
+{
+    uint32_t             sample_rate;
+    std::vector<int16_t> samples;
+};
+
+static uint32_t readLE(const uint8_t* p, int bytes)
+{
+    uint32_t v = 0;
+    for(int i = bytes - 1; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+static bool loadWav(const char* path, WavData& wav)
+{
+    FILE* f = fopen(path, "rb");
+    if(f == nullptr)
+        return false;
+
+    std::vector<uint8_t> data;
+    uint8_t              buf[4096];
+    size_t               n;
+    while((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    fclose(f);
+
+    if(data.size() < 12 || memcmp(&data[0], "RIFF", 4) != 0 || memcmp(&data[8], "WAVE", 4) != 0)
+        return false;
+
+    uint16_t channels = 0;
+    uint16_t bits     = 0;
+    size_t   pos      = 12;
+    while(pos + 8 <= data.size())
+    {
+        uint32_t size = readLE(&data[pos + 4], 4);
+        if(memcmp(&data[pos], "fmt ", 4) == 0 && size >= 16)
+        {
+            channels         = readLE(&data[pos + 10], 2);
+            wav.sample_rate  = readLE(&data[pos + 12], 4);
+            bits             = readLE(&data[pos + 22], 2);
+        }
+        else if(memcmp(&data[pos], "data", 4) == 0)
+        {
+            if(bits != 16 || channels == 0)
+                return false;
+            size_t frames = size / (2 * channels);
+            if(pos + 8 + frames * 2 * channels > data.size())
+                frames = (data.size() - pos - 8) / (2 * channels);
+            for(size_t i = 0; i < frames; i++)
+            {
+                int32_t sum = 0;
+                for(uint16_t c = 0; c < channels; c++)
+                    sum += (int16_t)readLE(&data[pos + 8 + (i * channels + c) * 2], 2);
+                wav.samples.push_back((int16_t)(sum / channels));
+            }
+            return true;
+        }
+        pos += 8 + size + (size & 1);
+    }
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "usage: %s input.wav [--vu] [--fast]\n", argv[0]);
+        return 1;
+    }
+
+    bool vu   = false;
+    bool fast = false;
+    for(int i = 2; i < argc; i++)
+    {
+        vu |= strcmp(argv[i], "--vu") == 0;
+        fast |= strcmp(argv[i], "--fast") == 0;
+    }
+
+    WavData wav;
+    if(!loadWav(argv[1], wav))
+    {
+        fprintf(stderr, "could not read 16-bit PCM WAV %s\n", argv[1]);
+        return 1;
+    }
+
+    static IS31FL3731_Spectrum     spectrum;
+    IS31FL3731_StaticCanvas<16, 9> canvas;
+
+    IS31FL3731_Spectrum::Config cfg;
+    cfg.Defaults();
+    cfg.sample_rate = wav.sample_rate;
+    cfg.mode        = vu ? IS31FL3731_Spectrum::Mode::VU : IS31FL3731_Spectrum::Mode::SPECTRUM;
+    if(!spectrum.Init(cfg))
+    {
+        fprintf(stderr, "bad spectrum config\n");
+        return 1;
+    }
+
+    std::atomic<bool> finished(false);
+    auto              start = std::chrono::steady_clock::now();
+
+    std::thread producer([&]() {
+        for(size_t pos = 0; pos < wav.samples.size(); pos += BLOCK_SIZE)
+        {
+            uint32_t n = wav.samples.size() - pos < BLOCK_SIZE ? wav.samples.size() - pos : BLOCK_SIZE;
+            spectrum.pushAudio(&wav.samples[pos], n);
+
+            if(!fast)
+            {
+                auto due = start + std::chrono::microseconds((uint64_t)(pos + n) * 1000000 / wav.sample_rate);
+                std::this_thread::sleep_until(due);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        finished.store(true);
+    });
+
+    const char* shades = " .:-=+*#%@";
+    uint32_t    frames = 0;
+    while(true)
+    {
+        // Read before process() so the producer's last block is not missed.
+        bool producer_done = finished.load();
+        if(!spectrum.process())
+        {
+            if(producer_done)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        uint32_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+        spectrum.render(&canvas, now_ms);
+
+        if(frames++ % 8 == 0)
+        {
+            printf("\x1b[H%6lu ms  dropped %lu\n", (unsigned long)now_ms, (unsigned long)spectrum.dropped());
+            for(uint16_t y = 0; y < canvas.height(); y++)
+            {
+                for(uint16_t x = 0; x < canvas.width(); x++)
+                    putchar(shades[canvas.pixels()[x + y * canvas.width()] * 10 / 256]);
+                putchar('\n');
+            }
+            fflush(stdout);
+        }
+    }
+
+    producer.join();
+    printf("%lu analyses, %lu samples dropped\n", (unsigned long)frames, (unsigned long)spectrum.dropped());
+    return 0;
+}
@@ -0,0 +1,390 @@
+// Replays an IS31FL3731_Trace dump into a model of the chip and renders
+// every frame the chip would have shown, or compares two dumps.
+//
+//   g++ -O2 -std=gnu++14 -I. -o trace_replay tools/trace_replay.cpp
+//       lib/is31fl3731/is31fl3731_trace.cpp
+//   ./trace_replay [-w 16] [-h 9] [-l] [-a] [-p prefix] trace.bin
+//   ./trace_replay [-w 16] [-h 9] --diff a.bin b.bin
+//
+// -l lists the transactions, -a prints frames as ASCII art and -p writes
+// them as prefix0000.pgm, prefix0001.pgm, ... A frame is what the chip
+// displays after each write to the picture frame register; repeats of the
+// same picture are collapsed. --diff reports the first difference in wire
+// traffic and whether both traces show the same frames, and exits with 1
+// if they do not.
+//
+// The model starts out as begin() leaves the chip: running, all LEDs
+// enabled, all PWM registers zero. A trace that wrapped misses whatever
+// was written before its oldest entry.
+
+#include "lib/is31fl3731/is31fl3731_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static const uint8_t BANK_FUNCTION = 0x0B;
+static const uint8_t REG_COMMAND   = 0xFD;
+static const uint8_t REG_FRAME     = 0x01;
+static const uint8_t REG_SHUTDOWN  = 0x0A;
+
+struct Op
+{
+    uint32_t             time_us;
+    uint8_t              addr;
+    uint8_t              bank;
+    uint8_t              reg;
+    uint8_t              flags;
+    uint16_t             length;
+    uint16_t             checksum;
+    std::vector<uint8_t> payload; // empty if it was overwritten
+};
+
+struct Trace
+{
+    std::vector<Op> ops;
+    uint32_t        overwritten;
+};
+
+struct Frame
+{
+    uint32_t             time_us;
+    uint32_t             displays; // picture frame writes that showed it
+    std::vector<uint8_t> pixels;
+};
+
+static uint32_t readLE(const uint8_t* p, int bytes)
+{
+    uint32_t v = 0;
+    for(int i = bytes - 1; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+static bool loadTrace(const char* path, Trace& trace)
+{
+    FILE* f = fopen(path, "rb");
+    if(f == nullptr)
+        return false;
+    std::vector<uint8_t> data;
+    uint8_t              buf[4096];
+    size_t               n;
+    while((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    fclose(f);
+
+    if(data.size() < IS31FL3731_TRACE_HEADER_SIZE || memcmp(&data[0], "IST", 3) != 0
+       || data[3] != IS31FL3731_TRACE_VERSION)
+        return false;
+
+    uint32_t count    = readLE(&data[4], 4);
+    trace.overwritten = readLE(&data[8], 4);
+    size_t pos        = IS31FL3731_TRACE_HEADER_SIZE;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(pos + IS31FL3731_TRACE_ENTRY_HEADER_SIZE > data.size())
+            return false;
+        const uint8_t* p = &data[pos];
+        Op             op;
+        op.time_us       = readLE(p, 4);
+        op.addr          = p[4];
+        op.bank          = p[5];
+        op.reg           = p[6];
+        op.flags         = p[7];
+        op.length        = readLE(p + 8, 2);
+        op.checksum      = readLE(p + 10, 2);
+        uint16_t stored  = readLE(p + 12, 2);
+        pos += IS31FL3731_TRACE_ENTRY_HEADER_SIZE;
+        if(pos + stored > data.size() || (stored != 0 && stored != op.length))
+            return false;
+        op.payload.assign(&data[pos], &data[pos] + stored);
+        pos += stored;
+        trace.ops.push_back(op);
+    }
+    return true;
+}
+
+class ChipModel
+{
+  public:
+    ChipModel(int width, int height) : width_(width), height_(height), bank_(-1)
+    {
+        memset(regs_, 0, sizeof(regs_));
+        for(int f = 0; f < 8; f++)
+            memset(regs_[f], 0xFF, 0x12);
+        regs_[BANK_FUNCTION][REG_SHUTDOWN] = 0x01;
+    }
+
+    // Returns true when op wrote the picture frame register.
+    bool apply(const Op& op, uint32_t& lost)
+    {
+        if(op.flags & (IS31FL3731_TRACE_READ | IS31FL3731_TRACE_FAILED))
+            return false;
+        if(op.payload.size() != op.length)
+        {
+            lost++;
+            return false;
+        }
+        if(op.reg == REG_COMMAND)
+        {
+            if(op.length > 0)
+                bank_ = op.payload[0];
+            return false;
+        }
+
+        // Before the first recorded select, trust the driver's idea of it.
+        int bank = bank_ >= 0 ? bank_ : op.bank;
+        if(bank > BANK_FUNCTION)
+            return false;
+        bool frame = false;
+        for(uint16_t i = 0; i < op.length; i++)
+        {
+            uint8_t reg      = (uint8_t)(op.reg + i);
+            regs_[bank][reg] = op.payload[i];
+            frame |= bank == BANK_FUNCTION && reg == REG_FRAME;
+        }
+        return frame;
+    }
+
+    std::vector<uint8_t> render() const
+    {
+        std::vector<uint8_t> pixels(width_ * height_, 0);
+        if((regs_[BANK_FUNCTION][REG_SHUTDOWN] & 0x01) == 0)
+            return pixels;
+
+        const uint8_t* f = regs_[regs_[BANK_FUNCTION][REG_FRAME] & 0x07];
+        for(int i = 0; i < width_ * height_ && i < 144; i++)
+        {
+            if(f[i / 8] & (1 << (i % 8)))
+                pixels[i] = f[0x24 + i];
+        }
+        return pixels;
+    }
+
+  private:
+    int     width_;
+    int     height_;
+    int     bank_;
+    uint8_t regs_[BANK_FUNCTION + 1][256];
+};
+
+static std::vector<Frame> replay(const Trace& trace, int width, int height, uint32_t& lost)
+{
+    ChipModel          chip(width, height);
+    std::vector<Frame> frames;
+    lost = 0;
+    for(const Op& op : trace.ops)
+    {
+        if(!chip.apply(op, lost))
+            continue;
+        std::vector<uint8_t> pixels = chip.render();
+        if(!frames.empty() && frames.back().pixels == pixels)
+        {
+            frames.back().displays++;
+            continue;
+        }
+        frames.push_back(Frame{op.time_us, 1, pixels});
+    }
+    return frames;
+}
+
+static void printSummary(const char* name, const Trace& trace, size_t frames, uint32_t lost)
+{
+    uint32_t writes = 0, reads = 0, failed = 0, selects = 0, bytes = 0;
+    for(const Op& op : trace.ops)
+    {
+        failed += (op.flags & IS31FL3731_TRACE_FAILED) != 0;
+        reads += (op.flags & IS31FL3731_TRACE_READ) != 0;
+        selects += op.reg == REG_COMMAND;
+        writes += (op.flags & IS31FL3731_TRACE_READ) == 0 && op.reg != REG_COMMAND;
+        bytes += op.length + 1;
+    }
+    printf("%s: %zu transactions (%u writes, %u bank selects, %u reads, %u failed), %u bytes, %zu frames\n",
+           name, trace.ops.size(), writes, selects, reads, failed, bytes, frames);
+    if(!trace.ops.empty())
+        printf("%s: %.3f ms from first to last entry\n",
+               name, (trace.ops.back().time_us - trace.ops.front().time_us) / 1000.0);
+    if(trace.overwritten > 0)
+        printf("%s: %u older entries were overwritten; state before the trace is unknown\n",
+               name, trace.overwritten);
+    if(lost > 0)
+        printf("%s: %u writes lost their payload and were not replayed\n", name, lost);
+}
+
+static void printEntry(const char* label, size_t i, const Op& op)
+{
+    printf("%s%6zu %10u us  0x%02X  bank %-2u %s 0x%02X  len %3u  sum %04X%s%s\n",
+           label, i, op.time_us, op.addr, op.bank,
+           (op.flags & IS31FL3731_TRACE_READ) ? "read " : "write",
+           op.reg, op.length, op.checksum,
+           (op.flags & IS31FL3731_TRACE_FAILED) ? "  FAILED" : "",
+           op.payload.size() != op.length ? "  (payload lost)" : "");
+}
+
+static void printFrame(size_t i, const Frame& frame, int width, int height)
+{
+    const char* shades = " .:-=+*#%@";
+    printf("frame %zu at %u us (shown %u times)\n", i, frame.time_us, frame.displays);
+    for(int y = 0; y < height; y++)
+    {
+        for(int x = 0; x < width; x++)
+            putchar(shades[frame.pixels[x + y * width] * 10 / 256]);
+        putchar('\n');
+    }
+}
+
+static bool writePGM(const std::string& path, const Frame& frame, int width, int height)
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    if(f == nullptr)
+        return false;
+    fprintf(f, "P5\n%d %d\n255\n", width, height);
+    fwrite(frame.pixels.data(), 1, frame.pixels.size(), f);
+    fclose(f);
+    return true;
+}
+
+static bool sameOnWire(const Op& a, const Op& b)
+{
+    return a.addr == b.addr && a.bank == b.bank && a.reg == b.reg && a.flags == b.flags
+           && a.length == b.length && a.checksum == b.checksum;
+}
+
+static int diff(const char* path_a, const char* path_b, int width, int height)
+{
+    Trace a, b;
+    if(!loadTrace(path_a, a))
+    {
+        fprintf(stderr, "could not read trace %s\n", path_a);
+        return 2;
+    }
+    if(!loadTrace(path_b, b))
+    {
+        fprintf(stderr, "could not read trace %s\n", path_b);
+        return 2;
+    }
+
+    uint32_t           lost_a, lost_b;
+    std::vector<Frame> frames_a = replay(a, width, height, lost_a);
+    std::vector<Frame> frames_b = replay(b, width, height, lost_b);
+    printSummary("a", a, frames_a.size(), lost_a);
+    printSummary("b", b, frames_b.size(), lost_b);
+
+    size_t common = a.ops.size() < b.ops.size() ? a.ops.size() : b.ops.size();
+    size_t first  = 0;
+    while(first < common && sameOnWire(a.ops[first], b.ops[first]))
+        first++;
+    if(first == common && a.ops.size() == b.ops.size())
+    {
+        printf("wire: identical\n");
+    }
+    else
+    {
+        printf("wire: first difference at entry %zu\n", first);
+        if(first < a.ops.size())
+            printEntry("  a", first, a.ops[first]);
+        if(first < b.ops.size())
+            printEntry("  b", first, b.ops[first]);
+    }
+
+    size_t frames = frames_a.size() < frames_b.size() ? frames_a.size() : frames_b.size();
+    for(size_t i = 0; i < frames; i++)
+    {
+        if(frames_a[i].pixels != frames_b[i].pixels)
+        {
+            int pixels = 0;
+            for(size_t p = 0; p < frames_a[i].pixels.size(); p++)
+                pixels += frames_a[i].pixels[p] != frames_b[i].pixels[p];
+            printf("output: frame %zu differs in %d pixels\n", i, pixels);
+            printFrame(i, frames_a[i], width, height);
+            printFrame(i, frames_b[i], width, height);
+            return 1;
+        }
+    }
+    if(frames_a.size() != frames_b.size())
+    {
+        printf("output: a shows %zu frames, b %zu; the first %zu match\n",
+               frames_a.size(), frames_b.size(), frames);
+        return 1;
+    }
+    printf("output: identical, %zu frames\n", frames);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    int         width  = 16;
+    int         height = 9;
+    bool        list   = false;
+    bool        ascii  = false;
+    const char* prefix = nullptr;
+    const char* diff_a = nullptr;
+    const char* diff_b = nullptr;
+    const char* input  = nullptr;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+            width = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-h") == 0 && i + 1 < argc)
+            height = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-l") == 0)
+            list = true;
+        else if(strcmp(argv[i], "-a") == 0)
+            ascii = true;
+        else if(strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+            prefix = argv[++i];
+        else if(strcmp(argv[i], "--diff") == 0 && i + 2 < argc)
+        {
+            diff_a = argv[++i];
+            diff_b = argv[++i];
+        }
+        else
+            input = argv[i];
+    }
+    if(width <= 0 || height <= 0 || width * height > 144 || (input == nullptr && diff_a == nullptr))
+    {
+        fprintf(stderr,
+                "usage: %s [-w 16] [-h 9] [-l] [-a] [-p prefix] trace.bin\n"
+                "       %s [-w 16] [-h 9] --diff a.bin b.bin\n",
+                argv[0], argv[0]);
+        return 2;
+    }
+
+    if(diff_a != nullptr)
+        return diff(diff_a, diff_b, width, height);
+
+    Trace trace;
+    if(!loadTrace(input, trace))
+    {
+        fprintf(stderr, "could not read trace %s\n", input);
+        return 2;
+    }
+
+    uint32_t           lost;
+    std::vector<Frame> frames = replay(trace, width, height, lost);
+
+    if(list)
+    {
+        for(size_t i = 0; i < trace.ops.size(); i++)
+            printEntry("", i, trace.ops[i]);
+    }
+    for(size_t i = 0; i < frames.size(); i++)
+    {
+        if(ascii)
+            printFrame(i, frames[i], width, height);
+        if(prefix != nullptr)
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "%04zu.pgm", i);
+            if(!writePGM(std::string(prefix) + name, frames[i], width, height))
+            {
+                fprintf(stderr, "could not write %s%s\n", prefix, name);
+                return 2;
+            }
+        }
+    }
+    printSummary(input, trace, frames.size(), lost);
+    return 0;
+}